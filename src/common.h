@@ -23,6 +23,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <inttypes.h>
+#include <time.h>
 
 #include "config.h"
 #include "config_internal.h"
@@ -129,3 +130,11 @@ static inline size_t pl_lcm(size_t x, size_t y)
     assert(x && y);
     return x * (y / pl_gcd(x, y));
 }
+
+// Returns the current value of a monotonic clock, in nanoseconds
+static inline uint64_t pl_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
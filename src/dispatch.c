@@ -15,6 +15,8 @@
  * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
+
 #include "common.h"
 #include "context.h"
 #include "shaders.h"
@@ -32,13 +34,21 @@ enum {
 struct pl_dispatch {
     struct pl_context *ctx;
     const struct pl_gpu *gpu;
+    struct pl_dispatch_cache *cache;
+    struct sh_memo_cache *memo;
     uint8_t current_ident;
     uint8_t current_index;
+    bool half_precision;
+    bool stats;
 
     // pool of pl_shaders, in order to avoid frequent re-allocations
     struct pl_shader **shaders;
     int num_shaders;
 
+    // arena for the temporary memory of all shaders generated in a frame
+    struct xta_ref *arena_ref;
+    struct sh_arena *arena;
+
     // list of compiled passes
     struct pass **passes;
     int num_passes;
@@ -47,8 +57,17 @@ struct pl_dispatch {
     struct cached_pass *cached_passes;
     int num_cached_passes;
 
+    // ring of uniform buffers, sub-allocated by all passes (if supported)
+    struct ubo_chunk **ubo_chunks;
+    int num_ubo_chunks;
+    int cur_ubo_chunk;
+    uint64_t ubo_gen;
+
     // temporary buffers to help avoid re_allocations during pass creation
     struct bstr tmp[TMP_COUNT];
+
+    // for pl_dispatch_query_stats
+    struct pl_dispatch_pass_stats *stats_tmp;
 };
 
 enum pass_var_type {
@@ -76,25 +95,201 @@ struct pass {
     // for uniform buffer updates
     const struct pl_buf *ubo;
     struct pl_shader_desc ubo_desc; // temporary
+    int ubo_index;
+
+    // when using the uniform buffer arena instead of `ubo`: host copy of the
+    // buffer contents, and the currently valid sub-allocation (if any)
+    uint8_t *ubo_data;
+    size_t ubo_size;
+    bool ubo_dirty;
+    struct ubo_chunk *ubo_chunk;
+    uint64_t ubo_gen;
+    size_t ubo_offset;
 
     // Cached pl_pass_run_params. This will also contain mutable allocations
     // for the push constants, descriptor bindings (including the binding for
     // the UBO pre-filled), vertex array and variable updates
     struct pl_pass_run_params run_params;
+
+    // Statistics, if enabled. Times are rolling averages in nanoseconds
+    struct pl_timer *timer;
+    char *description;
+    uint64_t num_runs;
+    uint64_t num_gpu_times;
+    double gpu_time;
+    double cpu_setup_time;
+    double cpu_run_time;
 };
 
+// Number of runs to average pass statistics over
+#define STATS_WINDOW 32
+
+// Uniform buffers are sub-allocated linearly from a ring of host-mapped
+// chunks, each bound at a different offset. A chunk is only recycled once the
+// GPU is done using it, so updating uniforms never stalls on in-flight passes.
+struct ubo_chunk {
+    const struct pl_buf *buf;
+    size_t used;
+    uint64_t gen; // unique, changes whenever the chunk gets recycled
+};
+
+// Default size of a uniform buffer arena chunk
+#define UBO_CHUNK_SIZE (64 * 1024)
+
 struct cached_pass {
     uint64_t signature;
     const uint8_t *cached_program;
     size_t cached_program_len;
 };
 
+struct shared_lut {
+    uint64_t key;
+    void *data;
+    size_t size;
+};
+
+struct pl_dispatch_cache {
+    struct pl_context *ctx;
+    const struct pl_gpu *gpu;
+    pthread_mutex_t lock;
+    int refcount;
+
+    // compiled programs, keyed by shader signature
+    struct cached_pass *programs;
+    int num_programs;
+
+    // generated LUT contents, keyed by `sh_lut_params.signature`
+    struct shared_lut *luts;
+    int num_luts;
+};
+
+struct pl_dispatch_cache *pl_dispatch_cache_create(struct pl_context *ctx,
+                                                   const struct pl_gpu *gpu)
+{
+    pl_assert(ctx);
+    struct pl_dispatch_cache *cache = talloc_zero(NULL, struct pl_dispatch_cache);
+    cache->ctx = ctx;
+    cache->gpu = gpu;
+    cache->refcount = 1;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+struct pl_dispatch_cache *pl_dispatch_cache_ref(struct pl_dispatch_cache *cache)
+{
+    pthread_mutex_lock(&cache->lock);
+    cache->refcount++;
+    pthread_mutex_unlock(&cache->lock);
+    return cache;
+}
+
+void pl_dispatch_cache_unref(struct pl_dispatch_cache **ptr)
+{
+    struct pl_dispatch_cache *cache = *ptr;
+    if (!cache)
+        return;
+
+    *ptr = NULL;
+    pthread_mutex_lock(&cache->lock);
+    bool last = --cache->refcount == 0;
+    pthread_mutex_unlock(&cache->lock);
+    if (!last)
+        return;
+
+    PL_DEBUG(cache, "Destroying shared cache with %d programs and %d LUTs",
+             cache->num_programs, cache->num_luts);
+    pthread_mutex_destroy(&cache->lock);
+    talloc_free(cache);
+}
+
+// Copies the cached program matching `sig` (if any) into `params`. The
+// `programs` array may be reallocated by concurrent users as soon as the lock
+// is released, but the program blobs themselves are never freed before the
+// cache, so it's enough to copy the pointer and length while holding it.
+static bool cache_find_program(struct pl_dispatch_cache *cache, uint64_t sig,
+                               struct pl_pass_params *params)
+{
+    bool found = false;
+    pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < cache->num_programs; i++) {
+        const struct cached_pass *prog = &cache->programs[i];
+        if (prog->signature == sig) {
+            params->cached_program = prog->cached_program;
+            params->cached_program_len = prog->cached_program_len;
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return found;
+}
+
+static void cache_add_program(struct pl_dispatch_cache *cache, uint64_t sig,
+                              const struct pl_pass_params *params)
+{
+    if (!params->cached_program_len)
+        return;
+
+    pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < cache->num_programs; i++) {
+        if (cache->programs[i].signature == sig)
+            goto done; // added concurrently
+    }
+
+    TARRAY_APPEND(cache, cache->programs, cache->num_programs, (struct cached_pass) {
+        .signature = sig,
+        .cached_program = talloc_memdup(cache, params->cached_program,
+                                        params->cached_program_len),
+        .cached_program_len = params->cached_program_len,
+    });
+
+done:
+    pthread_mutex_unlock(&cache->lock);
+}
+
+bool pl_dispatch_cache_get_lut(struct pl_dispatch_cache *cache, uint64_t key,
+                               void *out, size_t size)
+{
+    bool found = false;
+    pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < cache->num_luts; i++) {
+        const struct shared_lut *sl = &cache->luts[i];
+        if (sl->key == key && sl->size == size) {
+            memcpy(out, sl->data, size);
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return found;
+}
+
+void pl_dispatch_cache_add_lut(struct pl_dispatch_cache *cache, uint64_t key,
+                               const void *data, size_t size)
+{
+    pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < cache->num_luts; i++) {
+        if (cache->luts[i].key == key && cache->luts[i].size == size)
+            goto done; // added concurrently
+    }
+
+    TARRAY_APPEND(cache, cache->luts, cache->num_luts, (struct shared_lut) {
+        .key = key,
+        .data = talloc_memdup(cache, data, size),
+        .size = size,
+    });
+
+done:
+    pthread_mutex_unlock(&cache->lock);
+}
+
 static void pass_destroy(struct pl_dispatch *dp, struct pass *pass)
 {
     if (!pass)
         return;
 
     pl_buf_destroy(dp->gpu, &pass->ubo);
+    pl_timer_destroy(dp->gpu, &pass->timer);
     pl_pass_destroy(dp->gpu, &pass->pass);
     talloc_free(pass);
 }
@@ -106,6 +301,9 @@ struct pl_dispatch *pl_dispatch_create(struct pl_context *ctx,
     struct pl_dispatch *dp = talloc_zero(ctx, struct pl_dispatch);
     dp->ctx = ctx;
     dp->gpu = gpu;
+    dp->arena_ref = talloc_ref_new(ctx);
+    dp->arena = sh_arena_new(dp->arena_ref, 0);
+    dp->memo = sh_memo_cache_create(dp);
 
     return dp;
 }
@@ -120,32 +318,80 @@ void pl_dispatch_destroy(struct pl_dispatch **ptr)
         pass_destroy(dp, dp->passes[i]);
     for (int i = 0; i < dp->num_shaders; i++)
         pl_shader_free(&dp->shaders[i]);
+    for (int i = 0; i < dp->num_ubo_chunks; i++)
+        pl_buf_destroy(dp->gpu, &dp->ubo_chunks[i]->buf);
 
+    pl_dispatch_cache_unref(&dp->cache);
+    talloc_ref_deref(&dp->arena_ref);
     talloc_free(dp);
     *ptr = NULL;
 }
 
+// Limit on the amount of memory generated shaders may allocate from a single
+// arena before it's replaced
+#define ARENA_MAX_SIZE (1 << 20)
+
+// Replaces the current arena by a new one, sized to fit everything allocated
+// from the current arena. The old arena is freed as soon as the last shader
+// using it is released.
+static void new_arena(struct pl_dispatch *dp)
+{
+    size_t size = PL_MIN(sh_arena_used(dp->arena), ARENA_MAX_SIZE);
+    talloc_ref_deref(&dp->arena_ref);
+    dp->arena_ref = talloc_ref_new(dp->ctx);
+    dp->arena = sh_arena_new(dp->arena_ref, size);
+}
+
 struct pl_shader *pl_dispatch_begin_ex(struct pl_dispatch *dp, bool unique)
 {
     struct pl_shader_params params = {
         .id = unique ? dp->current_ident++ : 0,
         .gpu = dp->gpu,
         .index = dp->current_index,
+        .half_precision = dp->half_precision,
     };
 
+    // Users which don't call pl_dispatch_reset_frame still need to get their
+    // memory back eventually
+    if (sh_arena_used(dp->arena) > ARENA_MAX_SIZE)
+        new_arena(dp);
+
     struct pl_shader *sh;
-    if (TARRAY_POP(dp->shaders, dp->num_shaders, &sh)) {
-        pl_shader_reset(sh, &params);
-        return sh;
+    if (!TARRAY_POP(dp->shaders, dp->num_shaders, &sh))
+        sh = pl_shader_alloc(dp->ctx, NULL);
+    sh_reset_arena(sh, &params, dp->arena_ref, dp->arena);
+
+    sh->cache = dp->cache;
+    sh->memo = dp->memo;
+    sh->dp = dp;
+    sh->describe = dp->stats;
+    if (dp->stats)
+        sh->begin_ns = pl_clock_ns();
+    return sh;
+}
+
+void pl_dispatch_set_cache(struct pl_dispatch *dp,
+                           struct pl_dispatch_cache *cache)
+{
+    if (cache) {
+        pl_assert(cache->gpu == dp->gpu);
+        pl_dispatch_cache_ref(cache);
     }
 
-    return pl_shader_alloc(dp->ctx, &params);
+    pl_dispatch_cache_unref(&dp->cache);
+    dp->cache = cache;
 }
 
 void pl_dispatch_reset_frame(struct pl_dispatch *dp)
 {
     dp->current_ident = 0;
     dp->current_index++;
+    new_arena(dp);
+}
+
+void pl_dispatch_set_half_precision(struct pl_dispatch *dp, bool enable)
+{
+    dp->half_precision = enable;
 }
 
 struct pl_shader *pl_dispatch_begin(struct pl_dispatch *dp)
@@ -287,6 +533,10 @@ static void generate_shaders(struct pl_dispatch *dp, struct pass *pass,
                  "#extension GL_KHR_shader_subgroup_shuffle : enable \n");
     }
 
+    // Same for 16-bit float arithmetic (see `pl_shader_params.half_precision`)
+    if (gpu->caps & PL_GPU_CAP_FLOAT16)
+        ADD(pre, "#extension GL_EXT_shader_explicit_arithmetic_types_float16 : enable \n");
+
     // Enable all extensions needed for different types of input
     bool has_ssbo = false, has_ubo = false, has_img = false, has_texel = false,
          has_ext = false, has_nofmt = false;
@@ -597,6 +847,106 @@ static void generate_shaders(struct pl_dispatch *dp, struct pass *pass,
 #undef ADD
 #undef ADD_BSTR
 
+static bool ubo_arena_supported(const struct pl_dispatch *dp, size_t size)
+{
+    const struct pl_gpu *gpu = dp->gpu;
+    return (gpu->caps & PL_GPU_CAP_MAPPED_BUFFERS) &&
+           gpu->limits.align_ubo_offset &&
+           size <= gpu->limits.max_ubo_size;
+}
+
+// Sub-allocates `size` bytes from the uniform buffer arena, recycling the
+// next chunk in the ring if it's idle, or inserting a new one otherwise
+static struct ubo_chunk *ubo_arena_alloc(struct pl_dispatch *dp, size_t size,
+                                         size_t *out_offset)
+{
+    const struct pl_gpu *gpu = dp->gpu;
+    size = PL_ALIGN(size, gpu->limits.align_ubo_offset);
+
+    struct ubo_chunk *chunk = NULL;
+    if (dp->num_ubo_chunks) {
+        chunk = dp->ubo_chunks[dp->cur_ubo_chunk];
+        if (chunk->used + size <= chunk->buf->params.size)
+            goto done;
+
+        // Current chunk is exhausted, try moving on to the next one
+        int next = (dp->cur_ubo_chunk + 1) % dp->num_ubo_chunks;
+        chunk = dp->ubo_chunks[next];
+        if (size <= chunk->buf->params.size && !pl_buf_poll(gpu, chunk->buf, 0)) {
+            chunk->used = 0;
+            chunk->gen = ++dp->ubo_gen;
+            dp->cur_ubo_chunk = next;
+            goto done;
+        }
+    }
+
+    // All chunks are still in use, so grow the ring
+    size_t chunk_size = PL_MIN(UBO_CHUNK_SIZE, gpu->limits.max_ubo_size);
+    chunk = talloc_ptrtype(dp, chunk);
+    *chunk = (struct ubo_chunk) {
+        .gen = ++dp->ubo_gen,
+        .buf = pl_buf_create(gpu, &(struct pl_buf_params) {
+            .type = PL_BUF_UNIFORM,
+            .size = PL_MAX(chunk_size, size),
+            .host_mapped = true,
+        }),
+    };
+
+    if (!chunk->buf) {
+        PL_ERR(dp, "Failed creating uniform buffer arena chunk!");
+        talloc_free(chunk);
+        return NULL;
+    }
+
+    int idx = dp->num_ubo_chunks ? dp->cur_ubo_chunk + 1 : 0;
+    TARRAY_INSERT_AT(dp, dp->ubo_chunks, dp->num_ubo_chunks, idx, chunk);
+    dp->cur_ubo_chunk = idx;
+    PL_DEBUG(dp, "Grew uniform buffer arena to %d chunks", dp->num_ubo_chunks);
+
+done:
+    *out_offset = chunk->used;
+    chunk->used += size;
+    return chunk;
+}
+
+// Makes sure the pass's uniform buffer contents are uploaded and bound
+static bool update_pass_ubo(struct pl_dispatch *dp, struct pass *pass)
+{
+    if (!pass->ubo_data)
+        return true;
+
+    // Re-use the previous allocation if it's still valid
+    struct ubo_chunk *chunk = pass->ubo_chunk;
+    bool valid = chunk && chunk->gen == pass->ubo_gen;
+    if (pass->ubo_dirty || !valid) {
+        chunk = ubo_arena_alloc(dp, pass->ubo_size, &pass->ubo_offset);
+        if (!chunk)
+            return false;
+
+        memcpy(chunk->buf->data + pass->ubo_offset, pass->ubo_data, pass->ubo_size);
+        pass->ubo_chunk = chunk;
+        pass->ubo_gen = chunk->gen;
+        pass->ubo_dirty = false;
+    }
+
+    struct pl_desc_binding *db = &pass->run_params.desc_bindings[pass->ubo_index];
+    db->object = chunk->buf;
+    db->buf_offset = pass->ubo_offset;
+    return true;
+}
+
+static void ubo_write(struct pl_dispatch *dp, struct pass *pass, size_t offset,
+                      const void *data, size_t size)
+{
+    if (pass->ubo_data) {
+        memcpy(pass->ubo_data + offset, data, size);
+        pass->ubo_dirty = true;
+    } else {
+        pl_assert(pass->ubo);
+        pl_buf_write(dp->gpu, pass->ubo, offset, data, size);
+    }
+}
+
 static bool blend_equal(const struct pl_blend_params *a,
                         const struct pl_blend_params *b)
 {
@@ -673,6 +1023,16 @@ static struct pass *find_pass(struct pl_dispatch *dp, struct pl_shader *sh,
         }
     }
 
+    // Otherwise, try re-using a program compiled by another user of the
+    // shared cache. The pl_pass itself is never shared, since its per-use
+    // state (descriptor sets, UBOs etc.) is not thread-safe.
+    if (!params.cached_program && dp->cache &&
+        cache_find_program(dp->cache, sig, &params))
+    {
+        PL_TRACE(dp, "Re-using shared program with signature 0x%llx",
+                 (unsigned long long) sig);
+    }
+
     if (params.type == PL_PASS_RASTER) {
         assert(target);
         params.target_dummy = *target;
@@ -726,10 +1086,17 @@ static struct pass *find_pass(struct pl_dispatch *dp, struct pl_shader *sh,
             goto error;
     }
 
-    // Create and attach the UBO if necessary
-    int ubo_index = -1;
+    // Create and attach the UBO if necessary. If possible, it gets
+    // sub-allocated from the shared arena on every update instead
+    pass->ubo_index = -1;
     size_t ubo_size = sh_buf_desc_size(&pass->ubo_desc);
-    if (ubo_size) {
+    if (ubo_size && ubo_arena_supported(dp, ubo_size)) {
+        pass->ubo_size = ubo_size;
+        pass->ubo_data = talloc_zero_size(pass, ubo_size);
+        pass->ubo_dirty = true;
+        pass->ubo_index = res->num_descriptors;
+        sh_desc(sh, pass->ubo_desc); // object is bound at run time
+    } else if (ubo_size) {
         pass->ubo = pl_buf_create(dp->gpu, &(struct pl_buf_params) {
             .type = PL_BUF_UNIFORM,
             .size = ubo_size,
@@ -741,7 +1108,7 @@ static struct pass *find_pass(struct pl_dispatch *dp, struct pl_shader *sh,
             goto error;
         }
 
-        ubo_index = res->num_descriptors;
+        pass->ubo_index = res->num_descriptors;
         pass->ubo_desc.object = pass->ubo;
         sh_desc(sh, pass->ubo_desc);
     }
@@ -760,8 +1127,8 @@ static struct pass *find_pass(struct pl_dispatch *dp, struct pl_shader *sh,
 
     // Pre-fill the desc_binding for the UBO
     if (pass->ubo) {
-        pl_assert(ubo_index >= 0);
-        rparams->desc_bindings[ubo_index].object = pass->ubo;
+        pl_assert(pass->ubo_index >= 0);
+        rparams->desc_bindings[pass->ubo_index].object = pass->ubo;
     }
 
     // Create the push constants region
@@ -776,6 +1143,9 @@ static struct pass *find_pass(struct pl_dispatch *dp, struct pl_shader *sh,
         goto error;
     }
 
+    if (dp->cache)
+        cache_add_program(dp->cache, sig, &pass->pass->params);
+
     // fall through
 error:
     pass->ubo_desc = (struct pl_shader_desc) {0}; // contains temporary pointers
@@ -810,11 +1180,10 @@ static void update_pass_var(struct pl_dispatch *dp, struct pass *pass,
         break;
     }
     case PASS_VAR_UBO: {
-        pl_assert(pass->ubo);
         const size_t offset = pv->layout.offset;
         if (host_layout.stride == pv->layout.stride) {
             pl_assert(host_layout.size == pv->layout.size);
-            pl_buf_write(dp->gpu, pass->ubo, offset, sv->data, host_layout.size);
+            ubo_write(dp, pass, offset, sv->data, host_layout.size);
         } else {
             // Coalesce strided UBO write into a single pl_buf_write to avoid
             // unnecessary synchronization overhead by assembling the correctly
@@ -829,7 +1198,7 @@ static void update_pass_var(struct pl_dispatch *dp, struct pass *pass,
                 src += host_layout.stride;
                 dst += pv->layout.stride;
             }
-            pl_buf_write(dp->gpu, pass->ubo, offset, tmp, pv->layout.size);
+            ubo_write(dp, pass, offset, tmp, pv->layout.size);
         }
         break;
     }
@@ -937,6 +1306,66 @@ static void translate_compute_shader(struct pl_dispatch *dp,
     sh->res.output = PL_SHADER_SIG_NONE;
 }
 
+static void stats_update(double *avg, uint64_t num, uint64_t value)
+{
+    *avg += (value - *avg) / PL_MIN(num, STATS_WINDOW);
+}
+
+static void update_description(struct pl_dispatch *dp, struct pass *pass,
+                               const struct pl_shader *sh)
+{
+    struct bstr *desc = &dp->tmp[TMP_MAIN];
+    desc->len = 0;
+    for (int i = 0; i < sh->num_steps; i++) {
+        if (i > 0)
+            bstr_xappend(dp, desc, bstr0(", "));
+        bstr_xappend(dp, desc, bstr0(sh->steps[i]));
+    }
+
+    if (!desc->len)
+        bstr_xappend(dp, desc, bstr0("(unnamed)"));
+
+    // The description may vary even between shaders with identical signatures
+    if (!pass->description || strcmp(pass->description, desc->start) != 0) {
+        talloc_free(pass->description);
+        pass->description = talloc_strdup(pass, desc->start);
+    }
+}
+
+// Runs the pass, and also records the statistics for it if enabled
+static void run_pass(struct pl_dispatch *dp, const struct pl_shader *sh,
+                     struct pass *pass)
+{
+    const struct pl_gpu *gpu = dp->gpu;
+    struct pl_pass_run_params *rparams = &pass->run_params;
+    if (!dp->stats) {
+        pl_pass_run(gpu, rparams);
+        return;
+    }
+
+    // Collect the (delayed) GPU timings of previous runs
+    uint64_t ns;
+    while ((ns = pl_timer_query(gpu, pass->timer)))
+        stats_update(&pass->gpu_time, ++pass->num_gpu_times, ns);
+
+    update_description(dp, pass, sh);
+
+    // User-provided timers take priority
+    if (!pass->timer)
+        pass->timer = pl_timer_create(gpu);
+    if (!rparams->timer)
+        rparams->timer = pass->timer;
+
+    uint64_t start = pl_clock_ns();
+    pl_pass_run(gpu, rparams);
+    uint64_t end = pl_clock_ns();
+
+    pass->num_runs++;
+    if (sh->begin_ns)
+        stats_update(&pass->cpu_setup_time, pass->num_runs, start - sh->begin_ns);
+    stats_update(&pass->cpu_run_time, pass->num_runs, end - start);
+}
+
 bool pl_dispatch_finish(struct pl_dispatch *dp, const struct pl_dispatch_params *params)
 {
     struct pl_shader *sh = *params->shader;
@@ -1036,6 +1465,8 @@ bool pl_dispatch_finish(struct pl_dispatch *dp, const struct pl_dispatch_params
     rparams->num_var_updates = 0;
     for (int i = 0; i < res->num_variables; i++)
         update_pass_var(dp, pass, &sh->variables[i], &pass->vars[i]);
+    if (!update_pass_ubo(dp, pass))
+        goto error;
 
     // Update the vertex data
     if (rparams->vertex_data) {
@@ -1073,7 +1504,7 @@ bool pl_dispatch_finish(struct pl_dispatch *dp, const struct pl_dispatch_params
     // Dispatch the actual shader
     rparams->target = params->target;
     rparams->timer = params->timer;
-    pl_pass_run(dp->gpu, &pass->run_params);
+    run_pass(dp, sh, pass);
     ret = true;
 
 error:
@@ -1141,6 +1572,8 @@ bool pl_dispatch_compute(struct pl_dispatch *dp,
     rparams->num_var_updates = 0;
     for (int i = 0; i < res->num_variables; i++)
         update_pass_var(dp, pass, &sh->variables[i], &pass->vars[i]);
+    if (!update_pass_ubo(dp, pass))
+        goto error;
 
     // Update the dispatch size
     int groups = 1;
@@ -1163,7 +1596,7 @@ bool pl_dispatch_compute(struct pl_dispatch *dp,
 
     // Dispatch the actual shader
     rparams->timer = params->timer;
-    pl_pass_run(dp->gpu, &pass->run_params);
+    run_pass(dp, sh, pass);
     ret = true;
 
 error:
@@ -1181,12 +1614,48 @@ void pl_dispatch_abort(struct pl_dispatch *dp, struct pl_shader **psh)
     if (!sh)
         return;
 
+    // Release the shader's reference to the arena, so pooled shaders don't
+    // keep the arenas of previous frames alive
+    talloc_ref_deref(&sh->tmp);
+    sh->tmp = NULL;
+    sh->arena = NULL;
+
     // Re-add the shader to the internal pool of shaders
     TARRAY_APPEND(dp, dp->shaders, dp->num_shaders, sh);
     *psh = NULL;
 }
 
 // Stuff related to caching
+void pl_dispatch_set_stats(struct pl_dispatch *dp, bool enable)
+{
+    dp->stats = enable;
+}
+
+int pl_dispatch_query_stats(struct pl_dispatch *dp,
+                            const struct pl_dispatch_pass_stats **out)
+{
+    TARRAY_RESIZE(dp, dp->stats_tmp, dp->num_passes);
+
+    int num = 0;
+    for (int i = 0; i < dp->num_passes; i++) {
+        const struct pass *pass = dp->passes[i];
+        if (!pass->num_runs)
+            continue;
+
+        dp->stats_tmp[num++] = (struct pl_dispatch_pass_stats) {
+            .signature = pass->signature,
+            .description = pass->description,
+            .num_runs = pass->num_runs,
+            .gpu_time = pass->gpu_time,
+            .cpu_setup_time = pass->cpu_setup_time,
+            .cpu_run_time = pass->cpu_run_time,
+        };
+    }
+
+    *out = dp->stats_tmp;
+    return num;
+}
+
 static const char cache_magic[] = {'P', 'L', 'D', 'P'};
 static const uint32_t cache_version = 1;
 
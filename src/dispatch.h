@@ -30,6 +30,26 @@ struct pl_shader *pl_dispatch_begin_ex(struct pl_dispatch *dp, bool unique);
 // ensure that the "same" calls to pl_dispatch_begin_ex end up creating shaders
 // with the same identifier. Failing to follow this rule means shader caching,
 // as well as features such as temporal dithering, will not work correctly.
+// This also starts a new arena for the temporary memory used by generated
+// shaders, sized according to the previous frame's usage.
 //
 // This is a private API since it's only relevant if using `pl_dispatch_begin_ex`
 void pl_dispatch_reset_frame(struct pl_dispatch *dp);
+
+// Sets the `pl_shader_params.half_precision` used for all shaders created by
+// `pl_dispatch_begin(_ex)` from now on. Defaults to false.
+//
+// This is a private API, used by pl_renderer to apply its render params.
+void pl_dispatch_set_half_precision(struct pl_dispatch *dp, bool enable);
+
+// Internal API for sharing generated LUT contents via a `pl_dispatch_cache`.
+// The `key` must uniquely identify the contents (including their size).
+//
+// Looks up a LUT in the cache and copies its contents to `out`. Returns false
+// if not found.
+bool pl_dispatch_cache_get_lut(struct pl_dispatch_cache *cache, uint64_t key,
+                               void *out, size_t size);
+
+// Adds a copy of newly generated LUT contents to the cache.
+void pl_dispatch_cache_add_lut(struct pl_dispatch_cache *cache, uint64_t key,
+                               const void *data, size_t size);
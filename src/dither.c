@@ -28,6 +28,7 @@
 #include <string.h>
 #include <assert.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "common.h"
 
@@ -116,32 +117,24 @@ static void makegauss(struct ctx *k, unsigned int sizeb)
     }
 }
 
-static void setbit(struct ctx *k, index_t c)
-{
-    if (k->calcmat[c])
-        return;
-    k->calcmat[c] = true;
-    uint64_t *m = k->gaussmat;
-    uint64_t *me = k->gaussmat + k->size2;
-    uint64_t *g = k->gauss + WRAP_SIZE2(k, k->gauss_middle + k->size2 - c);
-    uint64_t *ge = k->gauss + k->size2;
-    while (g < ge)
-        *m++ += *g++;
-    g = k->gauss;
-    while (m < me)
-        *m++ += *g++;
-}
+// Adds the gaussian centered at `c` to the energy matrix `gaussmat`. Since
+// this has to touch every cell anyway, the minimum energy among the cells
+// not yet set is tracked in the same pass (rather than doing a separate
+// linear scan afterwards), with all cells attaining it stored in `randomat`.
+struct minimum {
+    uint64_t val;
+    index_t num;
+};
 
-static index_t getmin(struct ctx *k)
+static void accumulate(struct ctx *k, index_t start, index_t end,
+                       const uint64_t *g, struct minimum *res)
 {
-    uint64_t min = UINT64_MAX;
-    index_t resnum = 0;
-    unsigned int size2 = k->size2;
-    for (index_t c = 0; c < size2; c++) {
-        if (k->calcmat[c])
-            continue;
-        uint64_t total = k->gaussmat[c];
-        if (total <= min) {
+    uint64_t *m = k->gaussmat;
+    uint64_t min = res->val;
+    index_t resnum = res->num;
+    for (index_t c = start; c < end; c++) {
+        uint64_t total = m[c] += *g++;
+        if (total <= min && !k->calcmat[c]) {
             if (total != min) {
                 min = total;
                 resnum = 0;
@@ -149,30 +142,45 @@ static index_t getmin(struct ctx *k)
             k->randomat[resnum++] = c;
         }
     }
-    assert(resnum > 0);
-    if (resnum == 1)
-        return k->randomat[0];
-    if (resnum == size2)
-        return size2 / 2;
-    return k->randomat[rand() % resnum];
+
+    res->val = min;
+    res->num = resnum;
+}
+
+static index_t setbit(struct ctx *k, index_t c)
+{
+    assert(!k->calcmat[c]);
+    k->calcmat[c] = true;
+
+    struct minimum res = { .val = UINT64_MAX };
+    index_t split = k->size2 - WRAP_SIZE2(k, k->gauss_middle + k->size2 - c);
+    accumulate(k, 0, split, k->gauss + k->size2 - split, &res);
+    accumulate(k, split, k->size2, k->gauss, &res);
+    return res.num;
 }
 
 static void makeuniform(struct ctx *k)
 {
     unsigned int size2 = k->size2;
+    index_t resnum = size2; // all cells start out with equal energy
     for (index_t c = 0; c < size2; c++) {
-        index_t r = getmin(k);
-        setbit(k, r);
+        index_t r;
+        assert(resnum > 0);
+        if (resnum == 1) {
+            r = k->randomat[0];
+        } else if (resnum == size2) {
+            r = size2 / 2;
+        } else {
+            r = k->randomat[rand() % resnum];
+        }
+
+        resnum = setbit(k, r);
         k->unimat[r] = c;
     }
 }
 
-void pl_generate_blue_noise(float *data, int size)
+static void generate_blue_noise(float *data, int shift)
 {
-    pl_assert(size > 0);
-    int shift = PL_LOG2(size);
-
-    pl_assert((1 << shift) == size);
     struct ctx *k = talloc_zero(NULL, struct ctx);
     makegauss(k, shift);
     makeuniform(k);
@@ -183,3 +191,25 @@ void pl_generate_blue_noise(float *data, int size)
     }
     talloc_free(k);
 }
+
+// Generated matrices are cached for the lifetime of the process, since they
+// don't depend on anything but the size
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static float *cache[MAX_SIZEB + 1];
+
+void pl_generate_blue_noise(float *data, int size)
+{
+    pl_assert(size > 0);
+    int shift = PL_LOG2(size);
+
+    pl_assert((1 << shift) == size && shift <= MAX_SIZEB);
+    pthread_mutex_lock(&cache_lock);
+    if (!cache[shift]) {
+        float *mat = talloc_array(NULL, float, size * size);
+        generate_blue_noise(mat, shift);
+        cache[shift] = mat;
+    }
+
+    memcpy(data, cache[shift], size * size * sizeof(float));
+    pthread_mutex_unlock(&cache_lock);
+}
@@ -35,6 +35,7 @@ const struct pl_gpu_dummy_params pl_gpu_dummy_default_params = {
         .max_pushc_size     = SIZE_MAX,
         .max_xfer_size      = SIZE_MAX,
         .max_ubo_size       = SIZE_MAX,
+        .align_ubo_offset   = 1,
         .max_ssbo_size      = SIZE_MAX,
         .max_buffer_texels  = UINT64_MAX,
         .min_gather_offset  = INT16_MIN,
@@ -38,6 +38,7 @@
 
 #include "common.h"
 #include "context.h"
+#include "filters.h"
 
 bool pl_filter_function_eq(const struct pl_filter_function *a,
                            const struct pl_filter_function *b)
@@ -99,9 +100,7 @@ double pl_filter_sample(const struct pl_filter_config *c, double x)
     return k < 0 ? (1 - c->clamp) * k : k;
 }
 
-// Calculate a single filter row of a 1D filter, for a given phase value /
-// subpixel offset `offset`. Writes exactly f->row_size values to *out.
-static void compute_row(struct pl_filter *f, double offset, float *out)
+void pl_filter_compute_row(const struct pl_filter *f, double offset, float *out)
 {
     pl_assert(f->row_size > 0);
     double sum = 0;
@@ -172,8 +171,8 @@ const struct pl_filter *pl_filter_generate(struct pl_context *ctx,
         // Compute a 2D array indexed by the subpixel position
         weights = talloc_zero_array(f, float, params->lut_entries * f->row_stride);
         for (int i = 0; i < params->lut_entries; i++) {
-            compute_row(f, i / (double)(params->lut_entries - 1),
-                        weights + f->row_stride * i);
+            pl_filter_compute_row(f, i / (double)(params->lut_entries - 1),
+                                  weights + f->row_stride * i);
         }
     }
 
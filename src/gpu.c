@@ -60,6 +60,7 @@ void pl_gpu_print_info(const struct pl_gpu *gpu, enum pl_log_level lev)
     LOG("zu", max_pushc_size);
     LOG("zu", max_xfer_size);
     LOG("zu", max_ubo_size);
+    LOG("zu", align_ubo_offset);
     LOG("zu", max_ssbo_size);
     LOG(PRIu64, max_buffer_texels);
     LOG(PRId16, min_gather_offset);
@@ -1117,11 +1118,17 @@ void pl_pass_run(const struct pl_gpu *gpu, const struct pl_pass_run_params *para
         case PL_DESC_BUF_UNIFORM: {
             const struct pl_buf *buf = db.object;
             require(buf->params.type == PL_BUF_UNIFORM);
+            if (db.buf_offset) {
+                size_t align = gpu->limits.align_ubo_offset;
+                require(align && db.buf_offset % align == 0);
+                require(db.buf_offset < buf->params.size);
+            }
             break;
         }
         case PL_DESC_BUF_STORAGE: {
             const struct pl_buf *buf = db.object;
             require(buf->params.type == PL_BUF_STORAGE);
+            require(!db.buf_offset);
             break;
         }
         case PL_DESC_BUF_TEXEL_UNIFORM: {
@@ -118,4 +118,69 @@ size_t pl_dispatch_save(struct pl_dispatch *dp, uint8_t *out_cache);
 // shaders that are not yet present in the `pl_dispatch`.
 void pl_dispatch_load(struct pl_dispatch *dp, const uint8_t *cache);
 
+// Enables or disables the collection of per-pass statistics. While enabled,
+// every dispatched pass automatically gets a timer attached (unless the user
+// provides their own), and the CPU time spent on it is measured. This adds a
+// small amount of overhead, so it's disabled by default.
+void pl_dispatch_set_stats(struct pl_dispatch *dp, bool enable);
+
+struct pl_dispatch_pass_stats {
+    uint64_t signature;      // shader signature of this pass
+    const char *description; // human-readable description of the operations
+                             // performed by this pass (e.g. "deband, polar
+                             // upscale 1080->2160"), as of the last run
+    uint64_t num_runs;       // number of runs recorded so far
+
+    // Rolling averages over the most recent runs, in nanoseconds. `gpu_time`
+    // is 0 if no timer results are available (yet), since these are reported
+    // with some delay. `cpu_setup_time` is the wall time from beginning the
+    // shader up to running the pass, including shader generation and (if
+    // needed) compilation. `cpu_run_time` is the time spent in `pl_pass_run`.
+    uint64_t gpu_time;
+    uint64_t cpu_setup_time;
+    uint64_t cpu_run_time;
+};
+
+// Returns the statistics of all passes that were run while statistics were
+// enabled, via an internal array which remains valid until the next call to
+// any pl_dispatch function. Returns the number of entries in `*out`.
+int pl_dispatch_query_stats(struct pl_dispatch *dp,
+                            const struct pl_dispatch_pass_stats **out);
+
+// A shared cache of compiled shader programs and generated LUT contents, which
+// can be attached to any number of `pl_dispatch` (or `pl_renderer`) instances
+// using the same `pl_gpu`. This allows identically configured dispatchers to
+// skip recompiling the same shaders (via `pl_pass_params.cached_program`) and
+// regenerating expensive LUTs. (Currently, only the dither matrices are shared
+// this way. Filter LUTs are cheap to fill once the filter is generated, and
+// 3DLUTs are not shared.)
+//
+// Note that GPU objects themselves (passes, textures, buffers) are never
+// shared, and each `pl_dispatch` still creates its own. So attaching a cache
+// does not change the thread safety rules of the users: the cache itself is
+// internally synchronized, meaning that attached users may live on different
+// threads, as long as the `pl_gpu` permits this (e.g.
+// `pl_vulkan_params.thread_safe`) and each `pl_dispatch` or `pl_renderer` is
+// only used by one thread at a time.
+//
+// The cache is reference counted, and freed once the last reference is
+// released.
+struct pl_dispatch_cache;
+
+// Creates a new shared cache, with an initial reference count of 1.
+struct pl_dispatch_cache *pl_dispatch_cache_create(struct pl_context *ctx,
+                                                   const struct pl_gpu *gpu);
+
+// Acquires an additional reference to the cache. Returns `cache`.
+struct pl_dispatch_cache *pl_dispatch_cache_ref(struct pl_dispatch_cache *cache);
+
+// Releases a reference to the cache, and sets `*cache` to NULL.
+void pl_dispatch_cache_unref(struct pl_dispatch_cache **cache);
+
+// Attaches a shared cache to this dispatch object, acquiring a reference to
+// it. Passing NULL detaches the current cache (if any). This only affects
+// objects created after the call, so it's best done before first use.
+void pl_dispatch_set_cache(struct pl_dispatch *dp,
+                           struct pl_dispatch_cache *cache);
+
 #endif // LIBPLACEBO_DISPATCH_H
@@ -27,8 +27,11 @@ void pl_generate_bayer_matrix(float *data, int size);
 // `size` must be a positive power of two no larger than 256. The resulting
 // texture will be roughly uniformly distributed within the range [0,1).
 //
-// Note: This function is very, *very* slow for large sizes. Generating a
-// dither matrix with size 256 can take several seconds on a modern processor.
+// Note: This function is very slow for large sizes. Generating a dither
+// matrix with size 256 can take several seconds on a modern processor. The
+// result is cached for the lifetime of the process, so only the first call
+// for any given size pays this cost (and all calls for the same size return
+// the same matrix).
 void pl_generate_blue_noise(float *data, int size);
 
 #endif // LIBPLACEBO_DITHER_H_
@@ -49,6 +49,7 @@ enum {
     PL_GPU_CAP_MAPPED_BUFFERS   = 1 << 3, // supports host-mapped buffers
     PL_GPU_CAP_BLITTABLE_1D_3D  = 1 << 4, // supports blittable 1D/3D textures
     PL_GPU_CAP_SUBGROUPS        = 1 << 5, // supports subgroups
+    PL_GPU_CAP_FLOAT16          = 1 << 6, // supports 16-bit float arithmetic
 
     // Note on subgroup support: PL_GPU_CAP_SUBGROUPS implies subgroup support
     // for both fragment and compute shaders, but not necessarily any other
@@ -59,6 +60,11 @@ enum {
     // - arithmetic
     // - ballot
     // - shuffle
+    //
+    // Note on float16 support: PL_GPU_CAP_FLOAT16 implies support for the
+    // `float16_t` types from GL_EXT_shader_explicit_arithmetic_types_float16,
+    // which pl_dispatch enables automatically. This is unrelated to the
+    // `mediump` precision qualifiers of GLSL ES, which are always available.
 };
 
 // Some `pl_gpu` operations allow sharing GPU resources with external APIs -
@@ -112,6 +118,7 @@ struct pl_gpu_limits {
     size_t max_pushc_size;      // maximum `push_constants_size`
     size_t max_xfer_size;       // maximum size of a PL_BUF_TEX_TRANSFER
     size_t max_ubo_size;        // maximum size of a PL_BUF_UNIFORM
+    size_t align_ubo_offset;    // required alignment of UBO `buf_offset`
     size_t max_ssbo_size;       // maximum size of a PL_BUF_STORAGE
     uint64_t max_buffer_texels; // maximum texels in a PL_BUF_TEXEL_*
     int16_t min_gather_offset;  // minimum `textureGatherOffset` offset
@@ -969,6 +976,12 @@ void pl_pass_destroy(const struct pl_gpu *gpu, const struct pl_pass **pass);
 
 struct pl_desc_binding {
     const void *object; // pl_* object with type corresponding to pl_desc_type
+
+    // For PL_DESC_BUF_UNIFORM, the byte offset into the buffer at which the
+    // bound range begins. The range extends until the end of the buffer. Must
+    // be a multiple of `limits.align_ubo_offset`, and 0 for all other types
+    // of descriptors, or if that limit is 0 (unsupported).
+    size_t buf_offset;
 };
 
 struct pl_var_update {
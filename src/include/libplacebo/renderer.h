@@ -19,6 +19,7 @@
 #define LIBPLACEBO_RENDERER_H_
 
 #include <libplacebo/colorspace.h>
+#include <libplacebo/dispatch.h>
 #include <libplacebo/filters.h>
 #include <libplacebo/gpu.h>
 #include <libplacebo/shaders/av1.h>
@@ -45,6 +46,18 @@ size_t pl_renderer_save(struct pl_renderer *rr, uint8_t *out_cache);
 // `pl_dispatch_load` for more information.
 void pl_renderer_load(struct pl_renderer *rr, const uint8_t *cache);
 
+// Enables the collection of per-pass statistics, and queries the results.
+// See `pl_dispatch_set_stats` and `pl_dispatch_query_stats`.
+void pl_renderer_set_stats(struct pl_renderer *rr, bool enable);
+int pl_renderer_query_stats(struct pl_renderer *rr,
+                            const struct pl_dispatch_pass_stats **out);
+
+// Attaches a shared object cache to this renderer, allowing multiple
+// renderers on the same `pl_gpu` to share their compiled shaders and LUTs.
+// See `pl_dispatch_set_cache` for more information.
+void pl_renderer_set_cache(struct pl_renderer *rr,
+                           struct pl_dispatch_cache *cache);
+
 // Represents the options used for rendering. These affect the quality of
 // the result.
 struct pl_render_params {
@@ -142,6 +155,44 @@ struct pl_render_params {
     // `pl_sample_filter_params` for more information.
     float polar_cutoff;
 
+    // If nonzero, large downscales are split into two steps: the source is
+    // first repeatedly halved using 2x2 box filtering (one bilinear texture
+    // fetch per pixel), until the remaining downscaling ratio in each
+    // direction is at most this value, and only then is the main scaler run.
+    // Higher values preserve more quality (since the box filter is only a
+    // crude anti-aliasing filter), lower values are faster. Values below 2.0
+    // are treated as 2.0. Has no effect unless the intermediate FBO format is
+    // linearly sampleable.
+    //
+    // Dramatically speeds up downscaling by large factors (e.g. thumbnails),
+    // since the cost of the main scaler otherwise grows with the ratio.
+    float downscale_pyramid_ratio;
+
+    // Merges adjacent taps of separated scalers into bilinear texture
+    // fetches where possible. See `pl_sample_filter_params.merge_taps`.
+    //
+    // Speeds up separable scaling, especially when downscaling.
+    bool merge_scaler_taps;
+
+    // Performs some of the intermediate arithmetic in half (16-bit) precision
+    // where this is deemed acceptable. See `pl_shader_params.half_precision`.
+    //
+    // Speeds up scaling and debanding on GPUs with fast fp16 arithmetic,
+    // typically mobile and integrated GPUs.
+    bool half_precision;
+
+    // Samples subsampled (e.g. chroma) planes straight from their native
+    // resolution to the output resolution, instead of first upscaling them to
+    // the resolution of the reference plane and then scaling the combined
+    // image again. Only takes effect when the image needs scaling, nothing
+    // depends on the image at its source resolution (overlays or hooks), and
+    // no linearization or sigmoidization would be performed for scaling (see
+    // `disable_linear_scaling` and `sigmoid_params`).
+    //
+    // Avoids resampling the chroma twice, as well as the full-size
+    // intermediate texture for the upsampled chroma planes.
+    bool direct_chroma_scaling;
+
     // Skips dispatching the high-quality scalers for overlay textures, and
     // always falls back to built-in GPU samplers. Note: The scalers are
     // already disabled if the overlay texture does not need to be scaled.
@@ -153,6 +204,21 @@ struct pl_render_params {
     // params->peak_detect_params is set and the source is HDR).
     bool allow_delayed_peak_detect;
 
+    // If nonzero, the color mapping pipeline applied to the output (tone
+    // mapping, gamut mapping, color blindness simulation and the associated
+    // (de)linearization) is evaluated on the GPU into a 3DLUT with this many
+    // entries per dimension, and then applied using a single interpolated
+    // texture lookup per pixel. The LUT is only regenerated when the inputs
+    // change, or when the detected peak changes by more than about 1% (as
+    // read back asynchronously, while peak detection is active). This
+    // introduces interpolation errors, mainly in the shadows, but can
+    // significantly speed up HDR->SDR conversion on slow GPUs. A value of 33
+    // is a good starting point. Ignored when a 3DLUT is already in use (e.g.
+    // due to ICC profiles), when scaling in linear light, or for linear light
+    // source content, since the LUT only covers the range [0,1] of the source
+    // encoding. Defaults to 0.
+    int color_lut_size;
+
     // --- Performance tuning / debugging options
     // These may affect performance or may make debugging problems easier,
     // but shouldn't have any effect on the quality.
@@ -315,6 +381,23 @@ struct pl_image {
     const struct pl_overlay *overlays;
     int num_overlays;
 
+    // An optional list of regions of the image which changed since the last
+    // time it was rendered, relative to the reference dimensions (like
+    // `src_rect`). If set, the renderer assumes that the target already
+    // contains the result of rendering the previous version of this image
+    // with otherwise identical parameters, and only re-renders the parts of
+    // `dst_rect` that can be affected by these regions (taking into account
+    // the radius of the scaling filters). The rest of the target is left
+    // untouched.
+    //
+    // This is ignored (i.e. the whole image is re-rendered) whenever it's not
+    // possible, e.g. when using overlays, hooks, debanding, error diffusion,
+    // HDR peak detection or the downscale pyramid, or when the affected parts
+    // of the output add up to at least the size of the whole `dst_rect`
+    // anyway. Overlapping damage rects are merged before rendering.
+    const struct pl_rect2d *damage_rects;
+    int num_damage_rects;
+
     // Note on subsampling and plane correspondence: All planes belonging to
     // the same image will only be streched by an integer multiple (or inverse
     // thereof) in order to match the reference dimensions of this image. For
@@ -55,6 +55,18 @@ struct pl_shader_params {
     // determine the effective GLSL mode and capabilities. If `gpu` is also
     // set, then this overrides `gpu->glsl`.
     struct pl_glsl_desc glsl;
+
+    // If true, shaders may perform some of their intermediate arithmetic in
+    // 16-bit (half) precision, where the resulting loss of precision is
+    // acceptable (e.g. accumulating filter taps, or debanding). This can be
+    // significantly faster on mobile and integrated GPUs. On GLSL ES, this
+    // uses `mediump` precision qualifiers. On Vulkan, it uses the `float16_t`
+    // types, and requires `gpu` with PL_GPU_CAP_FLOAT16. Ignored otherwise.
+    //
+    // Note: pl_dispatch takes care of enabling the required GLSL extension.
+    // Users compiling the resulting shaders themselves must enable
+    // GL_EXT_shader_explicit_arithmetic_types_float16 on their own.
+    bool half_precision;
 };
 
 // Creates a new, blank, mutable pl_shader object.
@@ -70,6 +70,13 @@ struct pl_av1_grain_params {
     int components;
     int component_mapping[4];       // same as `struct pl_plane`
 
+    // If true, the grain tables are generated on the GPU by an auxiliary
+    // compute pass whenever the grain data changes (e.g. every frame for a
+    // new `grain_seed`), instead of being generated on the CPU and uploaded.
+    // This requires compute shaders, and the shader to have been created by
+    // `pl_dispatch_begin`. Falls back to CPU generation otherwise.
+    bool gpu_generate;
+
     // Notes for `repr`:
     //  - repr->bits affects the rounding for grain generation
     //  - repr->levels affects whether or not we clip to full range or not
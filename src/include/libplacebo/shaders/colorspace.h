@@ -111,6 +111,22 @@ struct pl_peak_detect_params {
     // by this amount, as a percentage of the actual measured peak. If left
     // as 0.0, this logic is disabled. The default value is 0.05.
     float overshoot_margin;
+
+    // If set to a value N > 1, only every N-th pixel (in each direction) is
+    // measured. For `pl_shader_detect_peak_tex`, this reduces the number of
+    // shader invocations by a factor of N^2. For `pl_shader_detect_peak`, all
+    // pixels are still rendered, but only every N-th invocation contributes
+    // to the (contended) work group atomics. Very small highlights may be
+    // missed as a result. The default value is 0 (no subsampling).
+    int sample_stride;
+
+    // If set to a value in the range (0, 100], the detected peak is taken as
+    // this percentile of the per-pixel brightness distribution instead of
+    // the absolute maximum, which makes it robust against small specular
+    // highlights. For example, 99.9 ignores the brightest 0.1% of the image.
+    // This is measured using a log-luminance histogram, so the result is
+    // quantized to a few percent. The default value is 0 (disabled).
+    float percentile;
 };
 
 extern const struct pl_peak_detect_params pl_peak_detect_default_params;
@@ -134,9 +150,28 @@ bool pl_shader_detect_peak(struct pl_shader *sh,
                            struct pl_shader_obj **state,
                            const struct pl_peak_detect_params *params);
 
-// After dispatching the above shader, this function *may* be used to read out
-// the detected `sig_peak` and `sig_avg` directly. If the shader has never been
-// dispatched yet, i.e. no information is available, this will return false.
+// Like `pl_shader_detect_peak`, but instead of measuring the colors passing
+// through the shader, this samples the region `rect` of `tex` directly
+// (subsampled according to `params->sample_stride`; NULL measures the
+// entire texture) and generates a standalone compute shader, which
+// must be dispatched with `pl_dispatch_compute`. The number of invocations
+// (`width` and `height`) can be obtained from `pl_shader_output_size`. The
+// shader's color output is meaningless and should be ignored. `sh` must be
+// a fresh shader. The texture must be sampleable, and its contents must
+// be in the decoded RGB form described by `csp`.
+//
+// Since it runs in its own pass, this is useful for decoupling the
+// (comparatively expensive) peak detection from the main rendering shader.
+bool pl_shader_detect_peak_tex(struct pl_shader *sh, const struct pl_tex *tex,
+                               const struct pl_rect2d *rect,
+                               struct pl_color_space csp,
+                               struct pl_shader_obj **state,
+                               const struct pl_peak_detect_params *params);
+
+// After dispatching either of the above shaders, this function *may* be used
+// to read out the detected `sig_peak` and `sig_avg` directly. If the shader
+// has never been dispatched yet, i.e. no information is available, this will
+// return false.
 //
 // Note: This function will block until the shader object is no longer in use
 // by the GPU, so its use should be avoided due to performance reasons. This
@@ -146,6 +181,14 @@ bool pl_shader_detect_peak(struct pl_shader *sh,
 bool pl_get_detected_peak(const struct pl_shader_obj *state,
                           float *out_peak, float *out_avg);
 
+// Non-blocking variant of `pl_get_detected_peak`. Each call schedules an
+// asynchronous readback of the current state, and returns the most recent
+// result which has already finished transferring, so the results lag behind
+// the GPU by a frame or two. Returns false if no result is available yet.
+// This function never blocks, so it may be called once per frame.
+bool pl_poll_detected_peak(const struct pl_shader_obj *state,
+                           float *out_peak, float *out_avg);
+
 // A collection of various tone mapping algorithms supported by libplacebo.
 enum pl_tone_mapping_algorithm {
     // Performs no tone-mapping, just clips out-of-gamut colors. Retains perfect
@@ -246,6 +289,18 @@ struct pl_color_map_params {
     // If left unset, defaults to 1.0, which corresponds to no boost.
     float max_boost;
 
+    // If nonzero, the tone mapping curve is pre-computed into a 1D LUT of
+    // this many entries, which replaces the per-pixel evaluation of the curve
+    // by a single (interpolated) texture lookup per channel. The LUT is only
+    // regenerated when the inputs to the curve change. This requires a state
+    // object (see `pl_shader_color_map_ex`). When peak detection is in use,
+    // the LUT is generated from the most recent detected values that were
+    // read back, rounded to steps of about 1% (so the curve may lag behind
+    // the detected peak by a few frames), and the curve is evaluated directly
+    // until the first values are available. A value of 256 is recommended.
+    // Defaults to 0 (disabled).
+    int tone_mapping_lut_size;
+
     // If true, enables the gamut warning feature. This will visibly highlight
     // all out-of-gamut colors (by inverting them), if they would have been
     // clipped as a result of gamut or tone mapping.
@@ -283,6 +338,18 @@ void pl_shader_color_map(struct pl_shader *sh,
                          struct pl_shader_obj **peak_detect_state,
                          bool prelinearized);
 
+// Like `pl_shader_color_map`, but additionally takes a state object used to
+// hold the pre-computed tone mapping curve (see `tone_mapping_lut_size`).
+// Like with peak detection, the same state object should be re-used for
+// successive frames. `tone_map_state` may be NULL, in which case this is
+// identical to `pl_shader_color_map`.
+void pl_shader_color_map_ex(struct pl_shader *sh,
+                            const struct pl_color_map_params *params,
+                            struct pl_color_space src, struct pl_color_space dst,
+                            struct pl_shader_obj **peak_detect_state,
+                            struct pl_shader_obj **tone_map_state,
+                            bool prelinearized);
+
 // Applies a set of cone distortion parameters to `vec4 color` in a given color
 // space. This can be used to simulate color blindness. See `pl_cone_params`
 // for more information.
@@ -329,6 +396,14 @@ struct pl_dither_params {
     // artifacts by perturbing the dithering matrix per frame.
     // Warning: This can cause nasty aliasing artifacts on some LCD screens.
     bool temporal;
+
+    // If set, `pl_renderer` dithers using error diffusion with this kernel
+    // instead, which is run as a separate compute pass on the final output
+    // (see `pl_shader_error_diffusion`). This gives better compression
+    // efficiency when encoding to low bit depths, at a higher cost. `method`
+    // is used as a fallback if error diffusion is unsupported. Ignored by
+    // `pl_shader_dither`.
+    const struct pl_error_diffusion_kernel *error_diffusion;
 };
 
 extern const struct pl_dither_params pl_dither_default_params;
@@ -354,6 +429,49 @@ void pl_shader_dither(struct pl_shader *sh, int new_depth,
                       struct pl_shader_obj **dither_state,
                       const struct pl_dither_params *params);
 
+// Describes an error diffusion kernel. Only kernels which diffuse the error
+// to the next pixel and the three adjacent pixels of the next row are
+// supported, which allows processing rows in parallel.
+struct pl_error_diffusion_kernel {
+    const char *name; // short name, e.g. for display in menus
+
+    // The weights given to the pixel to the right, and to the pixels below
+    // (left), below, and below (right) of the current pixel, respectively.
+    // These are divided by `divisor`.
+    int right;
+    int below_left, below, below_right;
+    int divisor;
+};
+
+extern const struct pl_error_diffusion_kernel pl_error_diffusion_floyd_steinberg;
+extern const struct pl_error_diffusion_kernel pl_error_diffusion_sierra_lite;
+
+struct pl_error_diffusion_params {
+    // Texture containing the colors to dither. Must be sampleable.
+    const struct pl_tex *input_tex;
+
+    // Texture to write the dithered colors to. Must be storable, and at
+    // least as large as `input_tex`.
+    const struct pl_tex *output_tex;
+
+    // The bit depth to dither to. Must be in the range [1, 16].
+    int new_depth;
+
+    // The error diffusion kernel to use. If left as NULL, this defaults to
+    // &pl_error_diffusion_floyd_steinberg.
+    const struct pl_error_diffusion_kernel *kernel;
+};
+
+// Dither the entirety of `input_tex` to a lower bit depth using error
+// diffusion, storing the result in `output_tex`. This is a compute shader
+// consisting of a single work group, which processes rows in a staggered
+// (diagonal) order while keeping the diffused errors in shared memory. It
+// must be dispatched using `pl_dispatch_compute` with a `dispatch_size` of
+// {1, 1, 1}. Returns false if compute shaders are unsupported, or if there
+// isn't enough shared memory for the texture's width.
+bool pl_shader_error_diffusion(struct pl_shader *sh,
+                               const struct pl_error_diffusion_params *params);
+
 struct pl_3dlut_params {
     // The rendering intent to use when computing the color transformation. A
     // recommended value is PL_INTENT_RELATIVE_COLORIMETRIC for color-accurate
@@ -78,6 +78,12 @@ struct pl_deband_params {
     //
     // Defaults to 6.0, which is very mild.
     float grain;
+
+    // Disable the use of compute shaders (e.g. if rendering to non-storable
+    // tex). When available, the debanding shader loads the neighbourhood of
+    // each work group into shared memory, rounding the samples to the nearest
+    // texel. This is only possible if the radius is small enough to fit.
+    bool no_compute;
 };
 
 extern const struct pl_deband_params pl_deband_default_params;
@@ -124,6 +130,14 @@ struct pl_sample_filter_params {
     bool no_compute;
     // Disable the use of filter widening / anti-aliasing (for downscaling)
     bool no_widening;
+    // Merge pairs of adjacent filter taps with same-signed weights into a
+    // single bilinear texture fetch. This roughly halves the number of
+    // texture fetches for filters with mostly positive weights, at the cost
+    // of some precision (since the hardware's subtexel interpolation is
+    // typically only accurate to 8 bits). Only relevant for separated
+    // filters, and only takes effect if the source uses
+    // PL_TEX_SAMPLE_LINEAR.
+    bool merge_taps;
 
     // This shader object is used to store the LUT, and will be recreated
     // if necessary. To avoid thrashing the resource, users should avoid trying
@@ -164,4 +178,22 @@ bool pl_shader_sample_ortho(struct pl_shader *sh, int pass,
                             const struct pl_sample_src *src,
                             const struct pl_sample_filter_params *params);
 
+// Performs both passes of orthogonal sampling at once, using a single compute
+// shader dispatch. Each work group loads the source texels it needs into
+// shared memory, which avoids the round trip through an intermediate texture
+// required when calling `pl_shader_sample_ortho` twice.
+//
+// This requires compute shader support, a non-flipped `src->rect`, and a
+// `src->tex`. If any of these are not met, or if the required amount of
+// shared memory exceeds the GPU's limits, this returns false without
+// modifying the shader, in which case the caller should fall back to
+// `pl_shader_sample_ortho`. Any other error (e.g. failing to create the LUTs)
+// leaves the shader in a failed state (see `pl_shader_is_failed`), in which
+// case it must be discarded instead.
+//
+// Note: This uses the same `params->lut` as `pl_shader_sample_ortho`.
+bool pl_shader_sample_ortho2(struct pl_shader *sh,
+                             const struct pl_sample_src *src,
+                             const struct pl_sample_filter_params *params);
+
 #endif // LIBPLACEBO_SHADERS_SAMPLING_H_
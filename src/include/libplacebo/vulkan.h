@@ -245,6 +245,20 @@ struct pl_vulkan_params {
     int max_glsl_version;       // limit the maximum GLSL version
     bool disable_events;        // disables usage of VkEvent completely
     uint32_t max_api_version;   // limit the maximum vulkan API version
+
+    // --- Threading options
+
+    // Allows the resulting `pl_gpu` to be used from multiple threads at the
+    // same time. In this mode, every thread gets its own command pools and
+    // recording state, and only the shared state (queue submission, memory
+    // allocation, object destruction) is guarded by locks. This allows e.g.
+    // running one `pl_renderer` per thread concurrently on a single device.
+    //
+    // Note: Individual objects (textures, buffers, passes, dispatch objects,
+    // renderers, swapchains etc.) must still not be used from more than one
+    // thread at the same time. Also note that the per-thread state of a
+    // thread is only released when the `pl_gpu` is destroyed.
+    bool thread_safe;
 };
 
 // Default/recommended parameters. Should generally be safe and efficient.
@@ -398,6 +412,11 @@ struct pl_vulkan_import_params {
     int max_glsl_version;
     bool disable_events;
     uint32_t max_api_version;
+
+    // See `pl_vulkan_params.thread_safe`. Note that in this mode, the user
+    // must also synchronize their own access to the VkQueues in use with the
+    // libplacebo-internal submissions (e.g. by not using them concurrently).
+    bool thread_safe;
 };
 
 // Import an existing VkDevice instead of creating a new one, and wrap it into
@@ -223,3 +223,118 @@ error:
     TA_FREEP(&tmp);
     return ret;
 }
+
+// Extracts the RGB -> PCS matrix and the TRCs of a matrix/TRC profile
+static bool get_shaper(cmsHPROFILE prof, enum pl_rendering_intent intent,
+                       int direction, struct pl_matrix3x3 *rgb2xyz,
+                       cmsToneCurve *trc[3])
+{
+    if (cmsGetColorSpace(prof) != cmsSigRgbData || !cmsIsMatrixShaper(prof))
+        return false;
+
+    // Profiles with CLUTs for this intent take precedence over the shaper
+    if (cmsIsCLUT(prof, intent, direction))
+        return false;
+
+    static const cmsTagSignature colorants[3] = {
+        cmsSigRedColorantTag, cmsSigGreenColorantTag, cmsSigBlueColorantTag,
+    };
+
+    static const cmsTagSignature curves[3] = {
+        cmsSigRedTRCTag, cmsSigGreenTRCTag, cmsSigBlueTRCTag,
+    };
+
+    for (int i = 0; i < 3; i++) {
+        const cmsCIEXYZ *xyz = cmsReadTag(prof, colorants[i]);
+        trc[i] = cmsReadTag(prof, curves[i]);
+        if (!xyz || !trc[i])
+            return false;
+
+        rgb2xyz->m[0][i] = xyz->X;
+        rgb2xyz->m[1][i] = xyz->Y;
+        rgb2xyz->m[2][i] = xyz->Z;
+
+        // Black point compensation is only a no-op for zero black points
+        if (cmsEvalToneCurveFloat(trc[i], 0.0) > 1e-6)
+            return false;
+    }
+
+    return true;
+}
+
+bool pl_lcms_compute_shaper(struct pl_context *ctx, void *tactx,
+                            enum pl_rendering_intent intent,
+                            struct pl_3dlut_profile src,
+                            struct pl_3dlut_profile dst,
+                            int s_r, int s_g, int s_b, int curve_size,
+                            struct pl_lcms_shaper *out,
+                            struct pl_3dlut_result *res)
+{
+    bool ret = false;
+    cmsHPROFILE srcp = NULL, dstp = NULL;
+
+    // Absolute colorimetric requires white point scaling, which is not
+    // accounted for here
+    if (intent == PL_INTENT_ABSOLUTE_COLORIMETRIC)
+        return false;
+
+    cmsContext cms = cmsCreateContext(NULL, ctx);
+    if (!cms)
+        goto error;
+
+    cmsSetLogErrorHandlerTHR(cms, error_callback);
+    dstp = get_profile(ctx, cms, dst, NULL, &res->src_color);
+    srcp = get_profile(ctx, cms, src, dstp, &res->dst_color);
+    if (!srcp || !dstp)
+        goto error;
+
+    struct pl_matrix3x3 src_mat, dst_mat;
+    cmsToneCurve *src_trc[3], *dst_trc[3];
+    if (!get_shaper(srcp, intent, LCMS_USED_AS_INPUT, &src_mat, src_trc) ||
+        !get_shaper(dstp, intent, LCMS_USED_AS_OUTPUT, &dst_mat, dst_trc))
+    {
+        pl_debug(ctx, "Color profile is not a matrix/TRC profile");
+        goto error;
+    }
+
+    // linear src RGB -> PCS -> linear dst RGB
+    out->matrix = dst_mat;
+    pl_matrix3x3_invert(&out->matrix);
+    pl_matrix3x3_mul(&out->matrix, &src_mat);
+
+    const int sizes[3] = { s_r, s_g, s_b };
+    for (int c = 0; c < 3; c++) {
+        pl_assert(sizes[c] > 1);
+        out->src_curve[c] = talloc_array(tactx, float, sizes[c]);
+        for (int i = 0; i < sizes[c]; i++) {
+            float x = (float) i / (sizes[c] - 1);
+            out->src_curve[c][i] = cmsEvalToneCurveFloat(src_trc[c], x);
+        }
+    }
+
+    pl_assert(curve_size > 1);
+    out->dst_curve = talloc_array(tactx, float, 3 * curve_size);
+    for (int c = 0; c < 3; c++) {
+        cmsToneCurve *inv = cmsReverseToneCurveEx(4096, dst_trc[c]);
+        if (!inv)
+            goto error;
+
+        for (int i = 0; i < curve_size; i++) {
+            float x = (float) i / (curve_size - 1);
+            out->dst_curve[i * 3 + c] = cmsEvalToneCurveFloat(inv, x * x);
+        }
+        cmsFreeToneCurve(inv);
+    }
+
+    ret = true;
+    // fall through
+
+error:
+    if (srcp)
+        cmsCloseProfile(srcp);
+    if (dstp)
+        cmsCloseProfile(dstp);
+    if (cms)
+        cmsDeleteContext(cms);
+    return ret;
+}
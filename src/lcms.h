@@ -26,3 +26,30 @@ bool pl_lcms_compute_lut(struct pl_context *ctx, enum pl_rendering_intent intent
                          struct pl_3dlut_profile src, struct pl_3dlut_profile dst,
                          float *out_data, int s_r, int s_g, int s_b,
                          struct pl_3dlut_result *out);
+
+// Decomposition of a transformation between two matrix/TRC profiles into
+// per-channel curves and a matrix, which can be evaluated on the GPU.
+struct pl_lcms_shaper {
+    // Linearized input values, one table per channel, sampled at the grid
+    // points of the 3DLUT (i.e. at i / (s - 1) for the respective size s)
+    float *src_curve[3];
+
+    // Linear source RGB -> linear destination RGB
+    struct pl_matrix3x3 matrix;
+
+    // Inverse of the destination curves, with three interleaved channels,
+    // sampled at (i / (curve_size - 1))^2
+    float *dst_curve;
+};
+
+// Like `pl_lcms_compute_lut`, but decomposes the transformation instead of
+// evaluating it. Returns false if either profile is table-based (or can't be
+// represented this way for other reasons), in which case the caller should
+// fall back to `pl_lcms_compute_lut`. The tables are allocated on `tactx`.
+bool pl_lcms_compute_shaper(struct pl_context *ctx, void *tactx,
+                            enum pl_rendering_intent intent,
+                            struct pl_3dlut_profile src,
+                            struct pl_3dlut_profile dst,
+                            int s_r, int s_g, int s_b, int curve_size,
+                            struct pl_lcms_shaper *out,
+                            struct pl_3dlut_result *res);
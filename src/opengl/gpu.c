@@ -245,8 +245,10 @@ const struct pl_gpu *pl_gpu_create_gl(struct pl_context *ctx)
 
     if (test_ext(gpu, "GL_ARB_pixel_buffer_object", 31, 0))
         l->max_xfer_size = SIZE_MAX; // no limit imposed by GL
-    if (test_ext(gpu, "GL_ARB_uniform_buffer_object", 31, 0))
+    if (test_ext(gpu, "GL_ARB_uniform_buffer_object", 31, 0)) {
         get(GL_MAX_UNIFORM_BLOCK_SIZE, &l->max_ubo_size);
+        get(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &l->align_ubo_offset);
+    }
     if (test_ext(gpu, "GL_ARB_shader_storage_buffer_object", 43, 0))
         get(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &l->max_ssbo_size);
 
@@ -1576,7 +1578,12 @@ static void update_desc(const struct pl_pass *pass, int index,
     case PL_DESC_BUF_UNIFORM: {
         const struct pl_buf *buf = db->object;
         struct pl_buf_gl *buf_gl = TA_PRIV(buf);
-        glBindBufferBase(buf_gl->target, desc->binding, buf_gl->buffer);
+        if (db->buf_offset) {
+            glBindBufferRange(buf_gl->target, desc->binding, buf_gl->buffer,
+                              db->buf_offset, buf->params.size - db->buf_offset);
+        } else {
+            glBindBufferBase(buf_gl->target, desc->binding, buf_gl->buffer);
+        }
         break;
     }
     case PL_DESC_BUF_STORAGE: {
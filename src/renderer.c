@@ -39,6 +39,16 @@ struct sampler {
     const struct pl_tex *sep_fbo_down;
 };
 
+// Inputs which determine the contents of `pl_renderer.color_lut`
+struct color_lut_key {
+    struct pl_color_space src;
+    struct pl_color_space dst;
+    struct pl_color_map_params color_map;
+    struct pl_cone_params cones;
+    int size;
+    float peak, avg; // detected values (quantized), or 0 if unknown
+};
+
 struct pl_renderer {
     const struct pl_gpu *gpu;
     struct pl_context *ctx;
@@ -56,15 +66,20 @@ struct pl_renderer {
     bool disable_blending;      // disable blending for the target/fbofmt
     bool disable_overlay;       // disable rendering overlays
     bool disable_3dlut;         // disable usage of a 3DLUT
+    bool disable_color_lut;     // disable the fused output color LUT
+    bool disable_error_diffusion; // disable error diffusion dithering
     bool disable_peak_detect;   // disable peak detection shader
     bool disable_grain;         // disable AV1 grain code
     bool disable_hooks;         // disable user hooks / custom shaders
 
     // Shader resource objects and intermediate textures (FBOs)
     struct pl_shader_obj *peak_detect_state;
+    struct pl_shader_obj *tone_map_state;
     struct pl_shader_obj *dither_state;
     struct pl_shader_obj *lut3d_state;
     struct pl_shader_obj *grain_state[4];
+    const struct pl_tex *color_lut;
+    struct color_lut_key color_lut_key;
     const struct pl_tex **fbos;
     int num_fbos;
     struct sampler samplers[SCALER_COUNT];
@@ -162,10 +177,12 @@ void pl_renderer_destroy(struct pl_renderer **p_rr)
 
     // Free all shader resource objects
     pl_shader_obj_destroy(&rr->peak_detect_state);
+    pl_shader_obj_destroy(&rr->tone_map_state);
     pl_shader_obj_destroy(&rr->dither_state);
     pl_shader_obj_destroy(&rr->lut3d_state);
     for (int i = 0; i < PL_ARRAY_SIZE(rr->grain_state); i++)
         pl_shader_obj_destroy(&rr->grain_state[i]);
+    pl_tex_destroy(rr->gpu, &rr->color_lut);
 
     // Free all samplers
     for (int i = 0; i < PL_ARRAY_SIZE(rr->samplers); i++)
@@ -187,9 +204,28 @@ void pl_renderer_load(struct pl_renderer *rr, const uint8_t *cache)
     pl_dispatch_load(rr->dp, cache);
 }
 
+void pl_renderer_set_stats(struct pl_renderer *rr, bool enable)
+{
+    pl_dispatch_set_stats(rr->dp, enable);
+}
+
+int pl_renderer_query_stats(struct pl_renderer *rr,
+                            const struct pl_dispatch_pass_stats **out)
+{
+    return pl_dispatch_query_stats(rr->dp, out);
+}
+
+void pl_renderer_set_cache(struct pl_renderer *rr,
+                           struct pl_dispatch_cache *cache)
+{
+    pl_dispatch_set_cache(rr->dp, cache);
+}
+
 void pl_renderer_flush_cache(struct pl_renderer *rr)
 {
     pl_shader_obj_destroy(&rr->peak_detect_state);
+    pl_shader_obj_destroy(&rr->tone_map_state);
+    pl_tex_destroy(rr->gpu, &rr->color_lut);
 }
 
 const struct pl_render_params pl_render_default_params = {
@@ -263,6 +299,15 @@ struct pass_state {
 
     // Metadata for `rr->fbos`
     bool *fbos_used;
+
+    // Whether this pass only re-renders part of the image, as a result of
+    // `pl_image.damage_rects`. If so, `partial_bounds` holds the part of the
+    // ref plane which the full rendering of the image reads from.
+    bool partial;
+    struct pl_rect2df partial_bounds;
+
+    // Whether peak detection is active for this frame
+    bool peak_detect;
 };
 
 static const struct pl_tex *get_fbo(struct pass_state *pass, int w, int h)
@@ -437,6 +482,91 @@ static struct sampler_info sample_src_info(struct pl_renderer *rr,
     return info;
 }
 
+// Hard-disables sigmoidization and/or linearization for scaling, when required
+static void restrict_linear_scaling(struct pl_renderer *rr,
+                                    struct pl_color_space color,
+                                    const struct pl_render_params *params,
+                                    bool *use_linear, bool *use_sigmoid)
+{
+    if (params->disable_linear_scaling || rr->disable_linear_sdr)
+        *use_sigmoid = *use_linear = false;
+
+    // Avoid sigmoidization for HDR content because it clips to [0,1]
+    if (pl_color_transfer_is_hdr(color.transfer)) {
+        *use_sigmoid = false;
+        // Also disable linearization if necessary
+        if (rr->disable_linear_hdr)
+            *use_linear = false;
+    }
+}
+
+// Radius (in source texels) of the area sampled for each output texel when
+// scaling `src`
+static float sampler_radius(struct pl_renderer *rr,
+                            const struct pl_sample_src *src,
+                            const struct pl_render_params *params)
+{
+    struct sampler_info info = sample_src_info(rr, src, params);
+    switch (info.type) {
+    case SAMPLER_DIRECT:  return 1.0;
+    case SAMPLER_BICUBIC: return 2.0;
+    case SAMPLER_COMPLEX: break;
+    }
+
+    float ratio = PL_MIN(src->new_w / fabs(pl_rect_w(src->rect)),
+                         src->new_h / fabs(pl_rect_h(src->rect)));
+    float inv_scale = params->skip_anti_aliasing ? 1.0 : PL_MAX(1.0 / ratio, 1.0);
+    float radius = info.config->kernel->radius;
+    if (info.config->blur > 0.0)
+        radius *= info.config->blur;
+    return radius * inv_scale;
+}
+
+// Size granularity of the regions re-rendered as a result of damage rects.
+// Keeps the sizes of the intermediate FBOs stable, so they don't need to be
+// reallocated whenever the damaged regions change size.
+#define PARTIAL_ALIGN 16
+
+// Grows [*a, *b] to a size which is a multiple of `align`, without leaving
+// [lo, hi] (in which case the size may end up smaller)
+static void align_range(float *a, float *b, float lo, float hi, float align)
+{
+    float len = ceilf((*b - *a) / align) * align;
+    *b = PL_MIN(*a + len, hi);
+    *a = PL_MAX(*b - len, lo);
+}
+
+// Number of texels sampled per output texel by a separable filter
+static float ortho_taps(const struct pl_filter_config *config, float ratio,
+                        bool no_widening)
+{
+    float inv_scale = no_widening ? 1.0 : PL_MAX(1.0 / ratio, 1.0);
+    float radius = config->kernel->radius;
+    if (config->blur > 0.0)
+        radius *= config->blur;
+    return ceilf(radius * inv_scale) * 2;
+}
+
+// Picks the order in which to run the separable passes. The first pass only
+// scales along one dimension, and its output (the intermediate texture) has
+// to cover the full texture size along the other dimension, so the total
+// cost depends on the order whenever the scaling ratios or texture sizes
+// differ between dimensions.
+static int ortho_first_pass(const struct pl_sample_src *src,
+                            const struct pl_sample_filter_params *fparams)
+{
+    float src_w = fabs(pl_rect_w(src->rect)), src_h = fabs(pl_rect_h(src->rect));
+    float taps_x = ortho_taps(&fparams->filter, src->new_w / src_w,
+                              fparams->no_widening);
+    float taps_y = ortho_taps(&fparams->filter, src->new_h / src_h,
+                              fparams->no_widening);
+
+    float out = (float) src->new_w * src->new_h;
+    float cost_vert  = src->tex->params.w * src->new_h * taps_y + out * taps_x;
+    float cost_horiz = src->new_w * src->tex->params.h * taps_x + out * taps_y;
+    return cost_horiz < cost_vert ? PL_SEP_HORIZ : PL_SEP_VERT;
+}
+
 static void dispatch_sampler(struct pass_state *pass, struct pl_shader *sh,
                              struct sampler *sampler,
                              const struct pl_render_params *params,
@@ -480,15 +610,22 @@ static void dispatch_sampler(struct pass_state *pass, struct pl_shader *sh,
         .antiring    = params->antiringing_strength,
         .no_compute  = rr->disable_compute,
         .no_widening = params->skip_anti_aliasing,
+        .merge_taps  = params->merge_scaler_taps,
         .lut         = lut,
     };
 
     bool ok;
     if (info.config->polar) {
         ok = pl_shader_sample_polar(sh, src, &fparams);
+    } else if (pl_shader_sample_ortho2(sh, src, &fparams)) {
+        ok = true;
+    } else if (pl_shader_is_failed(sh)) {
+        ok = false;
     } else {
+        int first = ortho_first_pass(src, &fparams);
+        int second = first == PL_SEP_VERT ? PL_SEP_HORIZ : PL_SEP_VERT;
         struct pl_shader *tsh = pl_dispatch_begin_ex(rr->dp, true);
-        ok = pl_shader_sample_ortho(tsh, PL_SEP_VERT, src, &fparams);
+        ok = pl_shader_sample_ortho(tsh, first, src, &fparams);
         if (!ok) {
             pl_dispatch_abort(rr->dp, &tsh);
             goto done;
@@ -496,14 +633,14 @@ static void dispatch_sampler(struct pass_state *pass, struct pl_shader *sh,
 
         struct img img = {
             .sh = tsh,
-            .w  = src->tex->params.w,
-            .h  = src->new_h,
+            .w  = first == PL_SEP_VERT ? src->tex->params.w : src->new_w,
+            .h  = first == PL_SEP_VERT ? src->new_h : src->tex->params.h,
         };
 
         struct pl_sample_src src2 = *src;
         src2.tex = img_tex(pass, &img);
         src2.scale = 1.0;
-        ok = src2.tex && pl_shader_sample_ortho(sh, PL_SEP_HORIZ, &src2, &fparams);
+        ok = src2.tex && pl_shader_sample_ortho(sh, second, &src2, &fparams);
     }
 
 done:
@@ -830,6 +967,7 @@ static int deband_src(struct pass_state *pass, struct pl_shader *psh,
     float scale = pl_color_transfer_nominal_peak(image->color.transfer)
                 * image->color.sig_scale;
     dparams.grain /= scale;
+    dparams.no_compute |= rr->disable_compute;
 
     pl_shader_deband(sh, src, &dparams);
 
@@ -877,15 +1015,20 @@ static void hdr_update_peak(struct pass_state *pass,
         goto cleanup;
     }
 
+    // Measure the image in place, rather than rendering it out to a texture
+    // just for this. `sample_stride` is applied to the invocations of the
+    // main shader in this case.
     bool ok = pl_shader_detect_peak(img_sh(pass, &pass->img), pass->img.color,
                                     &rr->peak_detect_state,
                                     params->peak_detect_params);
+
     if (!ok) {
         PL_WARN(rr, "Failed creating HDR peak detection shader.. disabling");
         rr->disable_peak_detect = true;
         goto cleanup;
     }
 
+    pass->peak_detect = true;
     return;
 
 cleanup:
@@ -1070,6 +1213,47 @@ static bool plane_user_hooks(struct pass_state *pass, struct plane_state *st,
 
 static void fix_rects(struct pass_state *pass, const struct pl_tex *ref_tex);
 
+// Returns whether the planes can be sampled straight to the output size, which
+// requires that the main scaler would have nothing to do except scaling
+static bool want_direct_chroma(struct pass_state *pass,
+                               const struct plane_state *planes,
+                               const struct plane_state *ref,
+                               const struct pl_render_params *params)
+{
+    struct pl_renderer *rr = pass->rr;
+    const struct pl_image *image = &pass->image;
+    if (!params->direct_chroma_scaling || !FBOFMT)
+        return false;
+    if (image->num_overlays > 0 || params->num_hooks > 0)
+        return false;
+
+    bool subsampled = false;
+    for (int i = 0; i < image->num_planes; i++) {
+        subsampled |= planes[i].img.w != ref->img.w ||
+                      planes[i].img.h != ref->img.h;
+    }
+
+    if (!subsampled)
+        return false;
+
+    struct pl_sample_src src = {
+        .new_w = abs(pl_rect_w(pass->dst_rect)),
+        .new_h = abs(pl_rect_h(pass->dst_rect)),
+        .rect  = ref->img.rect,
+    };
+
+    struct sampler_info info = sample_src_info(rr, &src, params);
+    if (info.dir == SAMPLER_NOOP)
+        return false;
+    if (info.dir == SAMPLER_DOWN && params->downscale_pyramid_ratio)
+        return false;
+
+    bool use_sigmoid = info.dir == SAMPLER_UP && params->sigmoid_params;
+    bool use_linear  = use_sigmoid || info.dir == SAMPLER_DOWN;
+    restrict_linear_scaling(rr, image->color, params, &use_linear, &use_sigmoid);
+    return !use_linear;
+}
+
 // This scales and merges all of the source images, and initializes pass->img.
 static bool pass_read_image(struct pl_renderer *rr, struct pass_state *pass,
                             const struct pl_render_params *params)
@@ -1193,10 +1377,61 @@ static bool pass_read_image(struct pl_renderer *rr, struct pass_state *pass,
          "vec4 tmp;                              \n",
          neutral);
 
+    // When sampling the planes straight to the output size, the main scaler
+    // ends up as a no-op. Otherwise, all planes are aligned to the ref plane
+    int out_w = ref->img.w, out_h = ref->img.h;
+    bool direct = want_direct_chroma(pass, planes, ref, params);
+    if (direct) {
+        out_w = abs(pl_rect_w(pass->dst_rect));
+        out_h = abs(pl_rect_h(pass->dst_rect));
+        PL_TRACE(rr, "Sampling planes directly to %dx%d", out_w, out_h);
+    }
+
     // For quality reasons, explicitly drop subpixel offsets from the ref rect
-    // and re-add them as part of `pass->img.rect`, always rounding towards 0
-    float off_x = ref->img.rect.x0 - truncf(ref->img.rect.x0),
-          off_y = ref->img.rect.y0 - truncf(ref->img.rect.y0);
+    // and re-add them as part of `pass->img.rect`, always rounding towards 0.
+    // (Not needed when sampling directly, since there's no second scaler).
+    // `grow_*` is the amount by which the ref rect is extended on each side.
+    float grow_x0 = 0.0, grow_y0 = 0.0, grow_x1 = 0.0, grow_y1 = 0.0;
+    if (!direct) {
+        grow_x0 = ref->img.rect.x0 - truncf(ref->img.rect.x0);
+        grow_y0 = ref->img.rect.y0 - truncf(ref->img.rect.y0);
+        grow_x1 = -grow_x0;
+        grow_y1 = -grow_y0;
+    }
+
+    // When only re-rendering part of the image, align the intermediate image
+    // to the texel grid and pad it with the texels the main scaler reads from
+    // beyond the edges of the rect, so that the result exactly matches that
+    // of rendering the whole image. This must not go past the texels covered
+    // by the intermediate image of the full rendering, which the main scaler
+    // would otherwise see instead of its edge texels.
+    struct pl_sample_src msrc = {
+        .new_w = abs(pl_rect_w(pass->dst_rect)),
+        .new_h = abs(pl_rect_h(pass->dst_rect)),
+        .rect  = ref->img.rect,
+    };
+
+    if (pass->partial && !direct &&
+        sample_src_info(rr, &msrc, params).type != SAMPLER_DIRECT)
+    {
+        const struct pl_rect2df *b = &pass->partial_bounds;
+        float pad = ceilf(sampler_radius(rr, &msrc, params)) + 1;
+        float x0 = floorf(ref->img.rect.x0), y0 = floorf(ref->img.rect.y0),
+              x1 = ceilf(ref->img.rect.x1), y1 = ceilf(ref->img.rect.y1);
+        x0 -= PL_MIN(PL_MAX(x0 - b->x0, 0.0), pad);
+        y0 -= PL_MIN(PL_MAX(y0 - b->y0, 0.0), pad);
+        x1 += PL_MIN(PL_MAX(b->x1 - x1, 0.0), pad);
+        y1 += PL_MIN(PL_MAX(b->y1 - y1, 0.0), pad);
+        align_range(&x0, &x1, b->x0, b->x1, PARTIAL_ALIGN);
+        align_range(&y0, &y1, b->y0, b->y1, PARTIAL_ALIGN);
+
+        grow_x0 = ref->img.rect.x0 - x0;
+        grow_y0 = ref->img.rect.y0 - y0;
+        grow_x1 = x1 - ref->img.rect.x1;
+        grow_y1 = y1 - ref->img.rect.y1;
+        out_w = x1 - x0;
+        out_h = y1 - y0;
+    }
 
     bool has_alpha = false;
     for (int i = 0; i < image->num_planes; i++) {
@@ -1210,13 +1445,13 @@ static bool pass_read_image(struct pl_renderer *rr, struct pass_state *pass,
             .tex        = img_tex(pass, &st->img),
             .components = plane->components,
             .scale      = pl_color_repr_normalize(&st->img.repr),
-            .new_w      = ref->img.w,
-            .new_h      = ref->img.h,
+            .new_w      = out_w,
+            .new_h      = out_h,
             .rect = {
-                st->img.rect.x0 - scale_x * off_x,
-                st->img.rect.y0 - scale_y * off_y,
-                st->img.rect.x1 - scale_x * off_x,
-                st->img.rect.y1 - scale_y * off_y,
+                st->img.rect.x0 - scale_x * grow_x0,
+                st->img.rect.y0 - scale_y * grow_y0,
+                st->img.rect.x1 + scale_x * grow_x1,
+                st->img.rect.y1 + scale_y * grow_y1,
             },
         };
 
@@ -1238,8 +1473,8 @@ static bool pass_read_image(struct pl_renderer *rr, struct pass_state *pass,
             // Can't merge shaders, so instead force FBO indirection here
             struct img inter_img = {
                 .sh = psh,
-                .w = ref->img.w,
-                .h = ref->img.h,
+                .w = out_w,
+                .h = out_h,
             };
 
             const struct pl_tex *inter_tex = img_tex(pass, &inter_img);
@@ -1280,19 +1515,22 @@ static bool pass_read_image(struct pl_renderer *rr, struct pass_state *pass,
 
     pass->img = (struct img) {
         .sh     = sh,
-        .w      = ref->img.w,
-        .h      = ref->img.h,
+        .w      = out_w,
+        .h      = out_h,
         .repr   = ref->img.repr,
         .color  = image->color,
         .comps  = has_alpha ? 4 : 3,
         .rect   = {
-            off_x,
-            off_y,
-            off_x + pl_rect_w(ref->img.rect),
-            off_y + pl_rect_h(ref->img.rect),
+            grow_x0,
+            grow_y0,
+            grow_x0 + pl_rect_w(ref->img.rect),
+            grow_y0 + pl_rect_h(ref->img.rect),
         },
     };
 
+    if (direct)
+        pass->img.rect = (struct pl_rect2df) { 0, 0, out_w, out_h };
+
     // Update the reference rect to our adjusted image coordinates
     pass->ref_rect = pass->img.rect;
 
@@ -1309,6 +1547,55 @@ static bool pass_read_image(struct pl_renderer *rr, struct pass_state *pass,
     return true;
 }
 
+// Repeatedly halves `img` using 2x2 box filtering until the remaining
+// downscaling ratio is at most `params->downscale_pyramid_ratio`, updating
+// `src->rect` to match. Each level is a single bilinear fetch per pixel.
+static bool pass_downscale_pyramid(struct pass_state *pass, struct img *img,
+                                   struct pl_sample_src *src,
+                                   const struct pl_render_params *params)
+{
+    struct pl_renderer *rr = pass->rr;
+    if (!params->downscale_pyramid_ratio || !(FBOFMT->caps & PL_FMT_CAP_LINEAR))
+        return true;
+
+    float max_ratio = PL_MAX(params->downscale_pyramid_ratio, 2.0);
+    for (int level = 1;; level++) {
+        float w = fabs(pl_rect_w(src->rect)), h = fabs(pl_rect_h(src->rect));
+        bool half_x = w > max_ratio * src->new_w,
+             half_y = h > max_ratio * src->new_h;
+        if (!half_x && !half_y)
+            return true;
+
+        int new_w = PL_MAX(1, lroundf(half_x ? w / 2 : w)),
+            new_h = PL_MAX(1, lroundf(half_y ? h / 2 : h));
+
+        const struct pl_tex *tex = img_tex(pass, img);
+        if (!tex)
+            return false;
+
+        PL_TRACE(rr, "Downscale pyramid level %d: %dx%d", level, new_w, new_h);
+        struct pl_shader *sh = pl_dispatch_begin(rr->dp);
+        pl_shader_sample_direct(sh, &(struct pl_sample_src) {
+            .tex    = tex,
+            .rect   = src->rect,
+            .new_w  = new_w,
+            .new_h  = new_h,
+        });
+
+        *img = (struct img) {
+            .sh     = sh,
+            .w      = new_w,
+            .h      = new_h,
+            .repr   = img->repr,
+            .rect   = { 0, 0, new_w, new_h },
+            .color  = img->color,
+            .comps  = img->comps,
+        };
+
+        src->rect = img->rect;
+    }
+}
+
 static bool pass_scale_main(struct pl_renderer *rr, struct pass_state *pass,
                             const struct pl_render_params *params)
 {
@@ -1365,17 +1652,7 @@ static bool pass_scale_main(struct pl_renderer *rr, struct pass_state *pass,
         return true;
     }
 
-    // Hard-disable both sigmoidization and linearization when required
-    if (params->disable_linear_scaling || rr->disable_linear_sdr)
-        use_sigmoid = use_linear = false;
-
-    // Avoid sigmoidization for HDR content because it clips to [0,1]
-    if (pl_color_transfer_is_hdr(img->color.transfer)) {
-        use_sigmoid = false;
-        // Also disable linearization if necessary
-        if (rr->disable_linear_hdr)
-            use_linear = false;
-    }
+    restrict_linear_scaling(rr, img->color, params, &use_linear, &use_sigmoid);
 
     if (use_linear) {
         pl_shader_linearize(img_sh(pass, img), img->color.transfer);
@@ -1415,6 +1692,9 @@ static bool pass_scale_main(struct pl_renderer *rr, struct pass_state *pass,
 
     pass_hook(pass, img, PL_HOOK_PRE_KERNEL, params);
 
+    if (info.dir == SAMPLER_DOWN && !pass_downscale_pyramid(pass, img, &src, params))
+        return false;
+
     src.tex = img_tex(pass, img);
     struct pl_shader *sh = pl_dispatch_begin_ex(rr->dp, true);
     dispatch_sampler(pass, sh, &rr->samplers[SCALER_MAIN], params, &src);
@@ -1437,6 +1717,195 @@ static bool pass_scale_main(struct pl_renderer *rr, struct pass_state *pass,
     return true;
 }
 
+// Compared field by field, since the padding of the nested structs is unset
+static bool color_lut_key_equal(const struct color_lut_key *a,
+                                const struct color_lut_key *b)
+{
+    const struct pl_color_map_params *ca = &a->color_map, *cb = &b->color_map;
+    return pl_color_space_equal(&a->src, &b->src) &&
+           pl_color_space_equal(&a->dst, &b->dst) &&
+           ca->intent == cb->intent &&
+           ca->tone_mapping_algo == cb->tone_mapping_algo &&
+           ca->tone_mapping_param == cb->tone_mapping_param &&
+           ca->desaturation_strength == cb->desaturation_strength &&
+           ca->desaturation_exponent == cb->desaturation_exponent &&
+           ca->desaturation_base == cb->desaturation_base &&
+           ca->max_boost == cb->max_boost &&
+           ca->tone_mapping_lut_size == cb->tone_mapping_lut_size &&
+           ca->gamut_warning == cb->gamut_warning &&
+           ca->gamut_clipping == cb->gamut_clipping &&
+           a->cones.cones == b->cones.cones &&
+           a->cones.strength == b->cones.strength &&
+           a->size == b->size &&
+           a->peak == b->peak &&
+           a->avg == b->avg;
+}
+
+// (Re)generates `rr->color_lut` if needed, by running the color mapping
+// pipeline from `src` to the target on a grid of input colors
+static bool update_color_lut(struct pass_state *pass, struct pl_color_space src,
+                             const struct pl_render_params *params)
+{
+    struct pl_renderer *rr = pass->rr;
+    const struct pl_gpu *gpu = rr->gpu;
+    const struct pl_render_target *target = &pass->target;
+    int size = params->color_lut_size;
+
+    const struct pl_fmt *fmt;
+    fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 16, 32, PL_FMT_CAP_SAMPLEABLE |
+                      PL_FMT_CAP_LINEAR | PL_FMT_CAP_STORABLE);
+    if (!fmt || rr->disable_compute || size < 2 ||
+        size > gpu->limits.max_tex_3d_dim)
+    {
+        PL_WARN(rr, "Fused color LUT of size %d not supported, disabling..",
+                size);
+        rr->disable_color_lut = true;
+        return false;
+    }
+
+    struct color_lut_key key = {
+        .src = src,
+        .dst = target->color,
+        .color_map = *PL_DEF(params->color_map_params, &pl_color_map_default_params),
+        .size = size,
+    };
+
+    if (params->cone_params)
+        key.cones = *params->cone_params;
+
+    // The detected peak is only known on the GPU, so key the LUT on the most
+    // recent values read back from it instead. These are quantized to steps
+    // of about 1%, so the LUT is only regenerated (using the GPU's current
+    // values) when the smoothed peak changes noticeably.
+    float peak, avg;
+    if (pass->peak_detect &&
+        pl_poll_detected_peak(rr->peak_detect_state, &peak, &avg) &&
+        avg > 0.0)
+    {
+        key.peak = expf(roundf(logf(peak) * 100.0) / 100.0);
+        key.avg = expf(roundf(logf(avg) * 100.0) / 100.0);
+    }
+
+    if (rr->color_lut && color_lut_key_equal(&key, &rr->color_lut_key))
+        return true;
+
+    bool ok = pl_tex_recreate(gpu, &rr->color_lut, &(struct pl_tex_params) {
+        .w              = size,
+        .h              = size,
+        .d              = size,
+        .format         = fmt,
+        .sampleable     = true,
+        .storable       = true,
+        .sample_mode    = PL_TEX_SAMPLE_LINEAR,
+        .address_mode   = PL_TEX_ADDRESS_CLAMP,
+    });
+
+    if (!ok) {
+        PL_ERR(rr, "Failed creating color LUT texture, disabling..");
+        rr->disable_color_lut = true;
+        return false;
+    }
+
+    struct pl_shader *sh = pl_dispatch_begin(rr->dp);
+    sh_require(sh, PL_SHADER_SIG_NONE, 0, 0);
+    if (!sh_try_compute(sh, 8, 8, false, 0)) {
+        pl_dispatch_abort(rr->dp, &sh);
+        rr->disable_color_lut = true;
+        return false;
+    }
+
+    ident_t lut = sh_desc(sh, (struct pl_shader_desc) {
+        .desc = {
+            .name   = "color_lut",
+            .type   = PL_DESC_STORAGE_IMG,
+            .access = PL_DESC_ACCESS_WRITEONLY,
+        },
+        .object = rr->color_lut,
+    });
+
+    sh_describe(sh, "color LUT %dx%dx%d", size, size, size);
+    GLSL("ivec3 lut_pos = ivec3(gl_GlobalInvocationID);         \n"
+         "vec4 color = vec4(vec3(lut_pos) * vec3(1.0/%f), 1.0); \n",
+         size - 1.0);
+
+    pl_shader_color_map_ex(sh, params->color_map_params, src, target->color,
+                           &rr->peak_detect_state, &rr->tone_map_state, false);
+    if (params->cone_params)
+        pl_shader_cone_distort(sh, target->color, params->cone_params);
+
+    GLSL("if (all(lessThan(lut_pos, ivec3(%d)))) \n"
+         "    imageStore(%s, lut_pos, color);     \n",
+         size, lut);
+
+    ok = pl_dispatch_compute(rr->dp, &(struct pl_dispatch_compute_params) {
+        .shader = &sh,
+        .dispatch_size = { (size + 7) / 8, (size + 7) / 8, size },
+    });
+
+    if (!ok) {
+        PL_ERR(rr, "Failed generating color LUT, disabling..");
+        pl_tex_destroy(gpu, &rr->color_lut);
+        rr->disable_color_lut = true;
+        return false;
+    }
+
+    rr->color_lut_key = key;
+    return true;
+}
+
+// Replaces `img` by the result of dithering it with error diffusion. Returns
+// false (leaving `img` untouched) if this is unsupported.
+static bool pass_error_diffusion(struct pass_state *pass, struct img *img,
+                                 int depth, const struct pl_render_params *params)
+{
+    struct pl_renderer *rr = pass->rr;
+    const struct pl_gpu *gpu = rr->gpu;
+    if (rr->disable_error_diffusion || depth > 16)
+        return false;
+
+    if (!FBOFMT || !(rr->fbofmt->caps & PL_FMT_CAP_STORABLE) ||
+        !(gpu->caps & PL_GPU_CAP_COMPUTE))
+    {
+        PL_WARN(rr, "Error diffusion dithering not supported, falling back..");
+        rr->disable_error_diffusion = true;
+        return false;
+    }
+
+    const struct pl_tex *in = img_tex(pass, img);
+    const struct pl_tex *out = in ? get_fbo(pass, img->w, img->h) : NULL;
+    if (!out)
+        return false;
+
+    struct pl_shader *sh = pl_dispatch_begin(rr->dp);
+    bool ok = pl_shader_error_diffusion(sh, &(struct pl_error_diffusion_params) {
+        .input_tex  = in,
+        .output_tex = out,
+        .new_depth  = depth,
+        .kernel     = params->dither_params->error_diffusion,
+    });
+
+    if (!ok) {
+        PL_WARN(rr, "Failed generating error diffusion shader, falling back..");
+        pl_dispatch_abort(rr->dp, &sh);
+        rr->disable_error_diffusion = true;
+        return false;
+    }
+
+    ok = pl_dispatch_compute(rr->dp, &(struct pl_dispatch_compute_params) {
+        .shader = &sh,
+        .dispatch_size = {1, 1, 1},
+    });
+
+    if (!ok) {
+        PL_ERR(rr, "Failed dispatching error diffusion shader, disabling..");
+        rr->disable_error_diffusion = true;
+        return false;
+    }
+
+    img->tex = out;
+    return true;
+}
+
 static bool pass_output_target(struct pl_renderer *rr, struct pass_state *pass,
                                const struct pl_render_params *params)
 {
@@ -1482,8 +1951,9 @@ static bool pass_output_target(struct pl_renderer *rr, struct pass_state *pass,
         }
 
         // current -> 3DLUT in
-        pl_shader_color_map(sh, params->color_map_params, ref, res.src_color,
-                            &rr->peak_detect_state, prelinearized);
+        pl_shader_color_map_ex(sh, params->color_map_params, ref, res.src_color,
+                               &rr->peak_detect_state, &rr->tone_map_state,
+                               prelinearized);
         // 3DLUT in -> 3DLUT out
         pl_3dlut_apply(sh, &rr->lut3d_state);
         // 3DLUT out -> target
@@ -1504,14 +1974,40 @@ fallback:
 
 #endif
 
-    if (!use_3dlut) {
+    // The LUT domain is clamped to [0,1], so this only works for bounded,
+    // non-linear input encodings
+    bool use_color_lut = !use_3dlut && params->color_lut_size &&
+                         !prelinearized && !rr->disable_color_lut &&
+                         ref.transfer != PL_COLOR_TRC_LINEAR &&
+                         ref.transfer != PL_COLOR_TRC_UNKNOWN;
+    if (use_color_lut)
+        use_color_lut = update_color_lut(pass, ref, params);
+
+    if (use_color_lut) {
+        // current -> target, in a single lookup
+        float size = rr->color_lut->params.w;
+        ident_t lut = sh_desc(sh, (struct pl_shader_desc) {
+            .desc = {
+                .name = "color_lut",
+                .type = PL_DESC_SAMPLED_TEX,
+            },
+            .object = rr->color_lut,
+        });
+
+        sh_describe(sh, "color LUT");
+        GLSL("color.rgb = %s(%s, mix(vec3(%f), vec3(%f),          \n"
+             "                       clamp(color.rgb, 0.0, 1.0))).rgb; \n",
+             sh_tex_fn(sh, rr->color_lut->params), lut,
+             0.5 / size, 1.0 - 0.5 / size);
+    } else if (!use_3dlut) {
         // current -> target
-        pl_shader_color_map(sh, params->color_map_params, ref, target->color,
-                            &rr->peak_detect_state, prelinearized);
+        pl_shader_color_map_ex(sh, params->color_map_params, ref, target->color,
+                               &rr->peak_detect_state, &rr->tone_map_state,
+                               prelinearized);
     }
 
     // Apply color blindness simulation if requested
-    if (params->cone_params)
+    if (params->cone_params && !use_color_lut)
         pl_shader_cone_distort(sh, target->color, params->cone_params);
 
     bool is_comp = pl_shader_is_compute(sh);
@@ -1542,8 +2038,12 @@ fallback:
 
         // Ignore dithering for >16-bit FBOs, since it's pretty pointless
         if (depth <= 16 || params->force_dither) {
-            pl_shader_dither(img_sh(pass, img), depth, &rr->dither_state,
-                             params->dither_params);
+            bool diffused = params->dither_params->error_diffusion &&
+                            pass_error_diffusion(pass, img, depth, params);
+            if (!diffused) {
+                pl_shader_dither(img_sh(pass, img), depth, &rr->dither_state,
+                                 params->dither_params);
+            }
         }
     }
 
@@ -1652,6 +2152,9 @@ static bool validate_structs(struct pl_renderer *rr,
           src_h = pl_rect_h(image->src_rect);
     require(!src_w == !src_h);
 
+    require(image->num_damage_rects >= 0);
+    require(!image->num_damage_rects || image->damage_rects);
+
     require(image->num_overlays >= 0);
     for (int i = 0; i < image->num_overlays; i++) {
         const struct pl_overlay *overlay = &image->overlays[i];
@@ -1675,19 +2178,315 @@ static bool validate_structs(struct pl_renderer *rr,
     return true;
 }
 
-bool pl_render_image(struct pl_renderer *rr, const struct pl_image *pimage,
-                     const struct pl_render_target *ptarget,
-                     const struct pl_render_params *params)
+// Renders the image using a single pl_tex_blit, if the rendering pipeline
+// would otherwise reduce to a plain copy (a single RGB plane with the same
+// format, repr and color space as the target, no scaling and nothing else
+// that could affect the result). Returns false if this is not possible.
+static bool pass_blit_passthrough(struct pass_state *pass,
+                                  const struct pl_render_params *params)
 {
-    params = PL_DEF(params, &pl_render_default_params);
-    if (!validate_structs(rr, pimage, ptarget))
+    struct pl_renderer *rr = pass->rr;
+    const struct pl_image *image = &pass->image;
+    const struct pl_render_target *target = &pass->target;
+    if (image->num_planes != 1 || image->num_overlays > 0 || params->num_hooks)
+        return false;
+    if (params->deband_params || params->cone_params)
+        return false;
+    if (params->force_3dlut || (params->force_dither && params->dither_params))
+        return false;
+    if (image->profile.data || target->profile.data)
+        return false; // ICC profiles go through a 3DLUT
+
+    const struct pl_color_adjustment *adj = params->color_adjustment;
+    if (adj && memcmp(adj, &pl_color_adjustment_neutral, sizeof(*adj)) != 0)
+        return false;
+
+    const struct pl_plane *plane = &image->planes[0];
+    const struct pl_tex *tex = plane->texture;
+    const struct pl_tex *fbo = target->fbo;
+    if (!tex->params.blit_src || !fbo->params.blit_dst)
+        return false;
+    if (tex->params.format != fbo->params.format)
+        return false;
+    if (plane->components != tex->params.format->num_components)
+        return false;
+    if (plane->shift_x || plane->shift_y)
+        return false;
+    for (int c = 0; c < plane->components; c++) {
+        if (plane->component_mapping[c] != c)
+            return false;
+    }
+
+    if (image->repr.sys != PL_COLOR_SYSTEM_RGB ||
+        !pl_color_repr_equal(&image->repr, &target->repr))
+    {
+        return false;
+    }
+
+    struct pl_color_space color = image->color;
+    if (!color.primaries) {
+        color.primaries = pl_color_primaries_guess(tex->params.w,
+                                                   tex->params.h);
+    }
+
+    if (!pl_color_space_equal(&color, &target->color))
+        return false;
+
+    struct pl_color_repr repr = image->repr;
+    struct pl_av1_grain_params grain_params = {
+        .data = image->av1_grain,
+        .repr = &repr,
+        .components = plane->components,
+    };
+
+    for (int c = 0; c < plane->components; c++)
+        grain_params.component_mapping[c] = plane->component_mapping[c];
+    if (!rr->disable_grain && pl_needs_av1_grain(&grain_params))
+        return false;
+
+    // Finally, the rects need to match exactly and be in bounds. Do this on a
+    // copy of the pass state, since the rects are only fixed later on
+    struct pass_state tmp = *pass;
+    fix_rects(&tmp, tex);
+    struct pl_rect2df src = tmp.image.src_rect;
+    struct pl_rect2d dst = tmp.dst_rect;
+    if (src.x0 != truncf(src.x0) || src.y0 != truncf(src.y0) ||
+        pl_rect_w(src) != pl_rect_w(dst) || pl_rect_h(src) != pl_rect_h(dst))
+    {
+        return false;
+    }
+
+    if (src.x0 < 0 || src.y0 < 0 || src.x1 > tex->params.w ||
+        src.y1 > tex->params.h || pl_rect_w(dst) <= 0 || pl_rect_h(dst) <= 0)
+    {
+        return false;
+    }
+
+    PL_TRACE(rr, "Rendering image using blit passthrough");
+    pl_tex_blit(rr->gpu, fbo, tex,
+                (struct pl_rect3d) { dst.x0, dst.y0, 0, dst.x1, dst.y1, 0 },
+                (struct pl_rect3d) { src.x0, src.y0, 0, src.x1, src.y1, 0 });
+    return true;
+}
+
+// Computes the (source, target) rect pairs which need to be re-rendered as a
+// result of `image->damage_rects`, as well as the `pass_state.partial_bounds`
+// to render them with. Returns false if the whole image needs to be
+// re-rendered instead.
+static bool damage_regions(struct pl_renderer *rr, const struct pl_image *image,
+                           const struct pl_render_target *target,
+                           const struct pl_render_params *params, void *alloc,
+                           struct pl_rect2df **out_src,
+                           struct pl_rect2df **out_dst, int *out_num,
+                           struct pl_rect2df *out_bounds)
+{
+    // Overlays, hooks, error diffusion and peak detection don't operate on a
+    // per-pixel basis, so these always need the whole image. Debanding seeds
+    // its PRNG from the coordinates and index of the pass, neither of which
+    // is preserved by a partial re-render.
+    if (image->num_overlays > 0 || target->num_overlays > 0 || params->num_hooks)
+        return false;
+    if (params->dither_params && params->dither_params->error_diffusion)
+        return false;
+    if (params->deband_params)
+        return false;
+
+    struct pl_color_space color = image->color;
+    pl_color_space_infer(&color);
+    if (params->peak_detect_params && pl_color_space_is_hdr(color))
+        return false;
+
+    // Find the reference plane, same as pass_read_image
+    struct plane_state planes[4];
+    const struct pl_tex *ref_tex = NULL;
+    pl_assert(image->num_planes < PL_ARRAY_SIZE(planes));
+    for (int i = 0; i < image->num_planes; i++) {
+        struct plane_state *st = &planes[i];
+        *st = (struct plane_state) {
+            .plane = image->planes[i],
+            .img = { .repr = image->repr, },
+        };
+
+        switch (detect_plane_type(st)) {
+        case PLANE_RGB:
+        case PLANE_LUMA:
+        case PLANE_XYZ:
+            ref_tex = st->plane.texture;
+            break;
+        default: break;
+        }
+    }
+
+    if (!ref_tex)
+        return false;
+
+    struct pass_state pass = {
+        .rr = rr,
+        .image = *image,
+        .target = *target,
+    };
+
+    fix_rects(&pass, ref_tex);
+    struct pl_rect2df src = pass.image.src_rect, dst = pass.target.dst_rect;
+    struct pl_rect2d full = pass.dst_rect;
+    pl_rect2d_normalize(&full);
+
+    struct pl_sample_src msrc = {
+        .new_w = pl_rect_w(full),
+        .new_h = pl_rect_h(full),
+        .rect  = src,
+    };
+
+    if (!pl_rect_w(full) || !pl_rect_h(full) || !pl_rect_w(src) || !pl_rect_h(src))
+        return false;
+    if (sample_src_info(rr, &msrc, params).dir == SAMPLER_DOWN &&
+        params->downscale_pyramid_ratio)
+    {
+        return false;
+    }
+
+    // Figure out how far (in reference texels) a change can spread, by adding
+    // up the radius of the main scaler and the per-plane processing
+    float plane_margin = 0.0;
+    for (int i = 0; i < image->num_planes; i++) {
+        const struct pl_tex *tex = image->planes[i].texture;
+        float fx = (float) ref_tex->params.w / tex->params.w,
+              fy = (float) ref_tex->params.h / tex->params.h,
+              f = PL_MAX(PL_MAX(fx, fy), 1.0);
+
+        float margin = 0.0;
+        if (tex != ref_tex) {
+            margin += sampler_radius(rr, &(struct pl_sample_src) {
+                .tex    = tex,
+                .new_w  = ref_tex->params.w,
+                .new_h  = ref_tex->params.h,
+                .rect   = { 0, 0, tex->params.w, tex->params.h },
+            }, params);
+        }
+
+        plane_margin = PL_MAX(plane_margin, margin * f);
+    }
+
+    float margin = sampler_radius(rr, &msrc, params) + plane_margin + 1.0;
+    float sx = pl_rect_w(dst) / pl_rect_w(src),
+          sy = pl_rect_h(dst) / pl_rect_h(src);
+
+    struct pl_rect2d *outs;
+    outs = talloc_array(alloc, struct pl_rect2d, image->num_damage_rects);
+
+    int num = 0;
+    for (int i = 0; i < image->num_damage_rects; i++) {
+        struct pl_rect2d rc = image->damage_rects[i];
+        pl_rect2d_normalize(&rc);
+
+        // Map the expanded damage rect to the target, and clip it
+        float x0 = dst.x0 + (rc.x0 - margin - src.x0) * sx,
+              y0 = dst.y0 + (rc.y0 - margin - src.y0) * sy,
+              x1 = dst.x0 + (rc.x1 + margin - src.x0) * sx,
+              y1 = dst.y0 + (rc.y1 + margin - src.y0) * sy;
+
+        float ox0 = PL_MAX(floorf(PL_MIN(x0, x1)), full.x0),
+              oy0 = PL_MAX(floorf(PL_MIN(y0, y1)), full.y0),
+              ox1 = PL_MIN(ceilf(PL_MAX(x0, x1)), full.x1),
+              oy1 = PL_MIN(ceilf(PL_MAX(y0, y1)), full.y1);
+
+        if (ox1 <= ox0 || oy1 <= oy0)
+            continue;
+
+        align_range(&ox0, &ox1, full.x0, full.x1, PARTIAL_ALIGN);
+        align_range(&oy0, &oy1, full.y0, full.y1, PARTIAL_ALIGN);
+        outs[num++] = (struct pl_rect2d) { ox0, oy0, ox1, oy1 };
+    }
+
+    // Merge overlapping regions into their bounding box, so no pixel gets
+    // rendered (or counted) twice. Repeat until no more overlaps are left,
+    // since a merged region may grow to overlap previously checked ones.
+    bool merged;
+    do {
+        merged = false;
+        for (int i = 0; i < num; i++) {
+            for (int j = i + 1; j < num; j++) {
+                struct pl_rect2d *a = &outs[i], b = outs[j];
+                if (PL_MAX(a->x0, b.x0) >= PL_MIN(a->x1, b.x1) ||
+                    PL_MAX(a->y0, b.y0) >= PL_MIN(a->y1, b.y1))
+                {
+                    continue;
+                }
+
+                *a = (struct pl_rect2d) {
+                    .x0 = PL_MIN(a->x0, b.x0),
+                    .y0 = PL_MIN(a->y0, b.y0),
+                    .x1 = PL_MAX(a->x1, b.x1),
+                    .y1 = PL_MAX(a->y1, b.y1),
+                };
+                outs[j--] = outs[--num];
+                merged = true;
+            }
+        }
+    } while (merged);
+
+    struct pl_rect2df *srcs, *dsts;
+    srcs = talloc_array(alloc, struct pl_rect2df, num);
+    dsts = talloc_array(alloc, struct pl_rect2df, num);
+
+    float area = 0.0;
+    for (int i = 0; i < num; i++) {
+        struct pl_rect2d out = outs[i];
+        area += pl_rect_w(out) * pl_rect_h(out);
+
+        // Preserve the flipping of the original dst_rect, and map the result
+        // back to the corresponding (exact) source coordinates
+        struct pl_rect2df od = {
+            .x0 = sx < 0 ? out.x1 : out.x0,
+            .y0 = sy < 0 ? out.y1 : out.y0,
+            .x1 = sx < 0 ? out.x0 : out.x1,
+            .y1 = sy < 0 ? out.y0 : out.y1,
+        };
+
+        dsts[i] = od;
+        srcs[i] = (struct pl_rect2df) {
+            .x0 = src.x0 + (od.x0 - dst.x0) / sx,
+            .y0 = src.y0 + (od.y0 - dst.y0) / sy,
+            .x1 = src.x0 + (od.x1 - dst.x0) / sx,
+            .y1 = src.y0 + (od.y1 - dst.y0) / sy,
+        };
+    }
+
+    // Re-rendering everything is cheaper at this point
+    if (area >= pl_rect_w(full) * pl_rect_h(full))
         return false;
 
+    // The full rendering only reads the ref plane texels covered by its
+    // intermediate image, whose offset gets truncated (see pass_read_image)
+    struct pl_rect2df bounds = {
+        .x0 = truncf(src.x0),
+        .y0 = truncf(src.y0),
+        .x1 = truncf(src.x0) + roundf(pl_rect_w(src)),
+        .y1 = truncf(src.y0) + roundf(pl_rect_h(src)),
+    };
+    pl_rect2df_normalize(&bounds);
+
+    PL_TRACE(rr, "Re-rendering %d damaged region(s), %.0f of %d pixels",
+             num, area, pl_rect_w(full) * pl_rect_h(full));
+    *out_src = srcs;
+    *out_dst = dsts;
+    *out_num = num;
+    *out_bounds = bounds;
+    return true;
+}
+
+static bool render_image(struct pl_renderer *rr, const struct pl_image *pimage,
+                         const struct pl_render_target *ptarget,
+                         const struct pl_render_params *params,
+                         const struct pl_rect2df *partial_bounds)
+{
     struct pass_state pass = {
         .tmp = talloc_new(NULL),
         .rr = rr,
         .image = *pimage,
         .target = *ptarget,
+        .partial = !!partial_bounds,
+        .partial_bounds = partial_bounds ? *partial_bounds : (struct pl_rect2df) {0},
     };
 
     pass.fbos_used = talloc_zero_array(pass.tmp, bool, rr->num_fbos);
@@ -1707,12 +2506,16 @@ bool pl_render_image(struct pl_renderer *rr, const struct pl_image *pimage,
 
     // TODO: output caching
     pl_dispatch_reset_frame(rr->dp);
+    pl_dispatch_set_half_precision(rr->dp, params->half_precision);
 
     for (int i = 0; i < params->num_hooks; i++) {
         if (params->hooks[i]->reset)
             params->hooks[i]->reset(params->hooks[i]->priv);
     }
 
+    if (pass_blit_passthrough(&pass, params))
+        goto output_overlays;
+
     if (!pass_read_image(rr, &pass, params))
         goto error;
 
@@ -1740,6 +2543,7 @@ bool pl_render_image(struct pl_renderer *rr, const struct pl_image *pimage,
                       target->color, false, &scale, params);
     }
 
+output_overlays:
     // Draw the final output overlays
     draw_overlays(&pass, target->fbo, target->overlays, target->num_overlays,
                   target->color, false, NULL, params);
@@ -1754,6 +2558,40 @@ error:
     return false;
 }
 
+bool pl_render_image(struct pl_renderer *rr, const struct pl_image *pimage,
+                     const struct pl_render_target *ptarget,
+                     const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+    if (!validate_structs(rr, pimage, ptarget))
+        return false;
+
+    if (pimage->num_damage_rects > 0) {
+        void *tmp = talloc_new(NULL);
+        struct pl_rect2df *srcs, *dsts, bounds;
+        int num;
+        if (damage_regions(rr, pimage, ptarget, params, tmp, &srcs, &dsts, &num,
+                           &bounds))
+        {
+            struct pl_image image = *pimage;
+            struct pl_render_target target = *ptarget;
+            bool ok = true;
+            for (int i = 0; i < num; i++) {
+                image.src_rect = srcs[i];
+                target.dst_rect = dsts[i];
+                ok &= render_image(rr, &image, &target, params, &bounds);
+            }
+
+            talloc_free(tmp);
+            return ok;
+        }
+
+        talloc_free(tmp);
+    }
+
+    return render_image(rr, pimage, ptarget, params, NULL);
+}
+
 void pl_image_set_chroma_location(struct pl_image *image,
                                   enum pl_chroma_location chroma_loc)
 {
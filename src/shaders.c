@@ -16,26 +16,66 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include "common.h"
 #include "context.h"
 #include "shaders.h"
+#include "dispatch.h"
+
+struct sh_arena {
+    uint8_t *chunk;
+    size_t pos;
+    size_t size;
+    size_t used;
+    uint8_t data[]; // initial chunk
+};
+
+#define SH_ARENA_ALIGN 16
+#define SH_ARENA_MIN_SIZE 1024
+
+struct sh_arena *sh_arena_new(struct xta_ref *ref, size_t size)
+{
+    size = PL_ALIGN2(PL_MAX(size, SH_ARENA_MIN_SIZE), SH_ARENA_ALIGN);
+    struct sh_arena *arena = talloc_size(ref, sizeof(*arena) + size);
+    *arena = (struct sh_arena) {
+        .chunk = arena->data,
+        .size = size,
+    };
+
+    return arena;
+}
+
+void *sh_arena_alloc(struct sh_arena *arena, size_t size)
+{
+    size = PL_ALIGN2(size, SH_ARENA_ALIGN);
+    if (arena->pos + size > arena->size) {
+        // Chunks can't be freed individually, so just start a new one (as a
+        // child of the arena, so it gets freed along with it)
+        arena->size = PL_MAX(2 * arena->size, size);
+        arena->chunk = talloc_size(arena, arena->size);
+        arena->pos = 0;
+    }
+
+    void *ptr = arena->chunk + arena->pos;
+    arena->pos += size;
+    arena->used += size;
+    return ptr;
+}
+
+size_t sh_arena_used(const struct sh_arena *arena)
+{
+    return arena->used;
+}
 
 struct pl_shader *pl_shader_alloc(struct pl_context *ctx,
                                   const struct pl_shader_params *params)
 {
     pl_assert(ctx);
     struct pl_shader *sh = talloc_ptrtype(ctx, sh);
-    *sh = (struct pl_shader) {
-        .ctx = ctx,
-        .mutable = true,
-        .tmp = talloc_ref_new(ctx),
-    };
-
-    if (params)
-        sh->res.params = *params;
-
+    *sh = (struct pl_shader) { .ctx = ctx };
+    pl_shader_reset(sh, params);
     return sh;
 }
 
@@ -50,18 +90,33 @@ void pl_shader_free(struct pl_shader **psh)
 }
 
 void pl_shader_reset(struct pl_shader *sh, const struct pl_shader_params *params)
+{
+    sh_reset_arena(sh, params, NULL, NULL);
+}
+
+void sh_reset_arena(struct pl_shader *sh, const struct pl_shader_params *params,
+                    struct xta_ref *ref, struct sh_arena *arena)
 {
     struct pl_shader new = {
         .ctx = sh->ctx,
-        .tmp = talloc_ref_new(sh->ctx),
+        .tmp = ref ? talloc_ref_dup(ref) : talloc_ref_new(sh->ctx),
+        .arena = arena,
         .mutable = true,
 
         // Preserve array allocations
         .variables      = sh->variables,
         .descriptors    = sh->descriptors,
         .vertex_attribs = sh->vertex_attribs,
+        .steps          = sh->steps,
     };
 
+    // Size private arenas based on the previous usage, to avoid needing to
+    // allocate additional chunks when generating the same shader again
+    if (!new.arena) {
+        size_t size = sh->arena ? sh_arena_used(sh->arena) : 0;
+        new.arena = sh_arena_new(new.tmp, size);
+    }
+
     if (params)
         new.res.params = *params;
 
@@ -171,27 +226,139 @@ bool pl_shader_output_size(const struct pl_shader *sh, int *w, int *h)
     return true;
 }
 
+// Order-dependent combination of two hashes
+static inline uint64_t sig_fold(uint64_t sig, uint64_t hash)
+{
+    return sig ^ (hash + 0x9e3779b97f4a7c15LLU + (sig << 6) + (sig >> 2));
+}
+
+// The state of a pl_shader (other than the text, variables etc.) which may
+// affect or be modified by shader builders. This is part of the key of
+// memoized builders, but not of the shader's signature.
+struct sh_state {
+    int output_w, output_h;
+    enum pl_shader_sig input, output;
+    bool is_compute, flexible_work_groups;
+    int compute_group_size[2];
+    size_t compute_shmem;
+    enum pl_sampler_type sampler_type;
+    char sampler_prefix;
+    int fresh;
+};
+
+static struct sh_state sh_get_state(const struct pl_shader *sh)
+{
+    struct sh_state st;
+    memset(&st, 0, sizeof(st)); // for hashing
+    st.output_w = sh->output_w;
+    st.output_h = sh->output_h;
+    st.input = sh->res.input;
+    st.output = sh->res.output;
+    st.is_compute = sh->is_compute;
+    st.flexible_work_groups = sh->flexible_work_groups;
+    st.compute_group_size[0] = sh->res.compute_group_size[0];
+    st.compute_group_size[1] = sh->res.compute_group_size[1];
+    st.compute_shmem = sh->res.compute_shmem;
+    st.sampler_type = sh->sampler_type;
+    st.sampler_prefix = sh->sampler_prefix;
+    st.fresh = sh->fresh;
+    return st;
+}
+
+static void sh_set_state(struct pl_shader *sh, const struct sh_state *st)
+{
+    sh->output_w = st->output_w;
+    sh->output_h = st->output_h;
+    sh->res.input = st->input;
+    sh->res.output = st->output;
+    sh->is_compute = st->is_compute;
+    sh->flexible_work_groups = st->flexible_work_groups;
+    sh->res.compute_group_size[0] = st->compute_group_size[0];
+    sh->res.compute_group_size[1] = st->compute_group_size[1];
+    sh->res.compute_shmem = st->compute_shmem;
+    sh->sampler_type = st->sampler_type;
+    sh->sampler_prefix = st->sampler_prefix;
+    sh->fresh = st->fresh;
+}
+
 uint64_t pl_shader_signature(const struct pl_shader *sh)
 {
-    uint64_t res = 0;
-    for (int i = 0; i < PL_ARRAY_SIZE(sh->buffers); i++)
-        res ^= bstr_hash64(sh->buffers[i]);
+    // The text is hashed incrementally as it's appended, so only the state
+    // which affects the generated pass (but isn't reflected in the text)
+    // needs to be hashed here. In particular, the output size must not be
+    // included, since it would make every resolution compile a new pass.
+    struct {
+        enum pl_shader_sig input, output;
+        bool is_compute;
+        int compute_group_size[2];
+        size_t compute_shmem;
+    } st;
+
+    memset(&st, 0, sizeof(st)); // for hashing
+    st.input = sh->res.input;
+    st.output = sh->res.output;
+    st.is_compute = sh->is_compute;
+    if (st.is_compute) {
+        st.compute_group_size[0] = sh->res.compute_group_size[0];
+        st.compute_group_size[1] = sh->res.compute_group_size[1];
+        st.compute_shmem = sh->res.compute_shmem;
+    }
+
+    uint64_t res = sig_fold(sh->sig, bstr_hash64((struct bstr) {
+        (void *) &st, sizeof(st)
+    }));
 
     // FIXME: also hash in the configuration of the descriptors/variables
 
     return res;
 }
 
+// Writes the decimal representation of `x` into the bytes preceding `end`,
+// and returns a pointer to the first digit
+static char *format_uint(char *end, unsigned int x)
+{
+    do {
+        *--end = '0' + x % 10;
+        x /= 10;
+    } while (x);
+
+    return end;
+}
+
 ident_t sh_fresh(struct pl_shader *sh, const char *name)
 {
-    return talloc_asprintf(sh->tmp, "_%s_%d_%u", PL_DEF(name, "var"),
-                           sh->fresh++, SH_PARAMS(sh).id);
+    // Equivalent to "_%s_%d_%u", but this is called for every identifier
+    // in every shader, so avoid the overhead of printf
+    char nums[2 * 11];
+    char *fresh = format_uint(&nums[11], sh->fresh++);
+    char *id = format_uint(&nums[22], SH_PARAMS(sh).id);
+    size_t fresh_len = &nums[11] - fresh,
+           id_len    = &nums[22] - id;
+
+    name = PL_DEF(name, "var");
+    size_t name_len = strlen(name);
+    char *out = sh_alloc(sh, name_len + fresh_len + id_len + 4);
+    char *pos = out;
+    *pos++ = '_';
+    memcpy(pos, name, name_len);
+    pos += name_len;
+    *pos++ = '_';
+    memcpy(pos, fresh, fresh_len);
+    pos += fresh_len;
+    *pos++ = '_';
+    memcpy(pos, id, id_len);
+    pos += id_len;
+    *pos = '\0';
+    return out;
 }
 
 ident_t sh_var(struct pl_shader *sh, struct pl_shader_var sv)
 {
+    size_t size = pl_var_host_layout(0, &sv.var).size;
+    void *data = sh_alloc(sh, size);
+    memcpy(data, sv.data, size);
     sv.var.name = sh_fresh(sh, sv.var.name);
-    sv.data = talloc_memdup(sh->tmp, sv.data, pl_var_host_layout(0, &sv.var).size);
+    sv.data = data;
     TARRAY_APPEND(sh, sh->variables, sh->res.num_variables, sv);
     return (ident_t) sv.var.name;
 }
@@ -240,7 +407,8 @@ ident_t sh_attr_vec2(struct pl_shader *sh, const char *name,
         { rc->x1, rc->y1 },
     };
 
-    float *data = talloc_memdup(sh->tmp, &vals[0][0], sizeof(vals));
+    float *data = sh_alloc(sh, sizeof(vals));
+    memcpy(data, vals, sizeof(vals));
     struct pl_shader_va va = {
         .attr = {
             .name     = sh_fresh(sh, name),
@@ -357,10 +525,32 @@ void pl_shader_append(struct pl_shader *sh, enum pl_shader_buf buf,
 {
     pl_assert(buf >= 0 && buf < SH_BUF_COUNT);
 
+    size_t len = sh->buffers[buf].len;
     va_list ap;
     va_start(ap, fmt);
     bstr_xappend_vasprintf_c(sh, &sh->buffers[buf], fmt, ap);
     va_end(ap);
+
+    struct bstr str = bstr_cut(sh->buffers[buf], len);
+    sh->sig = sig_fold(sh->sig, bstr_hash64(str) + buf);
+}
+
+void sh_describe(struct pl_shader *sh, const char *fmt, ...)
+{
+    if (!sh->describe)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+
+    char *desc = sh_alloc(sh, len + 1);
+    va_start(ap, fmt);
+    vsnprintf(desc, len + 1, fmt, ap);
+    va_end(ap);
+
+    TARRAY_APPEND(sh, sh->steps, sh->num_steps, desc);
 }
 
 void pl_shader_append_bstr(struct pl_shader *sh, enum pl_shader_buf buf,
@@ -368,6 +558,203 @@ void pl_shader_append_bstr(struct pl_shader *sh, enum pl_shader_buf buf,
 {
     pl_assert(buf >= 0 && buf < SH_BUF_COUNT);
     bstr_xappend(sh, &sh->buffers[buf], str);
+    sh->sig = sig_fold(sh->sig, bstr_hash64(str) + buf);
+}
+
+#define SH_MEMO_ENTRIES 128
+
+struct sh_memo_entry {
+    uint64_t key;
+    bool impure; // only the key is valid
+
+    // Changes to the shader made by the memoized call
+    struct sh_state state;
+    uint64_t sig;
+    struct bstr text[SH_BUF_COUNT];
+    struct pl_shader_var *vars;
+    struct pl_shader_desc *descs;
+    struct pl_shader_va *vas;
+    const char **steps;
+    int num_vars, num_descs, num_vas, num_steps;
+    void *out;
+};
+
+struct sh_memo_cache {
+    struct sh_memo_entry *entries[SH_MEMO_ENTRIES];
+};
+
+struct sh_memo_cache *sh_memo_cache_create(void *tactx)
+{
+    return talloc_zero(tactx, struct sh_memo_cache);
+}
+
+// Size of the host data associated with a vertex attribute
+static size_t va_size(const struct pl_shader_va *va)
+{
+    return va->attr.fmt->texel_size;
+}
+
+bool sh_memo_begin(struct pl_shader *sh, struct sh_memo *memo, const char *name,
+                   const void *key, size_t key_size)
+{
+    memo->key = 0;
+    if (!sh->memo)
+        return false;
+
+    struct {
+        uint64_t key;
+        const char *name;
+        const struct pl_gpu *gpu;
+        struct pl_glsl_desc glsl;
+        struct sh_state state;
+        uint8_t id;
+        bool half;
+        bool describe;
+    } k;
+
+    memset(&k, 0, sizeof(k));
+    k.key = bstr_hash64((struct bstr) { (void *) key, key_size });
+    k.name = name;
+    k.gpu = SH_GPU(sh);
+    k.glsl = SH_PARAMS(sh).glsl;
+    k.state = sh_get_state(sh);
+    k.id = SH_PARAMS(sh).id;
+    k.half = SH_PARAMS(sh).half_precision;
+    k.describe = sh->describe;
+
+    uint64_t hash = bstr_hash64((struct bstr) { (void *) &k, sizeof(k) });
+    hash = PL_DEF(hash, 1); // 0 is reserved for "disabled"
+
+    struct sh_memo_entry *e = sh->memo->entries[hash % SH_MEMO_ENTRIES];
+    if (e && e->key == hash) {
+        if (e->impure)
+            return false; // no point in recording again
+
+        for (int i = 0; i < SH_BUF_COUNT; i++)
+            bstr_xappend(sh, &sh->buffers[i], e->text[i]);
+        sh->sig = sig_fold(sh->sig, e->sig);
+        sh_set_state(sh, &e->state);
+
+        // Copy the names and data, since the entry may get evicted while
+        // the shader is still alive
+        for (int i = 0; i < e->num_vars; i++) {
+            struct pl_shader_var sv = e->vars[i];
+            size_t size = pl_var_host_layout(0, &sv.var).size;
+            void *data = sh_alloc(sh, size);
+            memcpy(data, sv.data, size);
+            sv.var.name = sh_strdup(sh, sv.var.name);
+            sv.data = data;
+            TARRAY_APPEND(sh, sh->variables, sh->res.num_variables, sv);
+        }
+
+        for (int i = 0; i < e->num_descs; i++) {
+            struct pl_shader_desc sd = e->descs[i];
+            sd.desc.name = sh_strdup(sh, sd.desc.name);
+            TARRAY_APPEND(sh, sh->descriptors, sh->res.num_descriptors, sd);
+        }
+
+        for (int i = 0; i < e->num_vas; i++) {
+            struct pl_shader_va va = e->vas[i];
+            size_t size = va_size(&va);
+            uint8_t *data = sh_alloc(sh, 4 * size);
+            for (int n = 0; n < 4; n++) {
+                memcpy(data + n * size, va.data[n], size);
+                va.data[n] = data + n * size;
+            }
+            va.attr.name = sh_strdup(sh, va.attr.name);
+            TARRAY_APPEND(sh, sh->vertex_attribs, sh->res.num_vertex_attribs, va);
+        }
+
+        for (int i = 0; i < e->num_steps; i++)
+            TARRAY_APPEND(sh, sh->steps, sh->num_steps, sh_strdup(sh, e->steps[i]));
+
+        if (memo->out_size)
+            memcpy(memo->out, e->out, memo->out_size);
+        return true;
+    }
+
+    // Start recording. The signature of the recorded text is computed
+    // separately, so it can be folded into the shader's signature the same
+    // way regardless of whether the result was replayed or not
+    memo->key = hash;
+    memo->sig = sh->sig;
+    sh->sig = 0;
+    for (int i = 0; i < SH_BUF_COUNT; i++)
+        memo->lens[i] = sh->buffers[i].len;
+    memo->num_vars = sh->res.num_variables;
+    memo->num_descs = sh->res.num_descriptors;
+    memo->num_vas = sh->res.num_vertex_attribs;
+    memo->num_steps = sh->num_steps;
+    memo->impure = sh->impure;
+    return false;
+}
+
+void sh_memo_end(struct pl_shader *sh, struct sh_memo *memo)
+{
+    if (!memo->key)
+        return;
+
+    uint64_t sig = sh->sig;
+    sh->sig = sig_fold(memo->sig, sig);
+    if (sh->failed)
+        return;
+
+    struct sh_memo_entry **slot = &sh->memo->entries[memo->key % SH_MEMO_ENTRIES];
+    talloc_free(*slot);
+    struct sh_memo_entry *e = *slot = talloc_zero(sh->memo, struct sh_memo_entry);
+    e->key = memo->key;
+
+    bool impure = sh->impure != memo->impure;
+    for (int i = memo->num_vars; i < sh->res.num_variables; i++)
+        impure |= sh->variables[i].dynamic;
+    for (int i = memo->num_descs; i < sh->res.num_descriptors; i++)
+        impure |= sh->descriptors[i].num_buffer_vars > 0;
+    for (int i = 0; i < SH_BUF_COUNT; i++)
+        impure |= sh->buffers[i].len < memo->lens[i];
+    if (impure) {
+        e->impure = true;
+        return;
+    }
+
+    e->state = sh_get_state(sh);
+    e->sig = sig;
+    for (int i = 0; i < SH_BUF_COUNT; i++) {
+        struct bstr text = bstr_cut(sh->buffers[i], memo->lens[i]);
+        e->text[i] = bstrdup(e, text);
+    }
+
+    e->num_vars = sh->res.num_variables - memo->num_vars;
+    e->vars = talloc_memdup(e, &sh->variables[memo->num_vars],
+                            e->num_vars * sizeof(e->vars[0]));
+    for (int i = 0; i < e->num_vars; i++) {
+        struct pl_shader_var *sv = &e->vars[i];
+        sv->var.name = talloc_strdup(e, sv->var.name);
+        sv->data = talloc_memdup(e, sv->data, pl_var_host_layout(0, &sv->var).size);
+    }
+
+    e->num_descs = sh->res.num_descriptors - memo->num_descs;
+    e->descs = talloc_memdup(e, &sh->descriptors[memo->num_descs],
+                             e->num_descs * sizeof(e->descs[0]));
+    for (int i = 0; i < e->num_descs; i++)
+        e->descs[i].desc.name = talloc_strdup(e, e->descs[i].desc.name);
+
+    e->num_vas = sh->res.num_vertex_attribs - memo->num_vas;
+    e->vas = talloc_memdup(e, &sh->vertex_attribs[memo->num_vas],
+                           e->num_vas * sizeof(e->vas[0]));
+    for (int i = 0; i < e->num_vas; i++) {
+        struct pl_shader_va *va = &e->vas[i];
+        va->attr.name = talloc_strdup(e, va->attr.name);
+        for (int n = 0; n < 4; n++)
+            va->data[n] = talloc_memdup(e, va->data[n], va_size(va));
+    }
+
+    e->num_steps = sh->num_steps - memo->num_steps;
+    e->steps = talloc_zero_array(e, const char *, e->num_steps);
+    for (int i = 0; i < e->num_steps; i++)
+        e->steps[i] = talloc_strdup(e, sh->steps[memo->num_steps + i]);
+
+    if (memo->out_size)
+        e->out = talloc_memdup(e, memo->out, memo->out_size);
 }
 
 static const char *insigs[] = {
@@ -431,6 +818,7 @@ ident_t sh_subpass(struct pl_shader *sh, const struct pl_shader *sub)
     // Append the prelude and header
     bstr_xappend(sh, &sh->buffers[SH_BUF_PRELUDE], sub->buffers[SH_BUF_PRELUDE]);
     bstr_xappend(sh, &sh->buffers[SH_BUF_HEADER],  sub->buffers[SH_BUF_HEADER]);
+    sh->sig = sig_fold(sh->sig, pl_shader_signature(sub));
 
     // Append the body as a new header function
     ident_t name = sh_fresh(sh, "sub");
@@ -446,12 +834,14 @@ ident_t sh_subpass(struct pl_shader *sh, const struct pl_shader *sub)
     GLSLH("%s\n}\n\n", retvals[sub->res.output]);
 
     // Copy over all of the descriptors etc.
-    talloc_ref_attach(sh->tmp, sub->tmp);
+    if (sub->tmp != sh->tmp)
+        talloc_ref_attach(sh->tmp, sub->tmp);
 #define COPY(f) TARRAY_CONCAT(sh, sh->f, sh->res.num_##f, sub->f, sub->res.num_##f)
     COPY(variables);
     COPY(descriptors);
     COPY(vertex_attribs);
 #undef COPY
+    TARRAY_CONCAT(sh, sh->steps, sh->num_steps, sub->steps, sub->num_steps);
 
     return name;
 }
@@ -584,6 +974,9 @@ void *sh_require_obj(struct pl_shader *sh, struct pl_shader_obj **ptr,
     if (!ptr)
         return NULL;
 
+    // Shader objects carry state between calls, so this can't be memoized
+    sh->impure++;
+
     struct pl_shader_obj *obj = *ptr;
     if (obj && obj->gpu != SH_GPU(sh)) {
         SH_FAIL(sh, "Passed pl_shader_obj belongs to different GPU!");
@@ -677,6 +1070,24 @@ struct sh_lut_obj {
     void *data;
 };
 
+// Returns a key identifying the contents of a LUT inside the shared cache
+static uint64_t sh_lut_key(const struct sh_lut_params *params)
+{
+    struct {
+        uint64_t signature;
+        int type, width, height, depth, comps;
+    } key;
+
+    memset(&key, 0, sizeof(key)); // also clear the padding
+    key.signature = params->signature;
+    key.type = params->type;
+    key.width = params->width;
+    key.height = params->height;
+    key.depth = params->depth;
+    key.comps = params->comps;
+    return bstr_hash64((struct bstr) { (void *) &key, sizeof(key) });
+}
+
 static void sh_lut_uninit(const struct pl_gpu *gpu, void *ptr)
 {
     struct sh_lut_obj *lut = ptr;
@@ -801,7 +1212,19 @@ next_dim: ; // `continue` out of the inner loop
     if (update) {
         size_t buf_size = size * params->comps * pl_var_type_size(params->type);
         tmp = talloc_zero_size(NULL, buf_size);
-        params->fill(tmp, params);
+
+        // Try re-using the contents generated by another user of the shared
+        // cache. (The textures themselves are never shared, since their
+        // usage state is not thread-safe)
+        bool shared = sh->cache && params->signature && !params->dynamic;
+        uint64_t key = shared ? sh_lut_key(params) : 0;
+        if (shared && pl_dispatch_cache_get_lut(sh->cache, key, tmp, buf_size)) {
+            PL_TRACE(sh, "Re-using shared LUT contents");
+        } else {
+            params->fill(tmp, params);
+            if (shared)
+                pl_dispatch_cache_add_lut(sh->cache, key, tmp, buf_size);
+        }
 
         switch (method) {
         case SH_LUT_TEXTURE:
@@ -1000,7 +1423,7 @@ next_dim: ; // `continue` out of the inner loop
         arr_name = sh_fresh(sh, "weights");
         GLSLH("const %s %s[%d] = %s[](\n  ",
               types[params->comps - 1], arr_name, size, dtypes[params->type]);
-        bstr_xappend(sh, &sh->buffers[SH_BUF_HEADER], lut->str);
+        pl_shader_append_bstr(sh, SH_BUF_HEADER, lut->str);
         GLSLH(");\n");
         break;
 
@@ -1044,3 +1467,40 @@ const char *sh_bvec(const struct pl_shader *sh, int dims)
     pl_assert(dims > 0 && dims < PL_ARRAY_SIZE(bvecs));
     return sh_glsl(sh).version >= 130 ? bvecs[dims] : vecs[dims];
 }
+
+const char *sh_half(const struct pl_shader *sh, int dims, bool decl)
+{
+    static const char *vecs[] = {
+        [1] = "float",
+        [2] = "vec2",
+        [3] = "vec3",
+        [4] = "vec4",
+    };
+
+    static const char *mediump[] = {
+        [1] = "mediump float",
+        [2] = "mediump vec2",
+        [3] = "mediump vec3",
+        [4] = "mediump vec4",
+    };
+
+    static const char *f16vecs[] = {
+        [1] = "float16_t",
+        [2] = "f16vec2",
+        [3] = "f16vec3",
+        [4] = "f16vec4",
+    };
+
+    pl_assert(dims > 0 && dims < PL_ARRAY_SIZE(vecs));
+    if (!SH_PARAMS(sh).half_precision)
+        return vecs[dims];
+
+    struct pl_glsl_desc glsl = sh_glsl(sh);
+    const struct pl_gpu *gpu = SH_GPU(sh);
+    if (glsl.vulkan && gpu && (gpu->caps & PL_GPU_CAP_FLOAT16))
+        return f16vecs[dims];
+    if (glsl.gles)
+        return decl ? mediump[dims] : vecs[dims];
+
+    return vecs[dims];
+}
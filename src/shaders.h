@@ -18,6 +18,7 @@
 #pragma once
 
 #include <stdio.h>
+#include <string.h>
 
 #include "common.h"
 #include "context.h"
@@ -38,8 +39,12 @@ enum pl_shader_buf {
 
 struct pl_shader {
     struct pl_context *ctx;
+    struct pl_dispatch_cache *cache; // for sharing LUT contents, optional
+    struct pl_dispatch *dp; // for running auxiliary passes, optional
+    struct sh_memo_cache *memo; // for memoizing shader builders, optional
     struct pl_shader_res res; // for accumulating some of the fields
-    struct xta_ref *tmp; // only used for var/va/desc names and var/va data
+    struct xta_ref *tmp; // keeps `arena` (and merged subpasses) alive
+    struct sh_arena *arena; // only used for var/va/desc names and var/va data
     bool failed;
     bool mutable;
     int output_w;
@@ -50,6 +55,15 @@ struct pl_shader {
     enum pl_sampler_type sampler_type;
     char sampler_prefix;
     int fresh;
+    uint64_t sig; // running signature of all appended text
+    int impure; // number of operations which can't be memoized
+
+    // human-readable descriptions of the steps performed by this shader,
+    // only recorded if `describe` is set (see `sh_describe`)
+    bool describe;
+    const char **steps;
+    int num_steps;
+    uint64_t begin_ns; // time at which the shader was begun, for statistics
 
     // mutable versions of the fields from pl_shader_res
     struct pl_shader_va *vertex_attribs;
@@ -57,6 +71,35 @@ struct pl_shader {
     struct pl_shader_desc *descriptors;
 };
 
+// Simple bump allocator for the temporary memory needed while generating
+// shaders. Allocations can't be freed individually; instead, all of the
+// memory is released at once when the owning `xta_ref` is freed. This
+// allows pl_dispatch to share a single arena between all of the shaders
+// generated in a frame. `size` is the size of the initial chunk.
+struct sh_arena;
+struct sh_arena *sh_arena_new(struct xta_ref *ref, size_t size);
+void *sh_arena_alloc(struct sh_arena *arena, size_t size);
+
+// Total number of bytes allocated from an arena
+size_t sh_arena_used(const struct sh_arena *arena);
+
+// Like `pl_shader_reset`, but makes the shader allocate its temporary memory
+// from the given arena (which must be owned by `ref`) instead of its own.
+void sh_reset_arena(struct pl_shader *sh, const struct pl_shader_params *params,
+                    struct xta_ref *ref, struct sh_arena *arena);
+
+// Allocate temporary memory which lives as long as the shader's identifiers
+static inline void *sh_alloc(struct pl_shader *sh, size_t size)
+{
+    return sh_arena_alloc(sh->arena, size);
+}
+
+static inline char *sh_strdup(struct pl_shader *sh, const char *str)
+{
+    size_t size = strlen(str) + 1;
+    return memcpy(sh_alloc(sh, size), str, size);
+}
+
 // Helper functions for convenience
 #define SH_PARAMS(sh) ((sh)->res.params)
 #define SH_GPU(sh) (SH_PARAMS(sh).gpu)
@@ -69,6 +112,12 @@ struct pl_glsl_desc sh_glsl(const struct pl_shader *sh);
         PL_ERR(sh, __VA_ARGS__); \
     } while (0)
 
+// Records a short, human-readable description of an operation performed by
+// this shader (e.g. "polar upscale 1080->2160"), for use in statistics. This
+// is a no-op unless requested by the pl_dispatch.
+void sh_describe(struct pl_shader *sh, const char *fmt, ...)
+    PRINTF_ATTRIBUTE(2, 3);
+
 // Attempt enabling compute shaders for this pass, if possible
 bool sh_try_compute(struct pl_shader *sh, int bw, int bh, bool flex, size_t mem);
 
@@ -77,6 +126,40 @@ bool sh_try_compute(struct pl_shader *sh, int bw, int bh, bool flex, size_t mem)
 // corresponding to the generated subpass function.
 ident_t sh_subpass(struct pl_shader *sh, const struct pl_shader *sub);
 
+// Memoization of the code generated by high-level shader builders. Most of
+// the shaders generated for a frame are identical to the ones generated for
+// the previous frame, so builders which are pure functions of their
+// parameters can record the text, variables, descriptors and vertex
+// attributes they generate, and replay them on subsequent calls instead of
+// generating them again. Operations with external side effects (shader
+// objects, dynamic variables) automatically prevent a result from being
+// memoized.
+struct sh_memo_cache;
+struct sh_memo_cache *sh_memo_cache_create(void *tactx);
+
+struct sh_memo {
+    // Optional extra state modified by the builder (e.g. an output
+    // parameter), which gets saved/restored along with the generated code
+    void *out;
+    size_t out_size;
+
+    // Internal state, used to track the changes made while recording
+    uint64_t key;
+    uint64_t sig;
+    size_t lens[SH_BUF_COUNT];
+    int num_vars, num_descs, num_vas, num_steps;
+    int impure;
+};
+
+// Looks up the result of a previous call to the builder `name` with the same
+// `key` (which must include every input affecting the generated code, other
+// than the state of the pl_shader itself) and replays it, returning true.
+// Otherwise, starts recording and returns false; the caller must then
+// generate the code as usual and call `sh_memo_end` (unless the shader fails).
+bool sh_memo_begin(struct pl_shader *sh, struct sh_memo *memo, const char *name,
+                   const void *key, size_t key_size);
+void sh_memo_end(struct pl_shader *sh, struct sh_memo *memo);
+
 // Helpers for adding new variables/descriptors/etc. with fresh, unique
 // identifier names. These will never conflcit with other identifiers, even
 // if the shaders are merged together.
@@ -146,6 +229,7 @@ enum pl_shader_obj_type {
     PL_SHADER_OBJ_3DLUT,
     PL_SHADER_OBJ_LUT,
     PL_SHADER_OBJ_AV1_GRAIN,
+    PL_SHADER_OBJ_TONE_MAP,
 };
 
 struct pl_shader_obj {
@@ -205,6 +289,13 @@ struct sh_lut_params {
     // rather than being treated as read-only.
     bool dynamic;
 
+    // If nonzero, uniquely identifies the contents of this LUT. This allows
+    // the contents to be shared via the `pl_dispatch_cache`, so only the first
+    // user needs to call `fill`. Callers should namespace this value, e.g. by
+    // placing the `pl_shader_obj_type` in the upper bits. Ignored for
+    // `dynamic` LUTs.
+    uint64_t signature;
+
     // Will be called with a zero-initialized buffer whenever the data needs to
     // be computed, which happens whenever the size is changed, the shader
     // object is invalidated, or `update` is set to true.
@@ -227,6 +318,13 @@ ident_t sh_lut(struct pl_shader *sh, const struct sh_lut_params *params);
 // this function is with mix(), which only accepts bvec in GLSL 130+.
 const char *sh_bvec(const struct pl_shader *sh, int dims);
 
+// Returns the type to use for `dims`-component intermediate values that may
+// be computed in half precision (see `pl_shader_params.half_precision`), or
+// the regular vecN if this is disabled or unsupported. If `decl` is true,
+// returns the form suitable for variable declarations (which may include a
+// precision qualifier), otherwise the form suitable for conversions.
+const char *sh_half(const struct pl_shader *sh, int dims, bool decl);
+
 // Returns the appropriate `texture`-equivalent function for the shader and
 // given texture.
 static inline const char *sh_tex_fn(const struct pl_shader *sh,
@@ -525,6 +525,13 @@ struct sh_grain_obj {
     struct pl_av1_grain_data data;
     struct pl_color_repr repr;
 
+    // Grain textures generated on the GPU, and the LUTs needed to do so
+    bool gpu_grain;
+    const struct pl_tex *grain_tex[3];
+    struct pl_shader_obj *lut_gauss;
+    struct pl_shader_obj *lut_jumps;
+    int jumps_w;
+
     // Space to store the temporary arrays, reused
     uint32_t *offsets;
     float grain[2][GRAIN_HEIGHT_LUT][GRAIN_WIDTH_LUT];
@@ -540,6 +547,10 @@ static void sh_grain_uninit(const struct pl_gpu *gpu, void *ptr)
         pl_shader_obj_destroy(&obj->lut_grain[i]);
     for (int i = 0; i < PL_ARRAY_SIZE(obj->lut_scaling); i++)
         pl_shader_obj_destroy(&obj->lut_scaling[i]);
+    for (int i = 0; i < PL_ARRAY_SIZE(obj->grain_tex); i++)
+        pl_tex_destroy(gpu, &obj->grain_tex[i]);
+    pl_shader_obj_destroy(&obj->lut_gauss);
+    pl_shader_obj_destroy(&obj->lut_jumps);
     *obj = (struct sh_grain_obj) {0};
 }
 
@@ -604,6 +615,330 @@ static void fill_grain_lut(void *data, const struct sh_lut_params *params)
     memcpy(data, obj->grain, entries * sizeof(float));
 }
 
+static void fill_gaussian(void *pdata, const struct sh_lut_params *params)
+{
+    pl_assert(params->width == PL_ARRAY_SIZE(gaussian_sequence));
+    int *data = pdata;
+    for (int i = 0; i < params->width; i++)
+        data[i] = gaussian_sequence[i];
+}
+
+// Since the LFSR used by `get_random_number` is linear, the state after any
+// number of steps can be computed by XORing together the states reached from
+// each individual bit of the seed. Entry [y][b] contains the state reached
+// after advancing (1 << b) by y rows worth of random numbers, for the luma
+// (first component) and chroma (second component) grain buffers.
+static void generate_jumps(void *pdata, const struct sh_lut_params *params)
+{
+    pl_assert(params->width == 16 && params->comps == 2);
+    const int widths[2] = { GRAIN_WIDTH, *(const int *) params->priv };
+    unsigned int *data = pdata;
+
+    for (int c = 0; c < 2; c++) {
+        for (int b = 0; b < 16; b++) {
+            uint16_t state = 1 << b;
+            for (int y = 0; y < params->height; y++) {
+                data[(y * 16 + b) * 2 + c] = state;
+                for (int x = 0; x < widths[c]; x++)
+                    get_random_number(1, &state);
+            }
+        }
+    }
+}
+
+// Declares a grain buffer of the given size in shared memory, storing two
+// (16-bit) grain values per element. Returns the names of the accessors.
+static void grain_buf(struct pl_shader *sh, int w, int h, ident_t *get,
+                      ident_t *set)
+{
+    pl_assert(w % 2 == 0);
+    ident_t buf = sh_fresh(sh, "grain_buf");
+    *get = sh_fresh(sh, "grain_get");
+    *set = sh_fresh(sh, "grain_set");
+
+    GLSLH("shared uint %s[%d];                                      \n"
+          "int %s(int x, int y) {                                   \n"
+          "    uint v = %s[(y * %d + x) >> 1];                      \n"
+          "    return (x & 1) == 1 ? int(v) >> 16 : int(v << 16) >> 16; \n"
+          "}                                                        \n"
+          "void %s(int x, int y, int val) {                         \n"
+          "    int i = (y * %d + x) >> 1;                           \n"
+          "    uint u = uint(val) & 0xFFFFu;                        \n"
+          "    %s[i] = (x & 1) == 1 ? (%s[i] & 0xFFFFu) | (u << 16) \n"
+          "                         : (%s[i] & 0xFFFF0000u) | u;    \n"
+          "}                                                        \n",
+          buf, w * h / 2,
+          *get, buf, w,
+          *set, w, buf, buf, buf);
+}
+
+// Generates a single grain plane, following `generate_grain_y` and
+// `generate_grain_uv`, and writes the relevant subsection to `out`.
+static void emit_grain_plane(struct pl_shader *sh, const struct pl_tex *out,
+                             enum pl_channel channel, ident_t get, ident_t set,
+                             ident_t get_y, int sub_x, int sub_y,
+                             ident_t seed, ident_t gauss, ident_t jumps,
+                             ident_t round2_fn,
+                             const struct pl_av1_grain_params *params)
+{
+    const struct pl_av1_grain_data *data = &params->data;
+    struct grain_scale scale = get_grain_scale(params);
+    int bit_depth = PL_DEF(params->repr->bits.color_depth, 8);
+    int shift = 12 - bit_depth + data->grain_scale_shift;
+    pl_assert(shift >= 0);
+
+    bool is_y = channel == PL_CHANNEL_Y;
+    int w = is_y || !sub_x ? GRAIN_WIDTH  : SUB_GRAIN_WIDTH;
+    int h = is_y || !sub_y ? GRAIN_HEIGHT : SUB_GRAIN_HEIGHT;
+    int seed_xor = 0;
+    if (channel == PL_CHANNEL_CB) {
+        seed_xor = 0xb524;
+    } else if (channel == PL_CHANNEL_CR) {
+        seed_xor = 0x49d8;
+    }
+
+    // Fill in the gaussian noise, one row per thread
+    GLSL("if (y < %d) {                                             \n"
+         "    uint st = 0u;                                         \n"
+         "    uint s = %s ^ %du;                                    \n"
+         "    for (int b = 0; b < 16; b++) {                        \n"
+         "        if (((s >> uint(b)) & 1u) == 1u)                  \n"
+         "            st ^= uint(%s(ivec2(b, y)).%c);               \n"
+         "    }                                                     \n"
+         "    for (int x = 0; x < %d; x++) {                        \n"
+         "        uint bit = (st ^ (st >> 1) ^ (st >> 3) ^ (st >> 12)) & 1u; \n"
+         "        st = (st >> 1) | (bit << 15);                     \n"
+         "        %s(x, y, %s(int(%s(int((st >> 5) & 0x7FFu))), %d)); \n"
+         "    }                                                     \n"
+         "}                                                         \n"
+         "memoryBarrierShared();                                    \n"
+         "barrier();                                                \n",
+         h, seed, seed_xor, jumps, is_y ? 'x' : 'y', w,
+         set, round2_fn, gauss, shift);
+
+    // Apply the autoregressive filter. Each pixel depends on the `ar_lag`
+    // preceding pixels in its row, and the pixels up to `ar_lag` to the right
+    // in the preceding rows. So staggering each row by `ar_lag + 2` pixels
+    // relative to the previous one is enough to allow all rows to make
+    // progress at the same time. (The extra pixel is needed because two
+    // pixels share each element of the buffer)
+    const int ar_pad = 3;
+    const int ar_lag = data->ar_coeff_lag;
+    const int delay = ar_lag + 2;
+    const int8_t *coeff = is_y ? data->ar_coeffs_y
+                               : data->ar_coeffs_uv[channel - PL_CHANNEL_CB];
+
+    GLSL("for (int t = 0; t < %d; t++) {                            \n"
+         "    int x = %d + t - (y - %d) * %d;                       \n"
+         "    if (y >= %d && y < %d && x >= %d && x < %d) {         \n"
+         "        int sum = 0;                                      \n",
+         (h - ar_pad - 1) * delay + w - 2 * ar_pad,
+         ar_pad, ar_pad, delay, ar_pad, h, ar_pad, w - ar_pad);
+
+    for (int dy = -ar_lag; dy <= 0; dy++) {
+        for (int dx = -ar_lag; dx <= ar_lag; dx++) {
+            if (!dx && !dy) {
+                if (is_y || !data->num_points_y)
+                    break;
+                GLSL("int luma = 0;                                 \n"
+                     "int lx = ((x - %d) << %d) + %d;               \n"
+                     "int ly = ((y - %d) << %d) + %d;               \n",
+                     ar_pad, sub_x, ar_pad, ar_pad, sub_y, ar_pad);
+                for (int i = 0; i <= sub_y; i++) {
+                    for (int j = 0; j <= sub_x; j++)
+                        GLSL("luma += %s(lx + %d, ly + %d); \n", get_y, j, i);
+                }
+                GLSL("sum += %s(luma, %d) * %d; \n",
+                     round2_fn, sub_x + sub_y, *coeff);
+                break;
+            }
+
+            int c = *(coeff++);
+            if (c)
+                GLSL("sum += %d * %s(x + %d, y + %d); \n", c, get, dx, dy);
+        }
+    }
+
+    // The explicit sign extension mirrors the implicit int16_t truncation
+    GLSL("        int g = %s(x, y) + %s(sum, %d);                   \n"
+         "        g = (g << 16) >> 16;                              \n"
+         "        %s(x, y, clamp(g, %d, %d));                       \n"
+         "    }                                                     \n"
+         "    memoryBarrierShared();                                \n"
+         "    barrier();                                            \n"
+         "}                                                         \n",
+         get, round2_fn, data->ar_coeff_shift,
+         set, scale.grain_min, scale.grain_max);
+
+    if (!out)
+        return;
+
+    // Write out the part of the grain buffer used by the main shader
+    int lut_w = GRAIN_WIDTH_LUT >> (is_y ? 0 : sub_x);
+    int lut_h = GRAIN_HEIGHT_LUT >> (is_y ? 0 : sub_y);
+    int pad_x = !is_y && sub_x ? SUB_GRAIN_PAD_LUT : GRAIN_PAD_LUT;
+    int pad_y = !is_y && sub_y ? SUB_GRAIN_PAD_LUT : GRAIN_PAD_LUT;
+    ident_t img = sh_desc(sh, (struct pl_shader_desc) {
+        .desc = {
+            .name   = "grain_img",
+            .type   = PL_DESC_STORAGE_IMG,
+            .access = PL_DESC_ACCESS_WRITEONLY,
+        },
+        .object = out,
+    });
+
+    GLSL("if (y >= %d && y < %d) {                                  \n"
+         "    for (int x = 0; x < %d; x++) {                        \n"
+         "        float val = float(%s(x + %d, y)) * %f;            \n"
+         "        imageStore(%s, ivec2(x, y - %d), vec4(val));      \n"
+         "    }                                                     \n"
+         "}                                                         \n",
+         pad_y, pad_y + lut_h, lut_w, get, pad_x, scale.grain_scale,
+         img, pad_y);
+}
+
+// Generates the grain textures on the GPU, using an auxiliary compute pass
+// that writes into `obj->grain_tex`. The grain buffers are kept in shared
+// memory, with one thread per row.
+static bool generate_grain_gpu(struct pl_shader *sh, struct sh_grain_obj *obj,
+                               const struct pl_av1_grain_params *params,
+                               bool has_y, bool has_cb, bool has_cr,
+                               int sub_x, int sub_y)
+{
+    const struct pl_gpu *gpu = SH_GPU(sh);
+    if (!sh->dp || !(gpu->caps & PL_GPU_CAP_COMPUTE))
+        return false;
+
+    enum pl_fmt_caps caps = PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_STORABLE;
+    const struct pl_fmt *fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 32, 0, caps);
+    if (!fmt)
+        fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 16, 0, caps);
+    if (!fmt)
+        return false;
+
+    const bool needed[3] = { has_y, has_cb, has_cr };
+    for (int i = 0; i < 3; i++) {
+        if (!needed[i]) {
+            pl_tex_destroy(gpu, &obj->grain_tex[i]);
+            continue;
+        }
+
+        bool ok = pl_tex_recreate(gpu, &obj->grain_tex[i], &(struct pl_tex_params) {
+            .w          = GRAIN_WIDTH_LUT  >> (i ? sub_x : 0),
+            .h          = GRAIN_HEIGHT_LUT >> (i ? sub_y : 0),
+            .format     = fmt,
+            .sampleable = true,
+            .storable   = true,
+        });
+
+        if (!ok) {
+            PL_ERR(sh, "Failed creating AV1 grain texture!");
+            return false;
+        }
+    }
+
+    int chroma_w = sub_x ? SUB_GRAIN_WIDTH  : GRAIN_WIDTH;
+    int chroma_h = sub_y ? SUB_GRAIN_HEIGHT : GRAIN_HEIGHT;
+    size_t shmem = GRAIN_WIDTH * GRAIN_HEIGHT / 2 * sizeof(uint32_t);
+    if (has_cb || has_cr)
+        shmem += chroma_w * chroma_h / 2 * sizeof(uint32_t);
+
+    struct pl_shader *csh = pl_dispatch_begin(sh->dp);
+    sh_require(csh, PL_SHADER_SIG_NONE, 0, 0);
+    if (!sh_try_compute(csh, GRAIN_HEIGHT, 1, false, shmem))
+        goto error;
+
+    ident_t gauss = sh_lut(csh, &(struct sh_lut_params) {
+        .object = &obj->lut_gauss,
+        .type = PL_VAR_SINT,
+        .width = PL_ARRAY_SIZE(gaussian_sequence),
+        .comps = 1,
+        .fill = fill_gaussian,
+    });
+
+    ident_t jumps = sh_lut(csh, &(struct sh_lut_params) {
+        .object = &obj->lut_jumps,
+        .type = PL_VAR_UINT,
+        .width = 16,
+        .height = GRAIN_HEIGHT,
+        .comps = 2,
+        .update = obj->jumps_w != chroma_w,
+        .fill = generate_jumps,
+        .priv = &chroma_w,
+    });
+
+    if (!gauss || !jumps)
+        goto error;
+    obj->jumps_w = chroma_w;
+
+    ident_t seed = sh_var(csh, (struct pl_shader_var) {
+        .var = pl_var_uint("seed"),
+        .data = &(unsigned int) { params->data.grain_seed },
+        .dynamic = true,
+    });
+
+    ident_t round2_fn = sh_fresh(csh, "round2");
+    GLSLH("int %s(int x, int shift) {                               \n"
+          "    return shift > 0 ? (x + (1 << (shift - 1))) >> shift : x; \n"
+          "}                                                        \n",
+          round2_fn);
+
+    ident_t get_y, set_y, get_uv, set_uv;
+    grain_buf(csh, GRAIN_WIDTH, GRAIN_HEIGHT, &get_y, &set_y);
+    if (has_cb || has_cr)
+        grain_buf(csh, chroma_w, chroma_h, &get_uv, &set_uv);
+
+    sh_describe(csh, "AV1 grain generation");
+    GLSL("int y = int(gl_LocalInvocationIndex); \n");
+
+    // The luma grain is needed even for chroma
+    emit_grain_plane(csh, obj->grain_tex[0], PL_CHANNEL_Y, get_y, set_y,
+                     NULL, sub_x, sub_y, seed, gauss, jumps, round2_fn, params);
+    if (has_cb) {
+        emit_grain_plane(csh, obj->grain_tex[1], PL_CHANNEL_CB, get_uv, set_uv,
+                         get_y, sub_x, sub_y, seed, gauss, jumps, round2_fn,
+                         params);
+    }
+    if (has_cr) {
+        emit_grain_plane(csh, obj->grain_tex[2], PL_CHANNEL_CR, get_uv, set_uv,
+                         get_y, sub_x, sub_y, seed, gauss, jumps, round2_fn,
+                         params);
+    }
+
+    bool ok = pl_dispatch_compute(sh->dp, &(struct pl_dispatch_compute_params) {
+        .shader = &csh,
+        .dispatch_size = {1, 1, 1},
+    });
+
+    if (!ok) {
+        PL_ERR(sh, "Failed dispatching AV1 grain generation shader!");
+        return false;
+    }
+
+    return true;
+
+error:
+    pl_dispatch_abort(sh->dp, &csh);
+    return false;
+}
+
+// Binds a grain texture generated by `generate_grain_gpu`, using the same
+// lookup semantics as the LUTs generated by `sh_lut`
+static ident_t bind_grain_tex(struct pl_shader *sh, const struct pl_tex *tex)
+{
+    ident_t name = sh_fresh(sh, "grain_lut");
+    ident_t desc = sh_desc(sh, (struct pl_shader_desc) {
+        .desc = {
+            .name = "grain_tex",
+            .type = PL_DESC_SAMPLED_TEX,
+        },
+        .object = tex,
+    });
+
+    GLSLH("#define %s(pos) (texelFetch(%s, ivec2(pos), 0).x)\n", name, desc);
+    return name;
+}
+
 bool pl_shader_av1_grain(struct pl_shader *sh,
                          struct pl_shader_obj **grain_state,
                          const struct pl_av1_grain_params *params)
@@ -647,6 +982,8 @@ bool pl_shader_av1_grain(struct pl_shader *sh,
     if (!sh_require(sh, PL_SHADER_SIG_NONE, tex_w, tex_h))
         return false;
 
+    sh_describe(sh, "AV1 grain %dx%d", tex_w, tex_h);
+
     const struct pl_gpu *gpu = SH_GPU(sh);
     if (!gpu) {
         PL_ERR(sh, "pl_shader_av1_grain requires a non-NULL pl_gpu!");
@@ -684,8 +1021,13 @@ bool pl_shader_av1_grain(struct pl_shader *sh,
                         !pl_color_repr_equal(params->repr, &obj->repr);
 
     if (needs_update) {
+        obj->gpu_grain = params->gpu_generate &&
+                         generate_grain_gpu(sh, obj, params, fg_has_y,
+                                            fg_has_u, fg_has_v, sub_x, sub_y);
+
         // This is needed even for chroma, so statically generate it
-        generate_grain_y(obj->grain[0], obj->grain_tmp_y, params);
+        if (!obj->gpu_grain)
+            generate_grain_y(obj->grain[0], obj->grain_tmp_y, params);
 
         obj->data = *data;
         obj->sub_x = sub_x;
@@ -698,8 +1040,16 @@ bool pl_shader_av1_grain(struct pl_shader *sh,
         obj->repr = *params->repr;
     };
 
-    ident_t lut[3];
-    int idx[3] = {-1};
+    ident_t lut[3] = {0};
+    int idx[3] = {-1, -1, -1};
+
+    if (obj->gpu_grain) {
+        for (int i = 0; i < 3; i++) {
+            if (obj->grain_tex[i])
+                lut[i] = bind_grain_tex(sh, obj->grain_tex[i]);
+        }
+        goto grain_done;
+    }
 
     if (fg_has_y) {
         lut[0] = sh_lut(sh, &(struct sh_lut_params) {
@@ -724,15 +1074,19 @@ bool pl_shader_av1_grain(struct pl_shader *sh,
     // Try merging the chroma LUTs into a single texture
     int chroma_comps = 0;
     if (fg_has_u) {
-        generate_grain_uv(&obj->grain[chroma_comps][0][0], obj->grain_tmp_uv,
-                          obj->grain_tmp_y, PL_CHANNEL_CB, sub_x, sub_y,
-                          params);
+        if (needs_update) {
+            generate_grain_uv(&obj->grain[chroma_comps][0][0], obj->grain_tmp_uv,
+                              obj->grain_tmp_y, PL_CHANNEL_CB, sub_x, sub_y,
+                              params);
+        }
         idx[1] = chroma_comps++;
     }
     if (fg_has_v) {
-        generate_grain_uv(&obj->grain[chroma_comps][0][0], obj->grain_tmp_uv,
-                          obj->grain_tmp_y, PL_CHANNEL_CR, sub_x, sub_y,
-                          params);
+        if (needs_update) {
+            generate_grain_uv(&obj->grain[chroma_comps][0][0], obj->grain_tmp_uv,
+                              obj->grain_tmp_y, PL_CHANNEL_CR, sub_x, sub_y,
+                              params);
+        }
         idx[2] = chroma_comps++;
     }
 
@@ -759,6 +1113,7 @@ bool pl_shader_av1_grain(struct pl_shader *sh,
             idx[1] = idx[2] = -1;
     }
 
+grain_done: ;
     ident_t offsets = sh_lut(sh, &(struct sh_lut_params) {
         .object = &obj->lut_offsets,
         .method = SH_LUT_AUTO,
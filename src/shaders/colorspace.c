@@ -24,6 +24,23 @@ void pl_shader_decode_color(struct pl_shader *sh, struct pl_color_repr *repr,
     if (!sh_require(sh, PL_SHADER_SIG_COLOR, 0, 0))
         return;
 
+    sh_describe(sh, "decode color");
+
+    struct {
+        struct pl_color_repr repr;
+        struct pl_color_adjustment params;
+        bool has_params;
+    } key;
+    memset(&key, 0, sizeof(key));
+    key.repr = *repr;
+    key.has_params = !!params;
+    if (params)
+        key.params = *params;
+
+    struct sh_memo memo = { .out = repr, .out_size = sizeof(*repr) };
+    if (sh_memo_begin(sh, &memo, "decode_color", &key, sizeof(key)))
+        return;
+
     GLSL("// pl_shader_decode_color \n"
          "{ \n");
 
@@ -146,6 +163,7 @@ void pl_shader_decode_color(struct pl_shader *sh, struct pl_color_repr *repr,
     }
 
     GLSL("}\n");
+    sh_memo_end(sh, &memo);
 }
 
 void pl_shader_encode_color(struct pl_shader *sh,
@@ -154,6 +172,12 @@ void pl_shader_encode_color(struct pl_shader *sh,
     if (!sh_require(sh, PL_SHADER_SIG_COLOR, 0, 0))
         return;
 
+    sh_describe(sh, "encode color");
+
+    struct sh_memo memo = {0};
+    if (sh_memo_begin(sh, &memo, "encode_color", repr, sizeof(*repr)))
+        return;
+
     GLSL("// pl_shader_encode_color \n"
          "{ \n");
 
@@ -243,6 +267,7 @@ void pl_shader_encode_color(struct pl_shader *sh,
         GLSL("color.rgb /= vec3(max(color.a, 1e-6));\n");
 
     GLSL("}\n");
+    sh_memo_end(sh, &memo);
 }
 
 // Common constants for SMPTE ST.2084 (PQ)
@@ -584,11 +609,21 @@ const struct pl_peak_detect_params pl_peak_detect_default_params = {
     .overshoot_margin       = 0.05,
 };
 
+// Number of log-luminance histogram bins, used for percentile estimation
+#define PEAK_BINS 256
+
 struct sh_peak_obj {
     const struct pl_buf *buf;
     const struct pl_buf *buf_read;
     struct pl_shader_desc desc;
     float margin;
+
+    // Double-buffered asynchronous readback, see `pl_poll_detected_peak`
+    const struct pl_buf *poll_buf[2];
+    bool poll_pending[2];
+    int poll_idx;
+    float poll_result[2];
+    bool poll_valid;
 };
 
 static void sh_peak_uninit(const struct pl_gpu *gpu, void *ptr)
@@ -596,6 +631,8 @@ static void sh_peak_uninit(const struct pl_gpu *gpu, void *ptr)
     struct sh_peak_obj *obj = ptr;
     pl_buf_destroy(gpu, &obj->buf);
     pl_buf_destroy(gpu, &obj->buf_read);
+    for (int i = 0; i < PL_ARRAY_SIZE(obj->poll_buf); i++)
+        pl_buf_destroy(gpu, &obj->poll_buf[i]);
     *obj = (struct sh_peak_obj) {0};
 }
 
@@ -605,31 +642,30 @@ static inline float iir_coeff(float rate)
     return sqrt(a*a + 2*a) - a;
 }
 
-bool pl_shader_detect_peak(struct pl_shader *sh,
-                           struct pl_color_space csp,
-                           struct pl_shader_obj **state,
-                           const struct pl_peak_detect_params *params)
+static struct sh_peak_obj *peak_detect_setup(struct pl_shader *sh,
+                                             struct pl_shader_obj **state,
+                                             const struct pl_peak_detect_params *params)
 {
-    params = PL_DEF(params, &pl_peak_detect_default_params);
-    if (!sh_require(sh, PL_SHADER_SIG_COLOR, 0, 0))
-        return false;
+    size_t shmem = 2 * sizeof(int32_t);
+    if (params->percentile > 0)
+        shmem += PEAK_BINS * sizeof(uint32_t);
 
-    if (!sh_try_compute(sh, 8, 8, true, 2 * sizeof(int32_t))) {
+    if (!sh_try_compute(sh, 8, 8, true, shmem)) {
         PL_ERR(sh, "HDR peak detection requires compute shaders!");
-        return false;
+        return NULL;
     }
 
     if (sh_glsl(sh).version < 130) {
         // uint was added in GLSL 130
         PL_ERR(sh, "HDR peak detection requires GLSL >= 130!");
-        return false;
+        return NULL;
     }
 
     struct sh_peak_obj *obj;
     obj = SH_OBJ(sh, state, PL_SHADER_OBJ_PEAK_DETECT, struct sh_peak_obj,
                  sh_peak_uninit);
     if (!obj)
-        return false;
+        return NULL;
 
     const struct pl_gpu *gpu = SH_GPU(sh);
     obj->margin = params->overshoot_margin;
@@ -650,32 +686,71 @@ bool pl_shader_detect_peak(struct pl_shader *sh,
         ok &= sh_buf_desc_append(obj, gpu, &obj->desc, NULL, pl_var_int("frame_max"));
         ok &= sh_buf_desc_append(obj, gpu, &obj->desc, NULL, pl_var_uint("counter"));
 
+        // The histogram is always allocated, so the layout doesn't depend
+        // on whether `percentile` is in use
+        struct pl_var hist = pl_var_uint("frame_hist");
+        hist.dim_a = PEAK_BINS;
+        ok &= sh_buf_desc_append(obj, gpu, &obj->desc, NULL, hist);
+
         if (!ok) {
             PL_ERR(sh, "HDR peak detection exhausts device limits!");
-            return false;
+            return NULL;
         }
 
         // Create the SSBO
         size_t size = sh_buf_desc_size(&obj->desc);
-        static const uint8_t zero[32] = {0};
-        pl_assert(sizeof(zero) >= size);
+        void *zero = talloc_zero_size(NULL, size);
         obj->buf = pl_buf_create(gpu, &(struct pl_buf_params) {
             .type = PL_BUF_STORAGE,
             .size = size,
             .initial_data = zero,
         });
         obj->desc.object = obj->buf;
+        talloc_free(zero);
     }
 
     if (!obj->buf) {
         SH_FAIL(sh, "Failed creating peak detection SSBO!");
-        return false;
+        return NULL;
     }
 
-    // Attach the SSBO and perform the peak detection logic
+    // Attach the SSBO
     obj->desc.desc.access = PL_DESC_ACCESS_READWRITE;
     obj->desc.memory = PL_MEMORY_COHERENT;
     sh_desc(sh, obj->desc);
+    return obj;
+}
+
+// Chosen to avoid overflowing on an 8K buffer
+static const float log_min = 1e-3, log_scale = 400.0, sig_scale = 10000.0;
+
+struct peak_idents {
+    ident_t wg_sum;
+    ident_t wg_max;
+    ident_t wg_hist; // only if `percentile` is in use
+
+    // If set by the caller, invocations for which this is false are excluded
+    // from the measurement, and `num_samples` is the total number of
+    // invocations for which it's true. If `num_samples` is 0, `valid` must
+    // instead select every `stride`-th invocation (in each direction) of the
+    // dispatch, and the number of samples is derived from its size.
+    ident_t valid;
+    int num_samples;
+    int stride;
+};
+
+// Maps `sig_log` to a histogram bin, covering the range [log_min, sig_max]
+static float hist_scale(void)
+{
+    return PEAK_BINS / (logf(10000 / PL_COLOR_SDR_WHITE) - logf(log_min));
+}
+
+// Measures `color` and accumulates the result into the work group's shared
+// atomics. Must be executed in uniform control flow.
+static void peak_detect_measure(struct pl_shader *sh, struct pl_color_space csp,
+                                const struct pl_peak_detect_params *params,
+                                struct peak_idents *id)
+{
     GLSL("// pl_shader_detect_peak \n"
          "{                        \n"
          "vec4 color_orig = color; \n");
@@ -687,15 +762,23 @@ bool pl_shader_detect_peak(struct pl_shader *sh,
 
     // For performance, we want to do as few atomic operations on global
     // memory as possible, so use an atomic in shmem for the work group.
-    ident_t wg_sum = sh_fresh(sh, "wg_sum"), wg_max = sh_fresh(sh, "wg_max");
+    ident_t wg_sum = id->wg_sum = sh_fresh(sh, "wg_sum");
+    ident_t wg_max = id->wg_max = sh_fresh(sh, "wg_max");
     GLSLH("shared int %s;   \n", wg_sum);
     GLSLH("shared int %s;   \n", wg_max);
-    GLSL("%s = 0; %s = 0;   \n"
-         "barrier();        \n",
-         wg_sum, wg_max);
+    GLSL("%s = 0; %s = 0;   \n", wg_sum, wg_max);
+
+    ident_t wg_hist = id->wg_hist = NULL;
+    if (params->percentile > 0) {
+        wg_hist = id->wg_hist = sh_fresh(sh, "wg_hist");
+        GLSLH("shared uint %s[%d]; \n", wg_hist, PEAK_BINS);
+        GLSL("for (uint i = gl_LocalInvocationIndex; i < %du;               \n"
+             "     i += gl_WorkGroupSize.x * gl_WorkGroupSize.y)            \n"
+             "    %s[i] = 0u;                                               \n",
+             PEAK_BINS, wg_hist);
+    }
 
-    // Chosen to avoid overflowing on an 8K buffer
-    const float log_min = 1e-3, log_scale = 400.0, sig_scale = 10000.0;
+    GLSL("barrier(); \n");
 
     GLSL("float sig_max = max(max(color.r, color.g), color.b);  \n"
          "float sig_log = log(max(sig_max, %f));                \n"
@@ -703,7 +786,25 @@ bool pl_shader_detect_peak(struct pl_shader *sh,
          "int isig_log = int(sig_log * %f);                     \n",
          log_min, sig_scale, log_scale);
 
+    if (id->valid) {
+        // Zero is the neutral element for both the sum and the maximum
+        GLSL("if (!%s) {        \n"
+             "    isig_max = 0; \n"
+             "    isig_log = 0; \n"
+             "}                 \n",
+             id->valid);
+    }
+
+    if (wg_hist) {
+        GLSL("int bin = int((sig_log - %f) * %f);         \n"
+             "if (%s)                                     \n"
+             "    atomicAdd(%s[clamp(bin, 0, %d)], 1u);   \n",
+             logf(log_min), hist_scale(), PL_DEF(id->valid, "true"),
+             wg_hist, PEAK_BINS - 1);
+    }
+
     // Update the work group's shared atomics
+    const struct pl_gpu *gpu = SH_GPU(sh);
     if (gpu->caps & PL_GPU_CAP_SUBGROUPS && false) {
         GLSL("int group_max = subgroupMax(isig_max);    \n"
              "int group_sum = subgroupAdd(isig_log);    \n"
@@ -715,15 +816,40 @@ bool pl_shader_detect_peak(struct pl_shader *sh,
              "barrier();                                \n",
              wg_max, wg_sum);
     } else {
-        GLSL("atomicMax(%s, isig_max);  \n"
-             "atomicAdd(%s, isig_log);  \n"
-             "memoryBarrierShared();    \n"
-             "barrier();                \n",
-             wg_max, wg_sum);
+        GLSL("if (%s) {                     \n"
+             "    atomicMax(%s, isig_max);  \n"
+             "    atomicAdd(%s, isig_log);  \n"
+             "}                             \n"
+             "memoryBarrierShared();        \n"
+             "barrier();                    \n",
+             PL_DEF(id->valid, "true"), wg_max, wg_sum);
     }
 
     GLSL("color = color_orig;   \n"
          "}                     \n");
+}
+
+// Merges the work group results into the global state, and updates the
+// smoothed values once the last work group has finished
+static void peak_detect_update(struct pl_shader *sh,
+                               const struct peak_idents *id,
+                               const struct pl_peak_detect_params *params)
+{
+    // Merge the non-empty histogram bins into the global histogram. This is
+    // spread out over all threads in the work group, and must be visible
+    // before the counter below is incremented.
+    if (id->wg_hist) {
+        GLSLF("// pl_shader_detect_peak                                     \n"
+              "for (uint i = gl_LocalInvocationIndex; i < %du;              \n"
+              "     i += gl_WorkGroupSize.x * gl_WorkGroupSize.y)           \n"
+              "{                                                            \n"
+              "    if (%s[i] > 0u)                                          \n"
+              "        atomicAdd(frame_hist[i], %s[i]);                     \n"
+              "}                                                            \n"
+              "memoryBarrierBuffer();                                       \n"
+              "barrier();                                                   \n",
+              PEAK_BINS, id->wg_hist, id->wg_hist);
+    }
 
     // Have one thread per work group update the global atomics. Do this
     // at the end of the shader to avoid clobbering `average`, in case the
@@ -735,16 +861,56 @@ bool pl_shader_detect_peak(struct pl_shader *sh,
           "    atomicMax(frame_max, %s);                                        \n"
           "    memoryBarrierBuffer();                                           \n"
           "    barrier();                                                       \n",
-          wg_sum, wg_max);
+          id->wg_sum, id->wg_max);
 
     // Finally, to update the global state per dispatch, we increment a counter
     GLSLF("    uint num_wg = gl_NumWorkGroups.x * gl_NumWorkGroups.y;           \n"
-          "    if (atomicAdd(counter, 1u) == num_wg - 1u) {                     \n"
-          "        vec2 cur = vec2(float(frame_sum) / float(num_wg), frame_max);\n"
-          "        cur *= vec2(1.0 / %f, 1.0 / %f);                             \n"
-          "        cur.x = exp(cur.x);                                          \n",
+          "    if (atomicAdd(counter, 1u) == num_wg - 1u) {                     \n");
+
+    // Every work group contributes its sum divided by the full work group
+    // size, so divide the total by the number of full work groups' worth of
+    // samples that were actually measured
+    if (id->num_samples) {
+        GLSLF("        float wg_size = float(gl_WorkGroupSize.x * gl_WorkGroupSize.y); \n"
+              "        float num_full = float(%d) / wg_size;                    \n",
+              id->num_samples);
+    } else if (id->valid) {
+        GLSLF("        uvec2 grid = gl_NumWorkGroups.xy * gl_WorkGroupSize.xy;  \n"
+              "        uvec2 num = (grid + uvec2(%du)) / uvec2(%du);             \n"
+              "        float num_full = float(num.x * num.y) /                  \n"
+              "            float(gl_WorkGroupSize.x * gl_WorkGroupSize.y);      \n",
+              id->stride - 1, id->stride);
+    } else {
+        GLSLF("        float num_full = float(num_wg);                          \n");
+    }
+
+    GLSLF("        vec2 cur = vec2(float(frame_sum) / num_full, frame_max); \n"
+          "        cur *= vec2(1.0 / %f, 1.0 / %f);                         \n"
+          "        cur.x = exp(cur.x);                                      \n",
           log_scale, sig_scale);
 
+    // Replace the maximum by the requested percentile, by walking the
+    // histogram downwards until enough samples have been skipped. The upper
+    // edge of the bin is used, to err on the side of not clipping.
+    if (id->wg_hist) {
+        GLSLF("        uint total = 0u;                                         \n"
+              "        for (int i = 0; i < %d; i++)                             \n"
+              "            total += frame_hist[i];                              \n"
+              "        uint skip = uint(float(total) * %f);                     \n"
+              "        uint above = 0u;                                         \n"
+              "        int bin = %d;                                            \n"
+              "        for (; bin > 0; bin--) {                                 \n"
+              "            above += frame_hist[bin];                            \n"
+              "            if (above > skip)                                    \n"
+              "                break;                                           \n"
+              "        }                                                        \n"
+              "        cur.y = min(cur.y, exp(float(bin + 1) / %f + %f));       \n"
+              "        for (int i = 0; i < %d; i++)                             \n"
+              "            frame_hist[i] = 0u;                                  \n",
+              PEAK_BINS, 1.0 - PL_MIN(params->percentile, 100.0) / 100.0,
+              PEAK_BINS - 1, hist_scale(), logf(log_min), PEAK_BINS);
+    }
+
     // Set the initial value accordingly if it contains no data
     GLSLF("        if (average.y == 0.0) \n"
           "            average = cur;    \n");
@@ -769,7 +935,98 @@ bool pl_shader_detect_peak(struct pl_shader *sh,
           "        memoryBarrierBuffer();    \n"
           "    }                             \n"
           "}                                 \n");
+}
+
+bool pl_shader_detect_peak(struct pl_shader *sh,
+                           struct pl_color_space csp,
+                           struct pl_shader_obj **state,
+                           const struct pl_peak_detect_params *params)
+{
+    params = PL_DEF(params, &pl_peak_detect_default_params);
+    if (!sh_require(sh, PL_SHADER_SIG_COLOR, 0, 0))
+        return false;
+
+    if (!peak_detect_setup(sh, state, params))
+        return false;
+
+    struct peak_idents id = {0};
+    sh_describe(sh, "peak detect");
+
+    // Subsample the invocations in place, rather than the source texture
+    int stride = PL_MAX(params->sample_stride, 1);
+    if (stride > 1) {
+        id.valid = sh_fresh(sh, "peak_valid");
+        id.stride = stride;
+        GLSL("bool %s = all(equal(gl_GlobalInvocationID.xy %% uvec2(%du),    \n"
+             "                    uvec2(0u)));                              \n",
+             id.valid, stride);
+    }
 
+    peak_detect_measure(sh, csp, params, &id);
+    peak_detect_update(sh, &id, params);
+    return true;
+}
+
+bool pl_shader_detect_peak_tex(struct pl_shader *sh, const struct pl_tex *tex,
+                               const struct pl_rect2d *rect,
+                               struct pl_color_space csp,
+                               struct pl_shader_obj **state,
+                               const struct pl_peak_detect_params *params)
+{
+    params = PL_DEF(params, &pl_peak_detect_default_params);
+    struct pl_rect2d rc = { 0, 0, tex->params.w, tex->params.h };
+    if (rect) {
+        rc = *rect;
+        pl_rect2d_normalize(&rc);
+        rc.x0 = PL_MAX(rc.x0, 0);
+        rc.y0 = PL_MAX(rc.y0, 0);
+        rc.x1 = PL_MIN(rc.x1, tex->params.w);
+        rc.y1 = PL_MIN(rc.y1, tex->params.h);
+        if (rc.x1 <= rc.x0 || rc.y1 <= rc.y0) {
+            PL_ERR(sh, "Empty or out-of-bounds peak detection rect!");
+            return false;
+        }
+    }
+
+    int stride = PL_MAX(params->sample_stride, 1);
+    int w = (pl_rect_w(rc) + stride - 1) / stride,
+        h = (pl_rect_h(rc) + stride - 1) / stride;
+
+    if (!sh_require(sh, PL_SHADER_SIG_NONE, w, h))
+        return false;
+
+    // Use a fixed work group size, since the dispatch size is derived
+    // from it by `pl_dispatch_compute`
+    if (!sh_try_compute(sh, 8, 8, false, 0)) {
+        PL_ERR(sh, "HDR peak detection requires compute shaders!");
+        return false;
+    }
+
+    if (!peak_detect_setup(sh, state, params))
+        return false;
+
+    ident_t src = sh_bind(sh, tex, "peak_src", NULL, NULL, NULL, NULL);
+    if (!src)
+        return false;
+
+    // Out-of-bounds invocations (in the last row/column of work groups) can't
+    // return early, since the measurement requires uniform control flow, so
+    // they fetch a clamped texel and are excluded from the results instead
+    struct peak_idents id = {
+        .valid = sh_fresh(sh, "peak_valid"),
+        .num_samples = w * h,
+    };
+
+    sh_describe(sh, "peak detect %dx%d (stride %d)", w, h, stride);
+    GLSL("ivec2 peak_id = ivec2(gl_GlobalInvocationID.xy);             \n"
+         "bool %s = all(lessThan(peak_id, ivec2(%d, %d)));              \n"
+         "ivec2 peak_pos = min(peak_id * %d, ivec2(%d, %d));            \n"
+         "vec4 color = texelFetch(%s, ivec2(%d, %d) + peak_pos, 0);     \n",
+         id.valid, w, h, stride, pl_rect_w(rc) - 1, pl_rect_h(rc) - 1,
+         src, rc.x0, rc.y0);
+
+    peak_detect_measure(sh, csp, params, &id);
+    peak_detect_update(sh, &id, params);
     return true;
 }
 
@@ -814,6 +1071,67 @@ bool pl_get_detected_peak(const struct pl_shader_obj *state,
     return true;
 }
 
+bool pl_poll_detected_peak(const struct pl_shader_obj *state,
+                           float *out_peak, float *out_avg)
+{
+    if (!state || state->type != PL_SHADER_OBJ_PEAK_DETECT)
+        return false;
+
+    struct sh_peak_obj *obj = state->priv;
+    const struct pl_gpu *gpu = state->gpu;
+    const size_t size = sizeof(obj->poll_result);
+    pl_assert(obj->buf->params.size >= size);
+
+    // Retrieve all completed results, oldest first. `poll_idx` always points
+    // at the buffer which was scheduled least recently.
+    for (int n = 0, i = obj->poll_idx; n < 2; n++, i ^= 1) {
+        if (!obj->poll_pending[i] || pl_buf_poll(gpu, obj->poll_buf[i], 0))
+            continue;
+
+        obj->poll_pending[i] = false;
+        if (!pl_buf_read(gpu, obj->poll_buf[i], 0, obj->poll_result, size)) {
+            PL_ERR(gpu, "Failed reading from peak detect readback buffer");
+            obj->poll_valid = false;
+            continue;
+        }
+
+        obj->poll_valid = true;
+    }
+
+    // Schedule a new readback into the next free buffer. If both are still
+    // in flight, the GPU is lagging behind, so just skip this one.
+    int idx = obj->poll_idx;
+    if (!obj->poll_pending[idx]) {
+        bool ok = pl_buf_recreate(gpu, &obj->poll_buf[idx], &(struct pl_buf_params) {
+            .type = PL_BUF_TEX_TRANSFER,
+            .size = size,
+            .host_readable = true,
+            .memory_type = PL_BUF_MEM_HOST,
+        });
+
+        if (!ok) {
+            PL_ERR(gpu, "Failed creating peak detect readback buffer");
+            return false;
+        }
+
+        pl_buf_copy(gpu, obj->poll_buf[idx], 0, obj->buf, 0, size);
+        obj->poll_pending[idx] = true;
+        obj->poll_idx ^= 1;
+    }
+
+    if (!obj->poll_valid)
+        return false;
+
+    *out_avg = obj->poll_result[0];
+    *out_peak = obj->poll_result[1];
+    if (obj->margin > 0.0) {
+        *out_peak *= 1.0 + obj->margin;
+        *out_peak = PL_MIN(*out_peak, 10000 / PL_COLOR_SDR_WHITE);
+    }
+
+    return obj->poll_result[1] > 0.0;
+}
+
 static inline float pq_delinearize(float x)
 {
     x *= PL_COLOR_SDR_WHITE / 10000.0;
@@ -832,11 +1150,230 @@ const struct pl_color_map_params pl_color_map_default_params = {
     .gamut_clipping         = true,
 };
 
+static const char *tone_mapping_names[] = {
+    [PL_TONE_MAPPING_CLIP]      = "clip",
+    [PL_TONE_MAPPING_MOBIUS]    = "mobius",
+    [PL_TONE_MAPPING_REINHARD]  = "reinhard",
+    [PL_TONE_MAPPING_HABLE]     = "hable",
+    [PL_TONE_MAPPING_GAMMA]     = "gamma",
+    [PL_TONE_MAPPING_LINEAR]    = "linear",
+    [PL_TONE_MAPPING_BT_2390]   = "bt2390",
+};
+
+// Inputs to the (static) tone mapping curve, see `pl_shader_tone_map`
+struct tone_map_curve {
+    enum pl_tone_mapping_algorithm algo;
+    float param;
+    float sig_peak;
+    float sig_avg;
+    float dst_range;
+    float dst_avg;
+    float max_boost;
+    bool need_norm;
+};
+
+static inline float pq_linearize(float x)
+{
+    x = powf(x, 1.0 / PQ_M2);
+    x = fmaxf(x - PQ_C1, 0.0) / (PQ_C2 - PQ_C3 * x);
+    x = powf(x, 1.0 / PQ_M1);
+    x *= 10000.0 / PL_COLOR_SDR_WHITE;
+    return x;
+}
+
+static inline float hable_curve(float x)
+{
+    const float A = 0.15, B = 0.50, C = 0.10, D = 0.20, E = 0.02, F = 0.30;
+    return (x * (A*x + C*B) + D*E) / (x * (A*x + B) + D*F) - E/F;
+}
+
+// CPU version of the per-channel tone mapping logic in `pl_shader_tone_map`.
+// This must be kept in sync with the GLSL code.
+static float tone_map_sig(const struct tone_map_curve *c, float sig)
+{
+    float sig_peak = c->sig_peak;
+    if (c->dst_range > 1.0 && c->need_norm) {
+        sig /= c->dst_range;
+        sig_peak /= c->dst_range;
+    }
+
+    float slope = fminf(PL_DEF(c->max_boost, 1.0), c->dst_avg / c->sig_avg);
+    sig *= slope;
+    sig_peak *= slope;
+
+    float param = c->param;
+    switch (c->algo) {
+    case PL_TONE_MAPPING_CLIP:
+        sig *= PL_DEF(param, 1.0);
+        break;
+
+    case PL_TONE_MAPPING_MOBIUS: {
+        if (sig_peak <= 1.0 + 1e-6)
+            break;
+        const float j = PL_DEF(param, 0.3);
+        float a = -j*j * (sig_peak - 1.0) / (j*j - 2.0*j + sig_peak);
+        float b = (j*j - 2.0*j*sig_peak + sig_peak) / fmaxf(1e-6, sig_peak - 1.0);
+        float scale = (b*b + 2.0*b*j + j*j) / (b-a);
+        if (sig > j)
+            sig = scale * (sig + a) / (sig + b);
+        break;
+    }
+
+    case PL_TONE_MAPPING_REINHARD: {
+        float contrast = PL_DEF(param, 0.5),
+              offset = (1.0 - contrast) / contrast;
+        sig = sig / (sig + offset) * (sig_peak + offset) / sig_peak;
+        break;
+    }
+
+    case PL_TONE_MAPPING_HABLE:
+        sig = hable_curve(sig) / hable_curve(sig_peak);
+        break;
+
+    case PL_TONE_MAPPING_GAMMA: {
+        const float cutoff = 0.05, gamma = 1.0 / PL_DEF(param, 1.8);
+        if (sig > cutoff) {
+            sig = powf(sig / sig_peak, gamma);
+        } else {
+            sig *= powf(cutoff / sig_peak, gamma) / cutoff;
+        }
+        break;
+    }
+
+    case PL_TONE_MAPPING_LINEAR:
+        sig *= PL_DEF(param, 1.0) / sig_peak;
+        break;
+
+    case PL_TONE_MAPPING_BT_2390: {
+        float peak_pq = pq_delinearize(sig_peak);
+        float scale = 1.0 / peak_pq;
+        float sig_pq = pq_delinearize(sig) * scale;
+        float maxLum = pq_delinearize(c->dst_range) * scale;
+        float ks = 1.5 * maxLum - 0.5;
+        if (sig_pq >= ks) {
+            float tb = (sig_pq - ks) / (1.0 - ks);
+            float tb2 = tb * tb;
+            float tb3 = tb2 * tb;
+            sig_pq = (2.0 * tb3 - 3.0 * tb2 + 1.0) * ks +
+                     (tb3 - 2.0 * tb2 + tb) * (1.0 - ks) +
+                     (-2.0 * tb3 + 3.0 * tb2) * maxLum;
+        }
+        sig = pq_linearize(sig_pq * peak_pq);
+        break;
+    }
+
+    default: abort();
+    }
+
+    return fminf(sig, 1.01);
+}
+
+struct sh_tone_map_obj {
+    struct pl_shader_obj *lut;
+    struct tone_map_curve curve;
+    float lut_max; // upper bound of the LUT's input range
+};
+
+// Returns the signal level from which on the output of the curve is clipped,
+// which bounds the input range the LUT needs to cover. Since some curves only
+// approach the clipping point asymptotically, this is limited to a few times
+// the peak, past which they're flat enough to be clamped to the last entry.
+static float tone_map_lut_max(const struct tone_map_curve *c)
+{
+    const float max = 4.0 * c->sig_peak;
+    float x = c->sig_peak;
+    while (x < max && tone_map_sig(c, x) < 1.01f)
+        x *= 1.25;
+    return PL_MIN(x, max);
+}
+
+// The LUT is indexed by sqrt(sig / lut_max), to dedicate more precision to
+// the darker parts of the curve
+static void fill_tone_map_lut(void *data, const struct sh_lut_params *params)
+{
+    const struct sh_tone_map_obj *obj = params->priv;
+    float *out = data;
+    for (int i = 0; i < params->width; i++) {
+        float x = (float) i / (params->width - 1);
+        out[i] = tone_map_sig(&obj->curve, x * x * obj->lut_max);
+    }
+}
+
+static void sh_tone_map_uninit(const struct pl_gpu *gpu, void *ptr)
+{
+    struct sh_tone_map_obj *obj = ptr;
+    pl_shader_obj_destroy(&obj->lut);
+    *obj = (struct sh_tone_map_obj) {0};
+}
+
+// Returns the tone mapping LUT, or NULL if it can't be used. `out_scale` is
+// set to the factor mapping the signal to the (squared) LUT position.
+static ident_t tone_map_lut(struct pl_shader *sh, struct tone_map_curve curve,
+                            struct pl_shader_obj **tone_map_state,
+                            const struct pl_color_map_params *params,
+                            ident_t *out_scale)
+{
+    const struct pl_gpu *gpu = SH_GPU(sh);
+    if (!tone_map_state || params->tone_mapping_lut_size < 2 || !gpu)
+        return NULL;
+
+    // Avoid failing the shader in `sh_lut` if linear LUTs are unsupported
+    const struct pl_fmt *fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 16, 32,
+                                           PL_FMT_CAP_SAMPLEABLE |
+                                           PL_FMT_CAP_LINEAR);
+    if (!fmt)
+        return NULL;
+
+    struct sh_tone_map_obj *obj;
+    obj = SH_OBJ(sh, tone_map_state, PL_SHADER_OBJ_TONE_MAP,
+                 struct sh_tone_map_obj, sh_tone_map_uninit);
+    if (!obj)
+        return NULL;
+
+    bool update = memcmp(&curve, &obj->curve, sizeof(curve)) != 0;
+    if (update) {
+        obj->curve = curve;
+        obj->lut_max = tone_map_lut_max(&curve);
+    }
+
+    ident_t lut = sh_lut(sh, &(struct sh_lut_params) {
+        .object = &obj->lut,
+        .method = SH_LUT_LINEAR,
+        .type = PL_VAR_FLOAT,
+        .width = params->tone_mapping_lut_size,
+        .comps = 1,
+        .update = update,
+        .fill = fill_tone_map_lut,
+        .priv = obj,
+    });
+
+    if (!lut)
+        return NULL;
+
+    // This changes along with the detected peak, so avoid recompiling
+    *out_scale = sh_var(sh, (struct pl_shader_var) {
+        .var = pl_var_float("lut_scale"),
+        .data = &(float) { 1.0 / obj->lut_max },
+        .dynamic = true,
+    });
+
+    return lut;
+}
+
+// Rounds the detected values to steps of about 1%, to avoid regenerating the
+// tone mapping LUT every time the smoothed values change slightly
+static inline float tone_map_quantize(float x)
+{
+    return expf(roundf(logf(x) * 100.0) / 100.0);
+}
+
 static void pl_shader_tone_map(struct pl_shader *sh, struct pl_color_space src,
                                struct pl_color_space dst,
                                struct pl_shader_obj **peak_detect_state,
+                               struct pl_shader_obj **tone_map_state,
                                const struct pl_color_map_params *params)
 {
+    sh_describe(sh, "tone map %s", tone_mapping_names[params->tone_mapping_algo]);
     GLSL("// pl_shader_tone_map \n"
          "{                     \n");
 
@@ -853,11 +1390,15 @@ static void pl_shader_tone_map(struct pl_shader *sh, struct pl_color_space src,
          src.sig_avg * src.sig_scale);
 
     // Update the variables based on values from the peak detection buffer
+    bool dynamic_peak = false, lut_peak_known = false;
+    float lut_peak = src.sig_peak * src.sig_scale,
+          lut_avg = src.sig_avg * src.sig_scale;
     if (peak_detect_state) {
         struct sh_peak_obj *obj;
         obj = SH_OBJ(sh, peak_detect_state, PL_SHADER_OBJ_PEAK_DETECT,
                      struct sh_peak_obj, sh_peak_uninit);
         if (obj && obj->buf) {
+            dynamic_peak = true;
             obj->desc.desc.access = PL_DESC_ACCESS_READONLY;
             obj->desc.memory = 0;
             sh_desc(sh, obj->desc);
@@ -871,6 +1412,18 @@ static void pl_shader_tone_map(struct pl_shader *sh, struct pl_color_space src,
                      1.0 + obj->margin,
                      10000 / PL_COLOR_SDR_WHITE);
             }
+
+            // The LUT has to be generated on the CPU, so it's keyed on the
+            // most recent detected values that were read back (asynchronously)
+            float peak, avg;
+            if (tone_map_state && params->tone_mapping_lut_size >= 2 &&
+                pl_poll_detected_peak(*peak_detect_state, &peak, &avg) &&
+                avg > 0.0)
+            {
+                lut_peak = tone_map_quantize(peak);
+                lut_avg = tone_map_quantize(avg);
+                lut_peak_known = true;
+            }
         }
     }
 
@@ -880,6 +1433,36 @@ static void pl_shader_tone_map(struct pl_shader *sh, struct pl_color_space src,
     // [0.0, 1.0].
     bool need_norm = params->tone_mapping_algo != PL_TONE_MAPPING_BT_2390;
     float dst_range = dst.sig_peak * dst.sig_scale;
+
+    // The curve only depends on the peak and average, so it can be baked
+    // into a LUT whenever these are known on the CPU. With peak detection,
+    // this uses the detected values instead of the ones computed on the GPU.
+    ident_t lut = NULL, lut_scale = NULL;
+    if (!dynamic_peak || lut_peak_known) {
+        struct tone_map_curve curve;
+        memset(&curve, 0, sizeof(curve)); // for memcmp
+        curve.algo = params->tone_mapping_algo;
+        curve.param = params->tone_mapping_param;
+        curve.sig_peak = lut_peak;
+        curve.sig_avg = lut_avg;
+        curve.dst_range = dst_range;
+        curve.dst_avg = dst.sig_avg * dst.sig_scale;
+        curve.max_boost = params->max_boost;
+        curve.need_norm = need_norm;
+        lut = tone_map_lut(sh, curve, tone_map_state, params, &lut_scale);
+    }
+
+    if (lut) {
+        // Signal values past the end of the LUT are clipped by the curve
+        // anyway, so there's no need to clamp them
+        GLSL("vec3 sig = color.rgb;                                     \n"
+             "vec3 sig_orig = sig;                                      \n"
+             "vec3 lut_pos = sqrt(max(sig * vec3(%s), 0.0));            \n"
+             "sig = vec3(%s(lut_pos.r), %s(lut_pos.g), %s(lut_pos.b));  \n",
+             lut_scale, lut, lut, lut);
+        goto lut_done;
+    }
+
     if (dst_range > 1.0 && need_norm) {
         GLSL("color.rgb *= 1.0 / %f; \n"
              "sig_peak *= 1.0 / %f;  \n",
@@ -997,6 +1580,7 @@ static void pl_shader_tone_map(struct pl_shader *sh, struct pl_color_space src,
         abort();
     }
 
+lut_done:
     GLSL("sig = min(sig, 1.01);                                         \n"
          "vec3 sig_lin = sig_orig * (sig[sig_idx] / sig_orig[sig_idx]); \n");
 
@@ -1026,13 +1610,46 @@ void pl_shader_color_map(struct pl_shader *sh,
                          struct pl_color_space src, struct pl_color_space dst,
                          struct pl_shader_obj **peak_detect_state,
                          bool prelinearized)
+{
+    pl_shader_color_map_ex(sh, params, src, dst, peak_detect_state, NULL,
+                           prelinearized);
+}
+
+void pl_shader_color_map_ex(struct pl_shader *sh,
+                            const struct pl_color_map_params *params,
+                            struct pl_color_space src, struct pl_color_space dst,
+                            struct pl_shader_obj **peak_detect_state,
+                            struct pl_shader_obj **tone_map_state,
+                            bool prelinearized)
 {
     if (!sh_require(sh, PL_SHADER_SIG_COLOR, 0, 0))
         return;
 
+    params = PL_DEF(params, &pl_color_map_default_params);
+
+    struct {
+        struct pl_color_map_params params;
+        struct pl_color_space src, dst;
+        bool peak_detect, tone_map, prelinearized;
+    } key;
+    memset(&key, 0, sizeof(key));
+    key.params = *params;
+    key.src = src;
+    key.dst = dst;
+    key.peak_detect = !!peak_detect_state;
+    key.tone_map = !!tone_map_state;
+    key.prelinearized = prelinearized;
+
+    // Note: Tone mapping with a peak detection or tone mapping state object
+    // depends on the state of these objects, so such calls are never replayed
+    // (which includes HDR content in `pl_render_image` with the default
+    // params). Only color mapping without tone mapping benefits from this.
+    struct sh_memo memo = {0};
+    if (sh_memo_begin(sh, &memo, "color_map", &key, sizeof(key)))
+        return;
+
     GLSL("// pl_shader_color_map\n");
     GLSL("{\n");
-    params = PL_DEF(params, &pl_color_map_default_params);
 
     // Default the source color space to reasonable values
     pl_color_space_infer(&src);
@@ -1090,7 +1707,8 @@ void pl_shader_color_map(struct pl_shader *sh,
 
     // Tone map to rescale the signal average/peak if needed
     if (src.sig_peak * src.sig_scale > dst.sig_peak * dst.sig_scale + 1e-6) {
-        pl_shader_tone_map(sh, src, dst, peak_detect_state, params);
+        pl_shader_tone_map(sh, src, dst, peak_detect_state, tone_map_state,
+                           params);
         need_gamut_warn = true;
     }
 
@@ -1141,6 +1759,7 @@ void pl_shader_color_map(struct pl_shader *sh,
         pl_shader_delinearize(sh, dst.transfer);
 
     GLSL("}\n");
+    sh_memo_end(sh, &memo);
 }
 
 void pl_shader_cone_distort(struct pl_shader *sh, struct pl_color_space csp,
@@ -1152,6 +1771,7 @@ void pl_shader_cone_distort(struct pl_shader *sh, struct pl_color_space csp,
     if (!sh_require(sh, PL_SHADER_SIG_COLOR, 0, 0))
         return;
 
+    sh_describe(sh, "cone distort");
     GLSL("// pl_shader_cone_distort\n");
     GLSL("{\n");
 
@@ -1226,11 +1846,26 @@ void pl_shader_dither(struct pl_shader *sh, int new_depth,
         return;
     }
 
+    params = PL_DEF(params, &pl_dither_default_params);
+
+    struct {
+        struct pl_dither_params params;
+        int new_depth;
+        bool dither_state;
+    } key;
+    memset(&key, 0, sizeof(key));
+    key.params = *params;
+    key.new_depth = new_depth;
+    key.dither_state = !!dither_state;
+
+    struct sh_memo memo = {0};
+    if (sh_memo_begin(sh, &memo, "dither", &key, sizeof(key)))
+        return;
+
     GLSL("// pl_shader_dither \n"
         "{                    \n"
         "float bias;          \n");
 
-    params = PL_DEF(params, &pl_dither_default_params);
     if (params->lut_size < 0 || params->lut_size > 8) {
         SH_FAIL(sh, "Invalid `lut_size` specified: %d", params->lut_size);
         return;
@@ -1271,6 +1906,7 @@ void pl_shader_dither(struct pl_shader *sh, int new_depth,
             .height = lut_size,
             .comps = 1,
             .update = changed,
+            .signature = ((uint64_t) PL_SHADER_OBJ_DITHER << 48) | method,
             .fill = fill_dither_matrix,
             .priv = obj,
         });
@@ -1286,6 +1922,15 @@ fallback:
 
 done: ;
 
+    static const char *dither_names[] = {
+        [PL_DITHER_BLUE_NOISE]      = "blue noise",
+        [PL_DITHER_ORDERED_LUT]     = "ordered LUT",
+        [PL_DITHER_ORDERED_FIXED]   = "ordered fixed",
+        [PL_DITHER_WHITE_NOISE]     = "white noise",
+    };
+
+    sh_describe(sh, "dither %s", dither_names[method]);
+
     int size = 0;
     if (lut) {
         size = lut_size;
@@ -1350,6 +1995,7 @@ done: ;
          "color = floor(color) * vec4(%f);       \n"
          "}                                      \n",
          (float) scale, 1.0 / scale);
+    sh_memo_end(sh, &memo);
 }
 
 const struct pl_dither_params pl_dither_default_params = {
@@ -1358,6 +2004,165 @@ const struct pl_dither_params pl_dither_default_params = {
     .temporal   = false, // commonly flickers on LCDs
 };
 
+const struct pl_error_diffusion_kernel pl_error_diffusion_floyd_steinberg = {
+    .name        = "floyd-steinberg",
+    .right       = 7,
+    .below_left  = 3,
+    .below       = 5,
+    .below_right = 1,
+    .divisor     = 16,
+};
+
+const struct pl_error_diffusion_kernel pl_error_diffusion_sierra_lite = {
+    .name        = "sierra-lite",
+    .right       = 2,
+    .below_left  = 1,
+    .below       = 1,
+    .below_right = 0,
+    .divisor     = 4,
+};
+
+bool pl_shader_error_diffusion(struct pl_shader *sh,
+                               const struct pl_error_diffusion_params *params)
+{
+    const struct pl_tex *in = params->input_tex, *out = params->output_tex;
+    const struct pl_error_diffusion_kernel *k =
+        PL_DEF(params->kernel, &pl_error_diffusion_floyd_steinberg);
+
+    if (!sh_require(sh, PL_SHADER_SIG_NONE, 0, 0))
+        return false;
+
+    pl_assert(in && out && out->params.storable);
+    pl_assert(params->new_depth > 0 && params->new_depth <= 16);
+    pl_assert(out->params.w >= in->params.w && out->params.h >= in->params.h);
+
+    // packSnorm4x8 is available in all GLES versions supporting compute
+    // shaders (3.10), but only from GLSL 400 onwards on desktop
+    const struct pl_gpu *gpu = SH_GPU(sh);
+    struct pl_glsl_desc glsl = sh_glsl(sh);
+    if (!gpu || glsl.version < (glsl.gles ? 310 : 400)) {
+        PL_TRACE(sh, "Error diffusion requires GLSL 400+ or ESSL 310+ for "
+                 "packSnorm4x8");
+        return false;
+    }
+
+    // Row `y` is processed starting at time step `y * delay`, one pixel per
+    // step, by thread `y % threads`. The delay is large enough for each
+    // thread to finish its current row before starting the next one, and
+    // to ensure the row above has finished all pixels this row depends on.
+    //
+    // The errors diffused into each row are stored in a per-row ring buffer
+    // in shared memory. Since the previous row is exactly `delay` pixels
+    // ahead, the ring buffer only needs to cover `delay + 2` columns, and
+    // there can be at most `threads + 1` rows with pending errors.
+    const int w = in->params.w, h = in->params.h;
+    int threads = PL_MIN(h, PL_MIN(gpu->limits.max_group_threads, 256));
+    int delay, ring, rows;
+    for (;;) {
+        delay = PL_MAX(2, (w + threads - 1) / threads);
+        ring = delay + 2;
+        rows = threads + 1;
+        if (rows * ring * sizeof(uint32_t) <= gpu->limits.max_shmem_size)
+            break;
+        if (threads == 1) {
+            PL_TRACE(sh, "Insufficient shmem for error diffusion");
+            return false;
+        }
+        threads = (threads + 1) / 2;
+    }
+
+    size_t shmem = rows * ring * sizeof(uint32_t);
+    if (!sh_try_compute(sh, threads, 1, false, shmem))
+        return false;
+
+    ident_t src = sh_desc(sh, (struct pl_shader_desc) {
+        .desc = {
+            .name = "src_tex",
+            .type = PL_DESC_SAMPLED_TEX,
+        },
+        .object = in,
+    });
+
+    ident_t dst = sh_desc(sh, (struct pl_shader_desc) {
+        .desc = {
+            .name   = "dst_img",
+            .type   = PL_DESC_STORAGE_IMG,
+            .access = PL_DESC_ACCESS_WRITEONLY,
+        },
+        .object = out,
+    });
+
+    // The errors are stored in units of the target quantization step, which
+    // keeps them in the range [-1, 1] needed for snorm packing
+    ident_t err = sh_fresh(sh, "err");
+    ident_t add = sh_fresh(sh, "add_err");
+    GLSLH("shared uint %s[%d];                                  \n"
+          "#define %s(idx, val) (%s[idx] = packSnorm4x8(vec4(\\\n"
+          "    unpackSnorm4x8(%s[idx]).xyz + (val), 0.0)))      \n",
+          err, rows * ring, add, err, err);
+
+    float scale = (1LLU << params->new_depth) - 1;
+    float div = k->divisor;
+    sh_describe(sh, "error diffusion");
+    GLSL("// pl_shader_error_diffusion (%s)                      \n"
+         "{                                                      \n"
+         "int j = int(gl_LocalInvocationIndex);                  \n"
+         "for (int i = j; i < %d; i += %d)                       \n"
+         "    %s[i] = 0u;                                        \n"
+         "memoryBarrierShared();                                 \n"
+         "barrier();                                             \n"
+         "vec3 carry = vec3(0.0);                                \n"
+         "for (int t = 0; t < %d; t++) {                         \n"
+         "    int g = t - %d * j;                                \n"
+         "    int y = j + %d * (max(g, 0) / %d);                 \n"
+         "    int x = max(g, 0) %% %d;                           \n"
+         "    if (g >= 0 && x < %d && y < %d) {                  \n"
+         "        int idx = (y %% %d) * %d + x %% %d;            \n"
+         "        vec3 e = unpackSnorm4x8(%s[idx]).xyz;          \n"
+         "        %s[idx] = 0u;                                  \n"
+         "        if (x == 0)                                    \n"
+         "            carry = vec3(0.0);                         \n"
+         "        vec4 color = texelFetch(%s, ivec2(x, y), 0);   \n"
+         "        vec3 v = clamp(color.rgb, 0.0, 1.0) * vec3(%f);\n"
+         "        v += e + carry;                                \n"
+         "        vec3 q = clamp(floor(v + vec3(0.5)), 0.0, %f); \n"
+         "        e = v - q;                                     \n"
+         "        imageStore(%s, ivec2(x, y),                    \n"
+         "                   vec4(q * vec3(%f), color.a));       \n"
+         "        carry = e * vec3(%f);                          \n",
+         k->name, rows * ring, threads, err,
+         delay * (h - 1) + w, delay, threads, delay * threads,
+         delay * threads, w, h, rows, ring, ring, err, err,
+         src, scale, scale, dst, 1.0 / scale, k->right / div);
+
+    GLSL("        if (y + 1 < %d) {                    \n"
+         "            int base = ((y + 1) %% %d) * %d; \n",
+         h, rows, ring);
+    if (k->below_left) {
+        GLSL("            if (x > 0)                                  \n"
+             "                %s(base + (x - 1) %% %d, e * vec3(%f)); \n",
+             add, ring, k->below_left / div);
+    }
+    if (k->below) {
+        GLSL("            %s(base + x %% %d, e * vec3(%f)); \n",
+             add, ring, k->below / div);
+    }
+    if (k->below_right) {
+        GLSL("            if (x + 1 < %d)                             \n"
+             "                %s(base + (x + 1) %% %d, e * vec3(%f)); \n",
+             w, add, ring, k->below_right / div);
+    }
+
+    GLSL("        }                  \n"
+         "    }                      \n"
+         "    memoryBarrierShared(); \n"
+         "    barrier();             \n"
+         "}                          \n"
+         "}                          \n");
+
+    return true;
+}
+
 #ifdef PL_HAVE_LCMS
 
 #include "lcms.h"
@@ -1371,12 +2176,20 @@ struct sh_3dlut_obj {
     bool updated; // to detect misuse of the API
     bool ok;
     ident_t lut;
+
+    // for LUTs generated on the GPU
+    const struct pl_tex *tex;
+    struct pl_shader_obj *curve_obj[4];
+    bool gpu_lut;
 };
 
 static void sh_3dlut_uninit(const struct pl_gpu *gpu, void *ptr)
 {
     struct sh_3dlut_obj *obj = ptr;
     pl_shader_obj_destroy(&obj->lut_obj);
+    for (int i = 0; i < PL_ARRAY_SIZE(obj->curve_obj); i++)
+        pl_shader_obj_destroy(&obj->curve_obj[i]);
+    pl_tex_destroy(gpu, &obj->tex);
     *obj = (struct sh_3dlut_obj) {0};
 }
 
@@ -1393,6 +2206,137 @@ static void fill_3dlut(void *data, const struct sh_lut_params *params)
         pl_err(ctx, "Failed computing 3DLUT!");
 }
 
+static void fill_curve(void *data, const struct sh_lut_params *params)
+{
+    memcpy(data, params->priv, params->width * params->comps * sizeof(float));
+}
+
+#define LUT3D_CURVE_SIZE 1024
+
+// For matrix/TRC profiles, the 3DLUT can be computed by a compute shader
+// instead of transforming every single grid point with LittleCMS.
+static bool fill_3dlut_gpu(struct pl_shader *sh, struct sh_3dlut_obj *obj,
+                           int s_r, int s_g, int s_b)
+{
+    const struct pl_gpu *gpu = SH_GPU(sh);
+    if (!sh->dp || !gpu || !(gpu->caps & PL_GPU_CAP_COMPUTE))
+        return false;
+
+    const struct pl_fmt *fmt;
+    fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 16, 32, PL_FMT_CAP_SAMPLEABLE |
+                      PL_FMT_CAP_LINEAR | PL_FMT_CAP_STORABLE);
+    if (!fmt || PL_MAX(PL_MAX(s_r, s_g), s_b) > gpu->limits.max_tex_3d_dim)
+        return false;
+
+    void *tmp = talloc_new(NULL);
+    struct pl_shader *csh = NULL;
+    bool ok = false;
+
+    struct pl_lcms_shaper shaper;
+    if (!pl_lcms_compute_shaper(obj->ctx, tmp, obj->intent, obj->src, obj->dst,
+                                s_r, s_g, s_b, LUT3D_CURVE_SIZE, &shaper,
+                                &obj->result))
+    {
+        goto done;
+    }
+
+    ok = pl_tex_recreate(gpu, &obj->tex, &(struct pl_tex_params) {
+        .w              = s_r,
+        .h              = s_g,
+        .d              = s_b,
+        .format         = fmt,
+        .sampleable     = true,
+        .storable       = true,
+        .sample_mode    = PL_TEX_SAMPLE_LINEAR,
+        .address_mode   = PL_TEX_ADDRESS_CLAMP,
+    });
+
+    if (!ok) {
+        PL_ERR(sh, "Failed creating 3DLUT texture!");
+        goto done;
+    }
+
+    ok = false;
+    csh = pl_dispatch_begin(sh->dp);
+    sh_require(csh, PL_SHADER_SIG_NONE, 0, 0);
+    if (!sh_try_compute(csh, 8, 8, false, 0))
+        goto done;
+
+    const int sizes[3] = { s_r, s_g, s_b };
+    ident_t curves[4];
+    for (int c = 0; c < 3; c++) {
+        curves[c] = sh_lut(csh, &(struct sh_lut_params) {
+            .object = &obj->curve_obj[c],
+            .type = PL_VAR_FLOAT,
+            .width = sizes[c],
+            .comps = 1,
+            .update = true,
+            .fill = fill_curve,
+            .priv = shaper.src_curve[c],
+        });
+    }
+
+    curves[3] = sh_lut(csh, &(struct sh_lut_params) {
+        .object = &obj->curve_obj[3],
+        .method = SH_LUT_LINEAR,
+        .type = PL_VAR_FLOAT,
+        .width = LUT3D_CURVE_SIZE,
+        .comps = 3,
+        .update = true,
+        .fill = fill_curve,
+        .priv = shaper.dst_curve,
+    });
+
+    if (!curves[0] || !curves[1] || !curves[2] || !curves[3])
+        goto done;
+
+    ident_t lut = sh_desc(csh, (struct pl_shader_desc) {
+        .desc = {
+            .name   = "lut3d",
+            .type   = PL_DESC_STORAGE_IMG,
+            .access = PL_DESC_ACCESS_WRITEONLY,
+        },
+        .object = obj->tex,
+    });
+
+    ident_t mat = sh_var(csh, (struct pl_shader_var) {
+        .var  = pl_var_mat3("cms_matrix"),
+        .data = PL_TRANSPOSE_3X3(shaper.matrix.m),
+    });
+
+    sh_describe(csh, "3DLUT %dx%dx%d", s_r, s_g, s_b);
+    GLSL("ivec3 lut_pos = ivec3(gl_GlobalInvocationID); \n"
+         "if (all(lessThan(lut_pos, ivec3(%d, %d, %d)))) { \n"
+         "vec3 color = vec3(%s(lut_pos.x),                \n"
+         "                  %s(lut_pos.y),                \n"
+         "                  %s(lut_pos.z));               \n"
+         "color = sqrt(clamp(%s * color, 0.0, 1.0));      \n"
+         "color = vec3(%s(color.r).r,                     \n"
+         "             %s(color.g).g,                     \n"
+         "             %s(color.b).b);                    \n"
+         "imageStore(%s, lut_pos, vec4(color, 1.0));      \n"
+         "}                                               \n",
+         s_r, s_g, s_b, curves[0], curves[1], curves[2], mat,
+         curves[3], curves[3], curves[3], lut);
+
+    ok = pl_dispatch_compute(sh->dp, &(struct pl_dispatch_compute_params) {
+        .shader = &csh,
+        .dispatch_size = { (s_r + 7) / 8, (s_g + 7) / 8, s_b },
+    });
+
+    if (!ok)
+        PL_ERR(sh, "Failed generating 3DLUT on the GPU!");
+
+    // fall through
+done:
+    if (csh)
+        pl_dispatch_abort(sh->dp, &csh);
+    if (!ok)
+        pl_tex_destroy(gpu, &obj->tex);
+    talloc_free(tmp);
+    return ok;
+}
+
 static bool color_profile_eq(const struct pl_3dlut_profile *a,
                              const struct pl_3dlut_profile *b)
 {
@@ -1426,6 +2370,34 @@ bool pl_3dlut_update(struct pl_shader *sh,
     obj->intent = params->intent;
     obj->src = *src;
     obj->dst = *dst;
+
+    if (changed) {
+        obj->gpu_lut = fill_3dlut_gpu(sh, obj, s_r, s_g, s_b);
+        if (obj->gpu_lut) {
+            PL_DEBUG(sh, "Generated 3DLUT from matrix/TRC profiles on the GPU");
+            pl_shader_obj_destroy(&obj->lut_obj);
+            obj->ok = true;
+        }
+    }
+
+    if (obj->gpu_lut) {
+        ident_t tex = sh_desc(sh, (struct pl_shader_desc) {
+            .desc = {
+                .name = "lut3d",
+                .type = PL_DESC_SAMPLED_TEX,
+            },
+            .object = obj->tex,
+        });
+
+        obj->lut = sh_fresh(sh, "lut");
+        GLSLH("#define %s(pos) (%s(%s, mix(vec3(%f, %f, %f),   \\\n"
+              "                             vec3(%f, %f, %f), (pos))))\n",
+              obj->lut, sh_tex_fn(sh, obj->tex->params), tex,
+              0.5 / s_r, 0.5 / s_g, 0.5 / s_b,
+              1.0 - 0.5 / s_r, 1.0 - 0.5 / s_g, 1.0 - 0.5 / s_b);
+        goto done;
+    }
+
     obj->lut = sh_lut(sh, &(struct sh_lut_params) {
         .object = &obj->lut_obj,
         .method = SH_LUT_LINEAR,
@@ -1438,6 +2410,8 @@ bool pl_3dlut_update(struct pl_shader *sh,
         .fill = fill_3dlut,
         .priv = obj,
     });
+
+done:
     if (!obj->lut || !obj->ok)
         return false;
 
@@ -1459,6 +2433,7 @@ void pl_3dlut_apply(struct pl_shader *sh, struct pl_shader_obj **lut3d)
         return;
     }
 
+    sh_describe(sh, "3DLUT");
     GLSL("// pl_shader_3dlut\n");
     GLSL("color.rgba = %s(color.rgb);\n", obj->lut);
 
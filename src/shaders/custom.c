@@ -874,6 +874,7 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
 
         // Generate a new shader object
         sh = pl_dispatch_begin(params->dispatch);
+        sh_describe(sh, "user shader %.*s", BSTR_P(hook->pass_desc));
         if (!sh_require(sh, PL_SHADER_SIG_NONE, out_w, out_h))
             goto error;
 
@@ -16,6 +16,7 @@
  */
 
 #include <math.h>
+#include "filters.h"
 #include "shaders.h"
 
 const struct pl_deband_params pl_deband_default_params = {
@@ -37,11 +38,31 @@ static inline struct pl_tex_params src_params(const struct pl_sample_src *src)
     };
 }
 
+// Helper function to set up the memoization key for a given source. This
+// includes the texture params, since the same pointer may be reused for a
+// different texture after it's destroyed.
+struct sample_key {
+    struct pl_sample_src src;
+    struct pl_tex_params params;
+};
+
+static void sample_key(struct sample_key *key, const struct pl_sample_src *src)
+{
+    memset(key, 0, sizeof(*key));
+    key->src = *src;
+    if (src->tex) {
+        key->params = src->tex->params;
+        key->params.initial_data = NULL;
+        key->params.user_data = NULL;
+    }
+}
+
 // Helper function to compute the src/dst sizes and upscaling ratios
 static bool setup_src(struct pl_shader *sh, const struct pl_sample_src *src,
                       ident_t *src_tex, ident_t *pos, ident_t *size, ident_t *pt,
                       float *ratio_x, float *ratio_y, int *components,
-                      float *scale, bool resizeable, const char **fn)
+                      float *scale, bool resizeable, const char **fn,
+                      const char *name)
 {
     enum pl_shader_sig sig;
     float src_w, src_h;
@@ -64,6 +85,8 @@ static bool setup_src(struct pl_shader *sh, const struct pl_sample_src *src,
     int out_w = PL_DEF(src->new_w, roundf(fabs(src_w)));
     int out_h = PL_DEF(src->new_h, roundf(fabs(src_h)));
     pl_assert(out_w && out_h);
+    sh_describe(sh, "%s %.0fx%.0f -> %dx%d", name, fabs(src_w), fabs(src_h),
+                out_w, out_h);
 
     if (ratio_x)
         *ratio_x = out_w / fabs(src_w);
@@ -137,6 +160,63 @@ static bool setup_src(struct pl_shader *sh, const struct pl_sample_src *src,
     return true;
 }
 
+// Whether to fill shmem using texture gathering. Gathering loads four texels
+// of a single component per instruction, so this is only a win for sources
+// with fewer than four components. Requires the shmem dimensions to be
+// rounded up to multiples of two.
+static bool shmem_use_gather(struct pl_shader *sh, int comps)
+{
+    const struct pl_gpu *gpu = SH_GPU(sh);
+    return sh_glsl(sh).version >= 400 && gpu->limits.max_gather_offset != 0 &&
+           comps < 4;
+}
+
+// Declares the shmem arrays `in`X[iw * ih] for each component X and loads the
+// source texels into them, starting `offx`/`offy` texels to the top left of
+// `wbase`, which must be defined by the caller. Includes the barrier.
+static void shmem_fill(struct pl_shader *sh, const char *fn, ident_t src_tex,
+                       ident_t in, int iw, int ih, int bw, int bh,
+                       int offx, int offy, int comps, bool gather)
+{
+    for (int c = 0; c < comps; c++)
+        GLSLH("shared float %s%d[%d]; \n", in, c, iw * ih);
+
+    if (gather) {
+        pl_assert(iw % 2 == 0 && ih % 2 == 0);
+        GLSL("for (int y = 2 * int(gl_LocalInvocationID.y); y < %d; y += %d) {    \n"
+             "for (int x = 2 * int(gl_LocalInvocationID.x); x < %d; x += %d) {    \n"
+             "vec2 gpos = wbase + pt * (vec2(x, y) - vec2(%f, %f));              \n",
+             ih, 2 * bh, iw, 2 * bw, offx - 0.5, offy - 0.5);
+
+        // Sample at the corner shared by the four texels; these are gathered
+        // counterclockwise starting from the bottom left
+        for (int c = 0; c < comps; c++) {
+            GLSL("c = textureGather(%s, gpos, %d);   \n"
+                 "%s%d[%d * y + x] = c.w;            \n"
+                 "%s%d[%d * y + x + 1] = c.z;        \n"
+                 "%s%d[%d * (y + 1) + x] = c.x;      \n"
+                 "%s%d[%d * (y + 1) + x + 1] = c.y;  \n",
+                 src_tex, c, in, c, iw, in, c, iw, in, c, iw, in, c, iw);
+        }
+    } else {
+        GLSL("for (int y = int(gl_LocalInvocationID.y); y < %d; y += %d) {  \n"
+             "for (int x = int(gl_LocalInvocationID.x); x < %d; x += %d) {  \n"
+             "c = %s(%s, wbase + pt * vec2(x - %d, y - %d));                \n",
+             ih, bh, iw, bw, fn, src_tex, offx, offy);
+        for (int c = 0; c < comps; c++)
+            GLSL("%s%d[%d * y + x] = c[%d]; \n", in, c, iw, c);
+    }
+
+    GLSL("}}                    \n"
+         "groupMemoryBarrier(); \n"
+         "barrier();            \n");
+}
+
+// Number of entries in the direction table used by the compute shader variant
+// of the debanding shader. Since the samples are mirrored along both axes
+// anyway, this only needs to cover a quarter turn.
+#define DEBAND_DIRS 16
+
 void pl_shader_deband(struct pl_shader *sh, const struct pl_sample_src *src,
                       const struct pl_deband_params *params)
 {
@@ -145,56 +225,160 @@ void pl_shader_deband(struct pl_shader *sh, const struct pl_sample_src *src,
         return;
     }
 
-    float scale;
-    ident_t tex, pos, pt;
+    params = PL_DEF(params, &pl_deband_default_params);
+
+    // The compute shader variant needs to know the exact output size in order
+    // to figure out which texels to load into shmem
+    const struct pl_gpu *gpu = SH_GPU(sh);
+    bool flipped = src->rect.x0 > src->rect.x1 || src->rect.y0 > src->rect.y1;
+    bool has_compute = gpu && (gpu->caps & PL_GPU_CAP_COMPUTE) && src->tex &&
+                       !flipped && params->iterations > 0 && !params->no_compute;
+
+    int comps;
+    float rx, ry, scale;
+    int bw = 0, bh = 0, iw = 0, ih = 0;
+    int bound = 0; // every sample lies within this many texels of the pixel
+    bool gather = false;
+    if (has_compute) {
+        float src_w = PL_DEF(pl_rect_w(src->rect), src->tex->params.w);
+        float src_h = PL_DEF(pl_rect_h(src->rect), src->tex->params.h);
+        rx = PL_DEF(src->new_w, roundf(src_w)) / src_w;
+        ry = PL_DEF(src->new_h, roundf(src_h)) / src_h;
+        comps = PL_DEF(src->components, src->tex->params.format->num_components);
+        bound = ceilf(params->iterations * params->radius);
+        gather = shmem_use_gather(sh, comps);
+
+        // Try progressively smaller work groups until the tile plus the
+        // maximum sampling radius fits into shmem
+        static const int sizes[][2] = {{16, 16}, {16, 8}, {8, 8}, {8, 4}};
+        has_compute = false;
+        for (int i = 0; !has_compute && i < PL_ARRAY_SIZE(sizes); i++) {
+            bw = sizes[i][0];
+            bh = sizes[i][1];
+            iw = (int) ceil(bw / rx) + 2 * bound + 2;
+            ih = (int) ceil(bh / ry) + 2 * bound + 2;
+            if (gather) {
+                iw = PL_ALIGN2(iw, 2);
+                ih = PL_ALIGN2(ih, 2);
+            }
+            size_t shmem_req = iw * ih * comps * sizeof(float);
+            has_compute = sh_try_compute(sh, bw, bh, false, shmem_req);
+        }
+    }
+
+    ident_t tex, pos, size, pt;
     const char *fn;
-    if (!setup_src(sh, src, &tex, &pos, NULL, &pt, NULL, NULL, NULL, &scale, true, &fn))
+    if (!setup_src(sh, src, &tex, &pos, &size, &pt, &rx, &ry, &comps, &scale,
+                   !has_compute, &fn, "deband"))
         return;
 
     GLSL("vec4 color;\n");
     GLSL("// pl_shader_deband\n");
     GLSL("{\n");
-    params = PL_DEF(params, &pl_deband_default_params);
 
     ident_t prng, state;
     prng = sh_prng(sh, true, &state);
 
-    GLSL("vec2 pos = %s;       \n"
-         "vec4 avg, diff;      \n"
-         "color = %s(%s, pos); \n",
-         pos, fn, tex);
+    // The averages are computed in half precision, if enabled. The PRNG and
+    // the sample positions always need full precision.
+    const char *hv = sh_half(sh, 4, true), *hcast = sh_half(sh, 4, false);
+    GLSL("vec2 pos = %s;            \n"
+         "%s avg, diff, dc;         \n"
+         "dc = %s(%s(%s, pos));     \n",
+         pos, hv, hcast, fn, tex);
 
-    // Helper function: Compute a stochastic approximation of the avg color
-    // around a pixel, given a specified radius
     ident_t average = sh_fresh(sh, "average");
-    GLSLH("vec4 %s(vec2 pos, float range, inout float %s) {     \n"
-          // Compute a random angle and distance
-          "    float dist = %s * range;                         \n"
-          "    float dir  = %s * %f;                            \n"
-          "    vec2 o = dist * vec2(cos(dir), sin(dir));        \n"
-          // Sample at quarter-turn intervals around the source pixel
-          "    vec4 sum = vec4(0.0);                            \n"
-          "    sum += %s(%s, pos + %s * vec2( o.x,  o.y)); \n"
-          "    sum += %s(%s, pos + %s * vec2(-o.x,  o.y)); \n"
-          "    sum += %s(%s, pos + %s * vec2(-o.x, -o.y)); \n"
-          "    sum += %s(%s, pos + %s * vec2( o.x, -o.y)); \n"
-          // Return the (normalized) average
-          "    return 0.25 * sum;                               \n"
-          "}\n",
-          average, state, prng, prng, M_PI * 2,
-          fn, tex, pt, fn, tex, pt, fn, tex, pt, fn, tex, pt);
-
-    // For each iteration, compute the average at a given distance and
-    // pick it instead of the color if the difference is below the threshold.
-    for (int i = 1; i <= params->iterations; i++) {
-        GLSL("avg = %s(pos, %f, %s);                                    \n"
-             "diff = abs(color - avg);                                  \n"
-             "color = mix(avg, color, %s(greaterThan(diff, vec4(%f)))); \n",
-             average, i * params->radius, state,
-             sh_bvec(sh, 4), params->threshold / (1000 * i * scale));
+    if (has_compute) {
+        // Load the tile plus the maximum sampling radius into shmem, using
+        // the same work group positioning logic as the polar sampler
+        GLSL("vec2 size = %s, pt = %s;                                      \n"
+             "vec2 fcoord = fract(pos * size - vec2(0.5));                  \n"
+             "vec2 wpos = %s_map(gl_WorkGroupID * gl_WorkGroupSize);        \n"
+             "vec2 wbase = wpos - pt * fract(wpos * size - vec2(0.5));      \n"
+             "ivec2 rel = ivec2(round((pos - pt * fcoord - wbase) * size)); \n"
+             "vec4 c;                                                       \n",
+             size, pt, pos);
+
+        ident_t in = sh_fresh(sh, "in");
+        shmem_fill(sh, fn, tex, in, iw, ih, bw, bh, bound, bound, comps, gather);
+
+        // Helper function: Load a texel from shmem
+        ident_t load = sh_fresh(sh, "load");
+        GLSLH("%s %s(ivec2 p) {                         \n"
+              "    int idx = %d * p.y + p.x;            \n"
+              "    vec4 c = vec4(0.0, 0.0, 0.0, 1.0);   \n",
+              hv, load, iw);
+        for (int c = 0; c < comps; c++)
+            GLSLH("    c[%d] = %s%d[idx]; \n", c, in, c);
+        GLSLH("    return %s(c);    \n"
+              "}\n", hcast);
+
+        // Precomputed table of directions, replacing the cos/sin calls
+        ident_t dirs = sh_fresh(sh, "dirs");
+        GLSLH("const vec2 %s[%d] = vec2[](", dirs, DEBAND_DIRS);
+        for (int i = 0; i < DEBAND_DIRS; i++) {
+            double a = (i + 0.5) * M_PI / (2 * DEBAND_DIRS);
+            GLSLH("%svec2(%f, %f)", i ? ", " : "", cos(a), sin(a));
+        }
+        GLSLH(");\n");
+
+        // Helper function: Same as the fragment shader version below, except
+        // that the samples are rounded to the nearest texel in shmem
+        GLSLH("%s %s(ivec2 base, vec2 fcoord, float range, inout float %s) {  \n"
+              "    float dist = %s * range;                                 \n"
+              "    vec2 o = dist * %s[int(%s * %d.0)];                       \n"
+              "    ivec2 a = ivec2(floor(fcoord + o + vec2(0.5)));          \n"
+              "    ivec2 b = ivec2(floor(fcoord - o + vec2(0.5)));          \n"
+              "    %s sum = %s(0.0);                                        \n"
+              "    sum += %s(base + ivec2(a.x, a.y));                       \n"
+              "    sum += %s(base + ivec2(b.x, a.y));                       \n"
+              "    sum += %s(base + ivec2(b.x, b.y));                       \n"
+              "    sum += %s(base + ivec2(a.x, b.y));                       \n"
+              "    return %s(0.25) * sum;                                   \n"
+              "}\n",
+              hv, average, state, prng, dirs, prng, DEBAND_DIRS, hv, hcast,
+              load, load, load, load, hcast);
+
+        for (int i = 1; i <= params->iterations; i++) {
+            GLSL("avg = %s(rel + ivec2(%d), fcoord, %f, %s);               \n"
+                 "diff = abs(dc - avg);                                     \n"
+                 "dc = mix(avg, dc, %s(greaterThan(diff, %s(%f))));         \n",
+                 average, bound, i * params->radius, state,
+                 sh_bvec(sh, 4), hcast, params->threshold / (1000 * i * scale));
+        }
+    } else {
+        // Helper function: Compute a stochastic approximation of the avg color
+        // around a pixel, given a specified radius
+        GLSLH("%s %s(vec2 pos, float range, inout float %s) {       \n"
+              // Compute a random angle and distance
+              "    float dist = %s * range;                         \n"
+              "    float dir  = %s * %f;                            \n"
+              "    vec2 o = dist * vec2(cos(dir), sin(dir));        \n"
+              // Sample at quarter-turn intervals around the source pixel
+              "    %s sum = %s(0.0);                                \n"
+              "    sum += %s(%s(%s, pos + %s * vec2( o.x,  o.y)));  \n"
+              "    sum += %s(%s(%s, pos + %s * vec2(-o.x,  o.y)));  \n"
+              "    sum += %s(%s(%s, pos + %s * vec2(-o.x, -o.y)));  \n"
+              "    sum += %s(%s(%s, pos + %s * vec2( o.x, -o.y)));  \n"
+              // Return the (normalized) average
+              "    return %s(0.25) * sum;                           \n"
+              "}\n",
+              hv, average, state, prng, prng, M_PI * 2, hv, hcast,
+              hcast, fn, tex, pt, hcast, fn, tex, pt,
+              hcast, fn, tex, pt, hcast, fn, tex, pt, hcast);
+
+        // For each iteration, compute the average at a given distance and
+        // pick it instead of the color if the difference is below the threshold.
+        for (int i = 1; i <= params->iterations; i++) {
+            GLSL("avg = %s(pos, %f, %s);                                    \n"
+                 "diff = abs(dc - avg);                                     \n"
+                 "dc = mix(avg, dc, %s(greaterThan(diff, %s(%f))));         \n",
+                 average, i * params->radius, state,
+                 sh_bvec(sh, 4), hcast, params->threshold / (1000 * i * scale));
+        }
     }
 
-    GLSL("color *= vec4(%f);\n", scale);
+    GLSL("color = vec4(dc) * vec4(%f);\n", scale);
 
     // Add some random noise to smooth out residual differences
     if (params->grain > 0) {
@@ -208,15 +392,23 @@ void pl_shader_deband(struct pl_shader *sh, const struct pl_sample_src *src,
 
 bool pl_shader_sample_direct(struct pl_shader *sh, const struct pl_sample_src *src)
 {
+    struct sample_key key;
+    sample_key(&key, src);
+    struct sh_memo memo = {0};
+    if (sh_memo_begin(sh, &memo, "sample_direct", &key, sizeof(key)))
+        return true;
+
     float scale;
     ident_t tex, pos;
     const char *fn;
-    if (!setup_src(sh, src, &tex, &pos, NULL, NULL, NULL, NULL, NULL, &scale, true, &fn))
+    if (!setup_src(sh, src, &tex, &pos, NULL, NULL, NULL, NULL, NULL, &scale,
+                   true, &fn, "direct sample"))
         return false;
 
     GLSL("// pl_shader_sample_direct          \n"
          "vec4 color = vec4(%f) * %s(%s, %s); \n",
          scale, fn, tex, pos);
+    sh_memo_end(sh, &memo);
     return true;
 }
 
@@ -246,10 +438,17 @@ bool pl_shader_sample_bicubic(struct pl_shader *sh, const struct pl_sample_src *
         return false;
     }
 
+    struct sample_key key;
+    sample_key(&key, src);
+    struct sh_memo memo = {0};
+    if (sh_memo_begin(sh, &memo, "sample_bicubic", &key, sizeof(key)))
+        return true;
+
     ident_t tex, pos, size, pt;
     float rx, ry, scale;
     const char *fn;
-    if (!setup_src(sh, src, &tex, &pos, &size, &pt, &rx, &ry, NULL, &scale, true, &fn))
+    if (!setup_src(sh, src, &tex, &pos, &size, &pt, &rx, &ry, NULL, &scale,
+                   true, &fn, "bicubic"))
         return false;
 
     if (rx < 1 || ry < 1) {
@@ -284,6 +483,7 @@ bool pl_shader_sample_bicubic(struct pl_shader *sh, const struct pl_sample_src *
          "color = vec4(%f) * mix(aa, ab, parmx.b);  \n"
          "}                                         \n",
          fn, tex, fn, tex, fn, tex, fn, tex, scale);
+    sh_memo_end(sh, &memo);
     return true;
 }
 
@@ -408,7 +608,8 @@ bool pl_shader_sample_polar(struct pl_shader *sh,
     float rx, ry, scale;
     ident_t src_tex, pos, size, pt;
     const char *fn;
-    if (!setup_src(sh, src, &src_tex, &pos, &size, &pt, &rx, &ry, &comps, &scale, false, &fn))
+    if (!setup_src(sh, src, &src_tex, &pos, &size, &pt, &rx, &ry, &comps,
+                   &scale, false, &fn, "polar"))
         return false;
 
     struct sh_sampler_obj *obj;
@@ -484,6 +685,12 @@ bool pl_shader_sample_polar(struct pl_shader *sh,
     int iw = (int) ceil(bw / rx) + padding + 1,
         ih = (int) ceil(bh / ry) + padding + 1;
 
+    bool gather = shmem_use_gather(sh, comps);
+    if (gather) {
+        iw = PL_ALIGN2(iw, 2);
+        ih = PL_ALIGN2(ih, 2);
+    }
+
     ident_t in = NULL;
     int shmem_req = iw * ih * comps * sizeof(float);
     if (has_compute && sh_try_compute(sh, bw, bh, false, shmem_req)) {
@@ -494,20 +701,9 @@ bool pl_shader_sample_polar(struct pl_shader *sh,
              pos);
 
         // Load all relevant texels into shmem
-        GLSL("for (int y = int(gl_LocalInvocationID.y); y < %d; y += %d) {  \n"
-             "for (int x = int(gl_LocalInvocationID.x); x < %d; x += %d) {  \n"
-             "c = %s(%s, wbase + pt * vec2(x - %d, y - %d));                \n",
-             ih, bh, iw, bw, fn, src_tex, offset, offset);
-
         in = sh_fresh(sh, "in");
-        for (int c = 0; c < comps; c++) {
-            GLSLH("shared float %s%d[%d];   \n", in, c, ih * iw);
-            GLSL("%s%d[%d * y + x] = c[%d]; \n", in, c, iw, c);
-        }
-
-        GLSL("}}                    \n"
-             "groupMemoryBarrier(); \n"
-             "barrier();            \n");
+        shmem_fill(sh, fn, src_tex, in, iw, ih, bw, bh, offset, offset,
+                   comps, gather);
 
         // Dispatch the actual samples
         for (int y = 1 - bound; y <= bound; y++) {
@@ -590,6 +786,126 @@ static void fill_ortho_lut(void *data, const struct sh_lut_params *params)
     memcpy(data, filt->weights, entries * sizeof(float));
 }
 
+// (Re)generates the separated filter stored in `obj` for a given scaling
+// ratio, if needed. Sets `*update` if the filter was regenerated.
+static bool ortho_filter(struct pl_shader *sh, struct sh_sampler_obj *obj,
+                         float ratio, const struct pl_sample_filter_params *params,
+                         bool *update)
+{
+    const struct pl_gpu *gpu = SH_GPU(sh);
+    float inv_scale = 1.0 / ratio;
+    inv_scale = PL_MAX(inv_scale, 1.0);
+
+    if (params->no_widening)
+        inv_scale = 1.0;
+
+    int lut_entries = PL_DEF(params->lut_entries, 64);
+    *update = !filter_compat(obj->filter, inv_scale, lut_entries, 0.0,
+                             &params->filter);
+
+    if (*update) {
+        pl_filter_free(&obj->filter);
+        obj->filter = pl_filter_generate(sh->ctx, &(struct pl_filter_params) {
+            .config             = params->filter,
+            .lut_entries        = lut_entries,
+            .filter_scale       = inv_scale,
+            .max_row_size       = gpu->limits.max_tex_2d_dim / 4,
+            .row_stride_align   = 4,
+        });
+
+        if (!obj->filter) {
+            // This should never happen, but just in case ..
+            SH_FAIL(sh, "Failed initializing separated filter!");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Returns the LUT for a filter previously set up by `ortho_filter`. Each LUT
+// entry contains four consecutive weights, so the weight for the n'th sample
+// is stored in component n % 4 of LUT(vec2(n / 4 / (width - 1), fcoord))
+static ident_t ortho_lut(struct pl_shader *sh, struct sh_sampler_obj *obj,
+                         bool update)
+{
+    ident_t lut = sh_lut(sh, &(struct sh_lut_params) {
+        .object = &obj->lut,
+        .method = SH_LUT_LINEAR,
+        .type = PL_VAR_FLOAT,
+        .width = obj->filter->row_stride / 4,
+        .height = obj->filter->params.lut_entries,
+        .comps = 4,
+        .update = update,
+        .fill = fill_ortho_lut,
+        .priv = obj,
+    });
+
+    if (!lut)
+        SH_FAIL(sh, "Failed initializing separated LUT!");
+    return lut;
+}
+
+// Returns whether the taps n and n+1 of a separated filter can be merged into
+// a single bilinear texture fetch, which requires their weights to have the
+// same sign (and a nonzero sum) in each of the `num_rows` rows of weights
+static bool ortho_can_merge(const float *weights, int num_rows, int row_stride,
+                            int row_size, int n)
+{
+    if (n + 1 >= row_size)
+        return false;
+
+    for (int i = 0; i < num_rows; i++) {
+        const float *row = weights + i * row_stride;
+        float w0 = row[n], w1 = row[n + 1];
+        if (w0 * w1 < 0 || fabs(w0 + w1) < 1e-6)
+            return false;
+    }
+
+    return true;
+}
+
+// Maximum number of distinct subpixel offsets to bake into the shader
+#define ORTHO_MAX_PERIOD 4
+
+// For scaling ratios of the form p/q with small p, the subpixel offset of the
+// sampled positions repeats every p output pixels. Returns p if this is the
+// case (and the shader can index arrays dynamically), or 0 otherwise. The
+// offset of the first output pixel is returned in `*phase`.
+static int ortho_period(struct pl_shader *sh, const struct pl_sample_src *src,
+                        int pass, float ratio, double *phase)
+{
+    if (!src->tex)
+        return 0; // position mapping is unknown
+
+    float x0 = pass == PL_SEP_HORIZ ? src->rect.x0 : src->rect.y0;
+    float w = pass == PL_SEP_HORIZ ? pl_rect_w(src->rect) : pl_rect_h(src->rect);
+    if (w < 0)
+        return 0; // flipped
+
+    // Only allow crop offsets which are multiples of 1/8, to avoid generating
+    // a new shader for every frame of e.g. smooth panning. This still covers
+    // the common chroma locations.
+    if (x0 * 8 != roundf(x0 * 8))
+        return 0;
+
+    struct pl_glsl_desc glsl = sh_glsl(sh);
+    int max_period = glsl.version >= (glsl.gles ? 300 : 130) ? ORTHO_MAX_PERIOD : 1;
+    for (int p = 1; p <= max_period; p++) {
+        double q = p / ratio;
+        if (round(q) >= 1 && fabs(q - round(q)) < 1e-4) {
+            // The source position of output pixel i is x0 + (i + 0.5) / ratio
+            *phase = x0 - 0.5 + 0.5 / ratio;
+            *phase -= floor(*phase);
+            if (*phase > 1.0 - 1e-6)
+                *phase = 0.0;
+            return p;
+        }
+    }
+
+    return 0;
+}
+
 bool pl_shader_sample_ortho(struct pl_shader *sh, int pass,
                             const struct pl_sample_src *src,
                             const struct pl_sample_filter_params *params)
@@ -600,8 +916,7 @@ bool pl_shader_sample_ortho(struct pl_shader *sh, int pass,
         return false;
     }
 
-    const struct pl_gpu *gpu = SH_GPU(sh);
-    pl_assert(gpu);
+    pl_assert(SH_GPU(sh));
 
     struct pl_sample_src srcfix = *src;
     switch (pass) {
@@ -623,7 +938,8 @@ bool pl_shader_sample_ortho(struct pl_shader *sh, int pass,
     ident_t src_tex, pos, size, pt;
     const char *fn;
     if (!setup_src(sh, &srcfix, &src_tex, &pos, &size, &pt, &ratio[1], &ratio[0],
-                   &comps, &scale, false, &fn))
+                   &comps, &scale, false, &fn,
+                   pass == PL_SEP_VERT ? "ortho vertical" : "ortho horizontal"))
     {
         return false;
     }
@@ -648,49 +964,42 @@ bool pl_shader_sample_ortho(struct pl_shader *sh, int pass,
         assert(obj);
     }
 
-    float inv_scale = 1.0 / ratio[pass];
-    inv_scale = PL_MAX(inv_scale, 1.0);
-
-    if (params->no_widening)
-        inv_scale = 1.0;
-
-    int lut_entries = PL_DEF(params->lut_entries, 64);
-    bool update = !filter_compat(obj->filter, inv_scale, lut_entries, 0.0,
-                                 &params->filter);
+    bool update;
+    if (!ortho_filter(sh, obj, ratio[pass], params, &update))
+        return false;
 
-    if (update) {
-        pl_filter_free(&obj->filter);
-        obj->filter = pl_filter_generate(sh->ctx, &(struct pl_filter_params) {
-            .config             = params->filter,
-            .lut_entries        = lut_entries,
-            .filter_scale       = inv_scale,
-            .max_row_size       = gpu->limits.max_tex_2d_dim / 4,
-            .row_stride_align   = 4,
-        });
+    int N = obj->filter->row_size; // number of samples to convolve
+    int width = obj->filter->row_stride / 4; // width of the LUT texture
 
-        if (!obj->filter) {
-            // This should never happen, but just in case ..
-            SH_FAIL(sh, "Failed initializing separated filter!");
-            return false;
+    // For fixed-ratio scaling (e.g. 2x chroma upscaling), bake the weights
+    // for each possible subpixel offset into the shader instead of using the
+    // LUT. These are stored in `rows`, padded to a multiple of four.
+    //
+    // Offset `i` is the subpixel offset of the positions phase0 + i / period
+    // (mod 1), which lie in the texel `offs[i]` after the one containing
+    // phase0.
+    double phase0 = 0.0;
+    int period = ortho_period(sh, &srcfix, pass, ratio[pass], &phase0);
+    int stride = PL_ALIGN2(N, 4);
+    float *rows = NULL;
+    int offs[ORTHO_MAX_PERIOD] = {0};
+    ident_t lut = NULL;
+    if (period) {
+        rows = talloc_zero_array(NULL, float, period * stride);
+        for (int i = 0; i < period; i++) {
+            double x = phase0 + (double) i / period;
+            offs[i] = floor(x + 1e-6);
+            pl_filter_compute_row(obj->filter, PL_MAX(x - offs[i], 0.0),
+                                  rows + i * stride);
         }
-    }
 
-    int N = obj->filter->row_size; // number of samples to convolve
-    int width = obj->filter->row_stride / 4; // width of the LUT texture
-    ident_t lut = sh_lut(sh, &(struct sh_lut_params) {
-        .object = &obj->lut,
-        .method = SH_LUT_LINEAR,
-        .type = PL_VAR_FLOAT,
-        .width = width,
-        .height = lut_entries,
-        .comps = 4,
-        .update = update,
-        .fill = fill_ortho_lut,
-        .priv = obj,
-    });
-    if (!lut) {
-        SH_FAIL(sh, "Failed initializing separated LUT!");
-        return false;
+        // Make sure the LUT gets regenerated when it's next needed
+        if (update)
+            pl_shader_obj_destroy(&obj->lut);
+    } else {
+        lut = ortho_lut(sh, obj, update);
+        if (!lut)
+            return false;
     }
 
     const float dir[PL_SEP_PASSES][2] = {
@@ -698,6 +1007,10 @@ bool pl_shader_sample_ortho(struct pl_shader *sh, int pass,
         [PL_SEP_VERT]  = {0.0, 1.0},
     };
 
+    // The taps are accumulated in half precision, if enabled
+    const char *hf = sh_half(sh, 1, true), *hv = sh_half(sh, 4, true),
+               *hcast = sh_half(sh, 4, false);
+
     GLSL("// pl_shader_sample_ortho                        \n"
          "vec4 color = vec4(0.0);                          \n"
          "{                                                \n"
@@ -705,35 +1018,114 @@ bool pl_shader_sample_ortho(struct pl_shader *sh, int pass,
          "vec2 dir = vec2(%f, %f);                         \n"
          "pt *= dir;                                       \n"
          "vec2 fcoord2 = fract(pos * size - vec2(0.5));    \n"
-         "float fcoord = dot(fcoord2, dir);                \n"
-         "vec2 base = pos - fcoord * pt - pt * vec2(%d.0); \n"
-         "float weight;                                    \n"
-         "vec4 ws, c;                                      \n",
+         "float fcoord = dot(fcoord2, dir);                \n",
          pos, size, pt,
-         dir[pass][0], dir[pass][1],
-         N / 2 - 1);
+         dir[pass][0], dir[pass][1]);
+
+    // Figure out which of the baked subpixel offsets this pixel is using.
+    // The sampled positions are exactly phase0 + idx / period (in texels),
+    // so round to the nearest `idx` and derive both the offset and the texel
+    // to start from it. Taking these from `fcoord` instead could disagree on
+    // positions which `fract` rounds to just below the next texel.
+    if (period) {
+        GLSL("float tpos = dot(pos * size, dir) - 0.5;       \n"
+             "float idx = floor((tpos - %f) * %d.0 + 0.5);   \n",
+             phase0, period);
+        if (period > 1) {
+            GLSL("int phase = int(mod(idx, %d.0));                      \n"
+                 "const float offs[%d] = float[](",
+                 period, period);
+            for (int i = 0; i < period; i++)
+                GLSL("%s%d.0", i ? ", " : "", offs[i]);
+            GLSL(");                                                    \n"
+                 "fcoord = tpos - (idx - float(phase)) / %d.0 - offs[phase]; \n",
+                 period);
+        } else {
+            pl_assert(offs[0] == 0);
+            GLSL("fcoord = tpos - idx; \n");
+        }
+    }
+
+    GLSL("vec2 base = pos - fcoord * pt - pt * vec2(%d.0); \n"
+         "%s weight;                                       \n"
+         "%s ws, c, sum = %s(0.0);                         \n",
+         N / 2 - 1, hf, hv, hcast);
 
     bool use_ar = params->antiring > 0;
     if (use_ar) {
-        GLSL("vec4 hi = vec4(0.0); \n"
-             "vec4 lo = vec4(1e9); \n");
+        // 1e9 is out of range for half precision, so use the largest value
+        // guaranteed to be representable by `mediump` instead
+        GLSL("%s hi = %s(0.0); \n"
+             "%s lo = %s(%s);  \n",
+             hv, hcast, hv, hcast,
+             SH_PARAMS(sh).half_precision ? "16384.0" : "1e9");
     }
 
+    // Merging taps relies on the hardware's bilinear interpolation
+    bool merge = params->merge_taps &&
+                 src_params(src).sample_mode == PL_TEX_SAMPLE_LINEAR;
+
     // Dispatch all of the samples
     GLSL("// scaler samples\n");
     for (int n = 0; n < N; n++) {
         // Load the right weight for this instance. For every 4th weight, we
         // need to fetch another LUT entry. Otherwise, just use the previous
-        if (n % 4 == 0) {
+        if (n % 4 == 0 && period == 1) {
+            const float *w = &rows[n];
+            GLSL("ws = %s(%f, %f, %f, %f);\n", hcast, w[0], w[1], w[2], w[3]);
+        } else if (n % 4 == 0 && period) {
+            ident_t weights = sh_fresh(sh, "weights");
+            GLSL("const vec4 %s[%d] = vec4[](", weights, period);
+            for (int i = 0; i < period; i++) {
+                const float *w = &rows[i * stride + n];
+                GLSL("%svec4(%f, %f, %f, %f)", i ? ", " : "",
+                     w[0], w[1], w[2], w[3]);
+            }
+            GLSL("); \n"
+                 "ws = %s(%s[phase]); \n", hcast, weights);
+        } else if (n % 4 == 0) {
             float denom = PL_MAX(1, width - 1); // avoid division by zero
-            GLSL("ws = %s(vec2(%f, fcoord));\n", lut, (n / 4) / denom);
+            GLSL("ws = %s(%s(vec2(%f, fcoord)));\n", hcast, lut,
+                 (n / 4) / denom);
         }
+
+        // For pairs of taps with same-signed weights, a single bilinear
+        // fetch at the weighted position between both texels is equivalent
+        // to sampling them separately. This can't be done for the central
+        // taps when antiringing, since they need to be sampled individually.
+        bool is_center = use_ar && (n + 1 == N / 2 - 1 || n == N / 2 - 1 ||
+                                    n == N / 2);
+        // Skip taps which have no effect for any of the baked offsets
+        bool is_zero = period && !(use_ar && (n == N / 2 - 1 || n == N / 2));
+        for (int i = 0; is_zero && i < period; i++)
+            is_zero = rows[i * stride + n] == 0.0;
+        if (is_zero)
+            continue;
+
+        bool can_merge = merge && n % 2 == 0 && !is_center;
+        if (can_merge && period) {
+            can_merge = ortho_can_merge(rows, period, stride, N, n);
+        } else if (can_merge) {
+            can_merge = ortho_can_merge(obj->filter->weights,
+                                        obj->filter->params.lut_entries,
+                                        obj->filter->row_stride, N, n);
+        }
+
+        if (can_merge) {
+            GLSL("weight = ws[%d] + ws[%d];                                    \n"
+                 "c = %s(%s(%s, base + pt * vec2(%d.0 + ws[%d] / weight))); \n"
+                 "sum += weight * c;                                           \n",
+                 n % 4, n % 4 + 1, hcast, fn, src_tex, n, n % 4 + 1);
+            n++; // skip the merged tap
+            continue;
+        }
+
         GLSL("weight = ws[%d];\n", n % 4);
 
         // Load the input texel and add it to the running sum
-        GLSL("c = %s(%s, base + pt * vec2(%d.0)); \n"
-             "color += vec4(weight) * c;          \n",
-             fn, src_tex, n);
+        GLSL("c = %s(%s(%s, base + pt * vec2(%d.0))); \n"
+             "sum += weight * c;                      \n",
+             hcast, fn, src_tex, n);
 
         if (use_ar && (n == N / 2 - 1 || n == N / 2)) {
             GLSL("lo = min(lo, c); \n"
@@ -741,8 +1133,10 @@ bool pl_shader_sample_ortho(struct pl_shader *sh, int pass,
         }
     }
 
+    talloc_free(rows);
+    GLSL("color = vec4(sum);\n");
     if (use_ar) {
-        GLSL("color = mix(color, clamp(color, lo, hi), %f);\n",
+        GLSL("color = mix(color, clamp(color, vec4(lo), vec4(hi)), %f);\n",
              params->antiring);
     }
 
@@ -750,3 +1144,182 @@ bool pl_shader_sample_ortho(struct pl_shader *sh, int pass,
     GLSL("}\n");
     return true;
 }
+
+// Subroutine for convolving one dimension of the input stored in shmem. The
+// samples are read from `in`X[idx + n * stride] for each sample n, where X is
+// the component; `idx` must be defined by the caller. The result is written
+// to `out`.
+static void ortho2_convolve(struct pl_shader *sh, const struct pl_filter *filter,
+                            ident_t lut, const char *fcoord, ident_t in,
+                            int stride, int comps, float antiring,
+                            const char *out)
+{
+    int N = filter->row_size;
+    int width = filter->row_stride / 4;
+    float denom = PL_MAX(1, width - 1); // avoid division by zero
+
+    GLSL("%s = vec4(0.0); \n", out);
+    if (antiring > 0) {
+        GLSL("hi = vec4(0.0); \n"
+             "lo = vec4(1e9); \n");
+    }
+
+    for (int n = 0; n < N; n++) {
+        if (n % 4 == 0)
+            GLSL("ws = %s(vec2(%f, %s));\n", lut, (n / 4) / denom, fcoord);
+        for (int c = 0; c < comps; c++)
+            GLSL("c[%d] = %s%d[idx + %d];\n", c, in, c, n * stride);
+        GLSL("%s += vec4(ws[%d]) * c;\n", out, n % 4);
+
+        if (antiring > 0 && (n == N / 2 - 1 || n == N / 2)) {
+            GLSL("lo = min(lo, c); \n"
+                 "hi = max(hi, c); \n");
+        }
+    }
+
+    if (antiring > 0)
+        GLSL("%s = mix(%s, clamp(%s, lo, hi), %f);\n", out, out, out, antiring);
+}
+
+bool pl_shader_sample_ortho2(struct pl_shader *sh,
+                             const struct pl_sample_src *src,
+                             const struct pl_sample_filter_params *params)
+{
+    pl_assert(params);
+    if (params->filter.polar) {
+        SH_FAIL(sh, "Trying to use separated sampling with a polar filter?");
+        return false;
+    }
+
+    const struct pl_gpu *gpu = SH_GPU(sh);
+    pl_assert(gpu);
+
+    // Everything up to and including `sh_try_compute` must either leave the
+    // shader untouched (so the caller can fall back to two separate passes),
+    // or fail it. Past that point, the shader is committed to compute and
+    // all errors are fatal.
+    if (params->no_compute || !(gpu->caps & PL_GPU_CAP_COMPUTE))
+        return false;
+
+    // Same restrictions as the compute shader path of pl_shader_sample_polar
+    bool flipped = src->rect.x0 > src->rect.x1 || src->rect.y0 > src->rect.y1;
+    if (!src->tex || flipped) {
+        PL_TRACE(sh, "Single-pass separated sampling requires a non-flipped "
+                 "pl_tex source, falling back to two passes.");
+        return false;
+    }
+
+    float src_w = PL_DEF(pl_rect_w(src->rect), src->tex->params.w);
+    float src_h = PL_DEF(pl_rect_h(src->rect), src->tex->params.h);
+    int out_w = PL_DEF(src->new_w, roundf(src_w));
+    int out_h = PL_DEF(src->new_h, roundf(src_h));
+    float rx = out_w / src_w, ry = out_h / src_h;
+    int comps = PL_DEF(src->components, src->tex->params.format->num_components);
+
+    // Use the same sampler objects as `pl_shader_sample_ortho`, so switching
+    // between the two does not require regenerating the LUTs
+    struct sh_sampler_obj *obj_y, *obj_x;
+    obj_y = SH_OBJ(sh, params->lut, PL_SHADER_OBJ_SAMPLER,
+                   struct sh_sampler_obj, sh_sampler_uninit);
+    if (!obj_y)
+        return false;
+    obj_x = SH_OBJ(sh, &obj_y->pass2, PL_SHADER_OBJ_SAMPLER,
+                   struct sh_sampler_obj, sh_sampler_uninit);
+    assert(obj_x);
+
+    bool update_y, update_x;
+    if (!ortho_filter(sh, obj_y, ry, params, &update_y) ||
+        !ortho_filter(sh, obj_x, rx, params, &update_x))
+        return false;
+
+    // Each work group loads its entire source footprint into shmem once, runs
+    // the vertical pass over every column of it (storing the result in a
+    // second shmem array with one row per output row), and finally runs the
+    // horizontal pass on that. Try progressively smaller work groups until
+    // the shmem requirements fit.
+    int Nx = obj_x->filter->row_size, Ny = obj_y->filter->row_size;
+    bool gather = shmem_use_gather(sh, comps);
+    static const int sizes[][2] = {{32, 8}, {16, 8}, {8, 8}, {8, 4}};
+    int bw = 0, bh = 0, iw = 0, ih = 0;
+    bool ok = false;
+    for (int i = 0; !ok && i < PL_ARRAY_SIZE(sizes); i++) {
+        bw = sizes[i][0];
+        bh = sizes[i][1];
+        iw = (int) ceil(bw / rx) + Nx;
+        ih = (int) ceil(bh / ry) + Ny;
+        if (gather) {
+            iw = PL_ALIGN2(iw, 2);
+            ih = PL_ALIGN2(ih, 2);
+        }
+        size_t shmem_req = (iw * ih + iw * bh) * comps * sizeof(float);
+        ok = sh_try_compute(sh, bw, bh, false, shmem_req);
+    }
+
+    if (!ok) {
+        PL_TRACE(sh, "Single-pass separated sampling does not fit into shmem, "
+                 "falling back to two passes.");
+        // Force the fallback to regenerate the filters, so the LUTs get
+        // updated as well
+        if (update_y)
+            pl_filter_free(&obj_y->filter);
+        if (update_x)
+            pl_filter_free(&obj_x->filter);
+        return false;
+    }
+
+    float scale;
+    ident_t src_tex, pos, size, pt;
+    const char *fn;
+    if (!setup_src(sh, src, &src_tex, &pos, &size, &pt, NULL, NULL, NULL,
+                   &scale, false, &fn, "ortho 2D"))
+        return false;
+
+    ident_t lut_y = ortho_lut(sh, obj_y, update_y);
+    ident_t lut_x = ortho_lut(sh, obj_x, update_x);
+    if (!lut_y || !lut_x)
+        return false;
+
+    ident_t in = sh_fresh(sh, "in"), tmp = sh_fresh(sh, "tmp");
+    for (int c = 0; c < comps; c++)
+        GLSLH("shared float %s%d[%d]; \n", tmp, c, iw * bh);
+
+    GLSL("// pl_shader_sample_ortho2                                \n"
+         "vec4 color = vec4(0.0);                                  \n"
+         "{                                                        \n"
+         "vec2 pos = %s, size = %s, pt = %s;                       \n"
+         "vec2 fcoord = fract(pos * size - vec2(0.5));             \n"
+         "vec2 base = pos - pt * fcoord;                           \n"
+         "vec2 wpos = %s_map(gl_WorkGroupID * gl_WorkGroupSize);   \n"
+         "vec2 wbase = wpos - pt * fract(wpos * size - vec2(0.5)); \n"
+         "ivec2 rel = ivec2(round((base - wbase) * size));         \n"
+         "int row = %d * int(gl_LocalInvocationID.y);              \n"
+         "int idx;                                                 \n"
+         "vec4 c, ws, lo, hi, sum;                                 \n",
+         pos, size, pt, pos, iw);
+
+    // Load all relevant texels into shmem
+    shmem_fill(sh, fn, src_tex, in, iw, ih, bw, bh, Nx / 2 - 1, Ny / 2 - 1,
+               comps, gather);
+    GLSL("c = vec4(0.0); \n");
+
+    // Vertical pass, for every column of this invocation's output row
+    GLSL("for (int x = int(gl_LocalInvocationID.x); x < %d; x += %d) { \n"
+         "idx = %d * rel.y + x;                                        \n",
+         iw, bw, iw);
+    ortho2_convolve(sh, obj_y->filter, lut_y, "fcoord.y", in, iw, comps,
+                    params->antiring, "sum");
+    for (int c = 0; c < comps; c++)
+        GLSL("%s%d[row + x] = sum[%d]; \n", tmp, c, c);
+    GLSL("}                     \n"
+         "groupMemoryBarrier(); \n"
+         "barrier();            \n");
+
+    // Horizontal pass, for this invocation's output pixel
+    GLSL("idx = row + rel.x; \n");
+    ortho2_convolve(sh, obj_x->filter, lut_x, "fcoord.x", tmp, 1, comps,
+                    params->antiring, "color");
+    GLSL("color *= vec4(%f); \n"
+         "}                  \n",
+         scale);
+    return true;
+}
@@ -55,11 +55,24 @@ typedef void (*bench_fn)(struct pl_shader *sh, struct pl_shader_obj **state,
 static void run_bench(const struct pl_gpu *gpu, struct pl_dispatch *dp,
                       struct pl_shader_obj **state, const struct pl_tex *src,
                       const struct pl_tex *fbo, struct pl_timer *timer,
-                      bench_fn bench)
+                      bench_fn bench, const int *dispatch)
 {
     struct pl_shader *sh = pl_dispatch_begin(dp);
     bench(sh, state, src);
 
+    if (dispatch) {
+        int w = 0, h = 0;
+        pl_shader_output_size(sh, &w, &h);
+        pl_dispatch_compute(dp, &(struct pl_dispatch_compute_params) {
+            .shader = &sh,
+            .dispatch_size = { dispatch[0], dispatch[1], dispatch[2] },
+            .width = w,
+            .height = h,
+            .timer = timer,
+        });
+        return;
+    }
+
     pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
         .shader = &sh,
         .target = fbo,
@@ -67,7 +80,12 @@ static void run_bench(const struct pl_gpu *gpu, struct pl_dispatch *dp,
     });
 }
 
-static void benchmark(const struct pl_gpu *gpu, const char *name, bench_fn bench)
+// If `dispatch` is set, the shader is run as a standalone compute dispatch of
+// this many work groups instead of rendering it to an FBO. As with
+// `pl_dispatch_compute`, leaving it as {0} sizes the dispatch according to the
+// shader's output size instead.
+static void benchmark_ex(const struct pl_gpu *gpu, const char *name,
+                         bench_fn bench, const int *dispatch)
 {
     struct pl_dispatch *dp = pl_dispatch_create(gpu->ctx, gpu);
     struct pl_shader_obj *state = NULL;
@@ -91,7 +109,7 @@ static void benchmark(const struct pl_gpu *gpu, const char *name, bench_fn bench
     }
 
     // Run the benchmark and flush+block once to force shader compilation etc.
-    run_bench(gpu, dp, &state, src, fbos[0], NULL, bench);
+    run_bench(gpu, dp, &state, src, fbos[0], NULL, bench, dispatch);
     pl_gpu_finish(gpu);
 
     // Perform the actual benchmark
@@ -107,7 +125,7 @@ static void benchmark(const struct pl_gpu *gpu, const char *name, bench_fn bench
     gettimeofday(&start, NULL);
     do {
         frames++;
-        run_bench(gpu, dp, &state, src, fbos[index++], timer, bench);
+        run_bench(gpu, dp, &state, src, fbos[index++], timer, bench, dispatch);
         index %= NUM_FBOS;
         if (index == 0) {
             pl_gpu_flush(gpu);
@@ -144,6 +162,91 @@ static void benchmark(const struct pl_gpu *gpu, const char *name, bench_fn bench
         pl_tex_destroy(gpu, &fbos[i]);
 }
 
+static void benchmark(const struct pl_gpu *gpu, const char *name, bench_fn bench)
+{
+    benchmark_ex(gpu, name, bench, NULL);
+}
+
+// Measures the CPU time spent inside `pl_render_image` (i.e. the cost of
+// generating and dispatching all of the shaders), as well as the overall
+// time per frame when rendering to a `w`x`h` target
+static void bench_render(const struct pl_gpu *gpu, const char *name, int w, int h,
+                         const struct pl_render_params *params)
+{
+    const struct pl_tex *src = create_test_img(gpu);
+    const struct pl_fmt *fmt;
+    fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 16, 0, PL_FMT_CAP_RENDERABLE);
+    REQUIRE(fmt);
+
+    const struct pl_tex *fbo = pl_tex_create(gpu, &(struct pl_tex_params) {
+        .format         = fmt,
+        .w              = w,
+        .h              = h,
+        .renderable     = true,
+        .storable       = !!(fmt->caps & PL_FMT_CAP_STORABLE),
+    });
+    REQUIRE(fbo);
+
+    struct pl_renderer *rr = pl_renderer_create(gpu->ctx, gpu);
+    struct pl_image image = {
+        .num_planes     = 1,
+        .planes         = {{
+            .texture            = src,
+            .components         = 3,
+            .component_mapping  = {0, 1, 2},
+        }},
+        .repr = {
+            .sys        = PL_COLOR_SYSTEM_RGB,
+            .levels     = PL_COLOR_LEVELS_PC,
+        },
+        .color          = pl_color_space_bt709,
+    };
+
+    struct pl_render_target target = {
+        .fbo            = fbo,
+        .repr = {
+            .sys        = PL_COLOR_SYSTEM_RGB,
+            .levels     = PL_COLOR_LEVELS_PC,
+        },
+        .color          = pl_color_space_srgb,
+    };
+
+    // Render once and block to force shader compilation etc.
+    REQUIRE(pl_render_image(rr, &image, &target, params));
+    pl_gpu_finish(gpu);
+
+    struct timeval start = {0}, stop = {0}, before, after;
+    unsigned long frames = 0;
+    uint64_t cputime = 0;
+
+    gettimeofday(&start, NULL);
+    do {
+        frames++;
+        gettimeofday(&before, NULL);
+        REQUIRE(pl_render_image(rr, &image, &target, params));
+        gettimeofday(&after, NULL);
+        cputime += (after.tv_sec - before.tv_sec) * 1000000LLU +
+                   after.tv_usec - before.tv_usec;
+
+        if (frames % NUM_FBOS == 0) {
+            pl_gpu_finish(gpu);
+            gettimeofday(&stop, NULL);
+        }
+    } while (stop.tv_sec - start.tv_sec < BENCH_DUR);
+
+    pl_gpu_finish(gpu);
+    gettimeofday(&stop, NULL);
+    float secs = (float) (stop.tv_sec - start.tv_sec) +
+                 1e-6 * (stop.tv_usec - start.tv_usec);
+    printf("'%s':\t%4lu frames => %2.6f ms/frame, %2.6f ms/frame in "
+           "pl_render_image\n", name, frames, 1000 * secs / frames,
+           1e-3 * cputime / frames);
+
+    pl_renderer_destroy(&rr);
+    pl_tex_destroy(gpu, &fbo);
+    pl_tex_destroy(gpu, &src);
+}
+
 // List of benchmarks
 static void bench_deband(struct pl_shader *sh, struct pl_shader_obj **state,
                          const struct pl_tex *src)
@@ -206,6 +309,31 @@ static void bench_dither_ordered_fix(struct pl_shader *sh,
     pl_shader_dither(sh, 8, state, &params);
 }
 
+static const struct pl_tex *ed_out;
+
+static void bench_dither_ed(struct pl_shader *sh, struct pl_shader_obj **state,
+                            const struct pl_tex *src)
+{
+    pl_shader_error_diffusion(sh, &(struct pl_error_diffusion_params) {
+        .input_tex  = src,
+        .output_tex = ed_out,
+        .new_depth  = 8,
+        .kernel     = &pl_error_diffusion_floyd_steinberg,
+    });
+}
+
+static void bench_dither_ed_sierra(struct pl_shader *sh,
+                                   struct pl_shader_obj **state,
+                                   const struct pl_tex *src)
+{
+    pl_shader_error_diffusion(sh, &(struct pl_error_diffusion_params) {
+        .input_tex  = src,
+        .output_tex = ed_out,
+        .new_depth  = 8,
+        .kernel     = &pl_error_diffusion_sierra_lite,
+    });
+}
+
 static void bench_polar(struct pl_shader *sh, struct pl_shader_obj **state,
                         const struct pl_tex *src)
 {
@@ -230,6 +358,46 @@ static void bench_polar_nocompute(struct pl_shader *sh,
     pl_shader_sample_polar(sh, &(struct pl_sample_src) { .tex = src }, &params);
 }
 
+static void bench_ortho2(struct pl_shader *sh, struct pl_shader_obj **state,
+                         const struct pl_tex *src)
+{
+    struct pl_sample_filter_params params = {
+        .filter = pl_filter_lanczos,
+        .lut = state,
+    };
+
+    pl_shader_sample_ortho2(sh, &(struct pl_sample_src) { .tex = src }, &params);
+}
+
+static void bench_ortho_down(struct pl_shader *sh, struct pl_shader_obj **state,
+                             const struct pl_tex *src)
+{
+    struct pl_sample_filter_params params = {
+        .filter = pl_filter_mitchell,
+        .lut = state,
+    };
+
+    pl_shader_sample_ortho(sh, PL_SEP_VERT, &(struct pl_sample_src) {
+        .tex = src,
+        .new_h = TEX_SIZE / 2,
+    }, &params);
+}
+
+static void bench_ortho_down_merged(struct pl_shader *sh,
+                                    struct pl_shader_obj **state,
+                                    const struct pl_tex *src)
+{
+    struct pl_sample_filter_params params = {
+        .filter = pl_filter_mitchell,
+        .merge_taps = true,
+        .lut = state,
+    };
+
+    pl_shader_sample_ortho(sh, PL_SEP_VERT, &(struct pl_sample_src) {
+        .tex = src,
+        .new_h = TEX_SIZE / 2,
+    }, &params);
+}
 
 static void bench_hdr_peak(struct pl_shader *sh, struct pl_shader_obj **state,
                             const struct pl_tex *src)
@@ -238,6 +406,15 @@ static void bench_hdr_peak(struct pl_shader *sh, struct pl_shader_obj **state,
     pl_shader_detect_peak(sh, pl_color_space_hdr10, state, NULL);
 }
 
+static void bench_hdr_peak_stride(struct pl_shader *sh,
+                                  struct pl_shader_obj **state,
+                                  const struct pl_tex *src)
+{
+    struct pl_peak_detect_params params = pl_peak_detect_default_params;
+    params.sample_stride = 4;
+    pl_shader_detect_peak_tex(sh, src, NULL, pl_color_space_hdr10, state, &params);
+}
+
 static void bench_av1_grain(struct pl_shader *sh, struct pl_shader_obj **state,
                             const struct pl_tex *src)
 {
@@ -269,6 +446,22 @@ static void bench_av1_grain_lap(struct pl_shader *sh, struct pl_shader_obj **sta
     pl_shader_av1_grain(sh, state, &params);
 }
 
+static void bench_av1_grain_gpu(struct pl_shader *sh, struct pl_shader_obj **state,
+                                const struct pl_tex *src)
+{
+    struct pl_av1_grain_params params = {
+        .data = av1_grain_data,
+        .tex = src,
+        .components = 3,
+        .component_mapping = {0, 1, 2},
+        .repr = &(struct pl_color_repr) {0},
+        .gpu_generate = true,
+    };
+
+    params.data.grain_seed = rand();
+    pl_shader_av1_grain(sh, state, &params);
+}
+
 int main()
 {
     setbuf(stdout, NULL);
@@ -300,18 +493,67 @@ int main()
     if (vk->gpu->caps & PL_GPU_CAP_COMPUTE)
         benchmark(vk->gpu, "polar_nocompute", bench_polar_nocompute);
 
+    // Separated sampling
+    benchmark(vk->gpu, "ortho_down", bench_ortho_down);
+    benchmark(vk->gpu, "ortho_down_merged", bench_ortho_down_merged);
+    if (vk->gpu->caps & PL_GPU_CAP_COMPUTE)
+        benchmark(vk->gpu, "ortho2", bench_ortho2);
+
     // Dithering algorithms
     benchmark(vk->gpu, "dither_blue", bench_dither_blue);
     benchmark(vk->gpu, "dither_white", bench_dither_white);
     benchmark(vk->gpu, "dither_ordered_fixed", bench_dither_ordered_fix);
 
+    const struct pl_fmt *ed_fmt;
+    ed_fmt = pl_find_fmt(vk->gpu, PL_FMT_UNORM, 4, 8, 8, PL_FMT_CAP_STORABLE);
+    if (ed_fmt && vk->gpu->caps & PL_GPU_CAP_COMPUTE) {
+        ed_out = pl_tex_create(vk->gpu, &(struct pl_tex_params) {
+            .format     = ed_fmt,
+            .w          = TEX_SIZE,
+            .h          = TEX_SIZE,
+            .storable   = true,
+        });
+        REQUIRE(ed_out);
+
+        // Error diffusion runs as a single work group over the whole image
+        const int ed_dispatch[3] = {1, 1, 1};
+        benchmark_ex(vk->gpu, "dither_error_diffusion", bench_dither_ed,
+                     ed_dispatch);
+        benchmark_ex(vk->gpu, "dither_error_diffusion_sierra",
+                     bench_dither_ed_sierra, ed_dispatch);
+        pl_tex_destroy(vk->gpu, &ed_out);
+    }
+
     // HDR peak detection
-    if (vk->gpu->caps & PL_GPU_CAP_COMPUTE)
+    if (vk->gpu->caps & PL_GPU_CAP_COMPUTE) {
         benchmark(vk->gpu, "hdr_peakdetect", bench_hdr_peak);
+        benchmark_ex(vk->gpu, "hdr_peakdetect_stride4", bench_hdr_peak_stride,
+                     (const int[3]) {0});
+    }
 
     // Misc stuff
     benchmark(vk->gpu, "av1_grain", bench_av1_grain);
     benchmark(vk->gpu, "av1_grain_lap", bench_av1_grain_lap);
+    if (vk->gpu->caps & PL_GPU_CAP_COMPUTE)
+        benchmark(vk->gpu, "av1_grain_gpu", bench_av1_grain_gpu);
+
+    // CPU overhead of the renderer (small target to keep the GPU out of it)
+    bench_render(vk->gpu, "render_default", 256, 256, &pl_render_default_params);
+    bench_render(vk->gpu, "render_hq", 256, 256, &pl_render_high_quality_params);
+
+    // Anisotropic downscaling, where the order of the separable passes matters
+    bench_render(vk->gpu, "render_aniso_down", TEX_SIZE / 4, TEX_SIZE / 2,
+                 &pl_render_default_params);
+    bench_render(vk->gpu, "render_upscale", TEX_SIZE * 2, TEX_SIZE * 2,
+                 &pl_render_default_params);
+
+    // Large downscales (e.g. thumbnails), with and without the pyramid
+    struct pl_render_params pyramid_params = pl_render_high_quality_params;
+    bench_render(vk->gpu, "render_thumbnail", TEX_SIZE / 16, TEX_SIZE / 16,
+                 &pyramid_params);
+    pyramid_params.downscale_pyramid_ratio = 2.0;
+    bench_render(vk->gpu, "render_thumbnail_pyramid", TEX_SIZE / 16,
+                 TEX_SIZE / 16, &pyramid_params);
 
     pl_vulkan_destroy(&vk);
     pl_context_destroy(&ctx);
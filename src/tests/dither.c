@@ -4,6 +4,11 @@
 #define SIZE (1 << SHIFT)
 float data[SIZE][SIZE];
 
+#define MAX_SIZE 256
+float big[MAX_SIZE * MAX_SIZE];
+float cached[MAX_SIZE * MAX_SIZE];
+bool seen[MAX_SIZE * MAX_SIZE];
+
 int main()
 {
     printf("Ordered dither matrix:\n");
@@ -22,6 +27,24 @@ int main()
         printf("\n");
     }
 
+    // Test the full-size matrices, which must contain every rank exactly
+    // once, and repeated calls must hit the cache and return the same matrix
+    static const int sizes[] = { 64, 256 };
+    for (int i = 0; i < PL_ARRAY_SIZE(sizes); i++) {
+        const int size = sizes[i];
+        pl_generate_blue_noise(big, size);
+        memset(seen, 0, size * size * sizeof(bool));
+        for (int n = 0; n < size * size; n++) {
+            int rank = big[n] * size * size;
+            REQUIRE(rank >= 0 && rank < size * size);
+            REQUIRE(!seen[rank]);
+            seen[rank] = true;
+        }
+
+        pl_generate_blue_noise(cached, size);
+        REQUIRE(memcmp(big, cached, size * size * sizeof(float)) == 0);
+    }
+
     // Generate an example of a dither shader
     struct pl_context *ctx = pl_test_context();
     struct pl_shader *sh = pl_shader_alloc(ctx, NULL);
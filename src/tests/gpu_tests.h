@@ -1,5 +1,11 @@
 #include "tests.h"
 #include "shaders.h"
+#include "dispatch.h"
+
+#ifdef PL_HAVE_LCMS
+#include <lcms2.h>
+#include "lcms.h"
+#endif
 
 static uint8_t test_src[16*16*16 * 4 * sizeof(double)] = {0};
 static uint8_t test_dst[16*16*16 * 4 * sizeof(double)] = {0};
@@ -211,6 +217,12 @@ static void pl_texture_tests(const struct pl_gpu *gpu)
     }
 }
 
+// Emulates a roundtrip through packSnorm4x8/unpackSnorm4x8
+static float snorm8(float x)
+{
+    return roundf(PL_MAX(PL_MIN(x, 1.0), -1.0) * 127.0f) / 127.0f;
+}
+
 static void pl_shader_tests(const struct pl_gpu *gpu)
 {
     if (gpu->glsl.version < 410)
@@ -460,6 +472,42 @@ static void pl_shader_tests(const struct pl_gpu *gpu)
         TEST_FBO_PATTERN(1e-6, "deband iter %d", i);
     }
 
+    // Debanding a linear gradient should leave it untouched, since the
+    // averages are either exact or rejected by the threshold. This only holds
+    // for pixels whose samples all lie inside the texture, since clamped
+    // samples can shift the average by less than the threshold.
+    sh = pl_dispatch_begin(dp);
+    pl_shader_deband(sh,
+        &(struct pl_sample_src) {
+            .tex            = src,
+        },
+        &(struct pl_deband_params) {
+            .iterations     = 2,
+            .threshold      = 4.0,
+            .radius         = 2.0,
+            .no_compute     = !fbo->params.storable,
+    });
+
+    REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+        .shader = &sh,
+        .target = fbo,
+    }));
+
+    printf("testing pattern of deband gradient\n");
+    REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+        .tex = fbo,
+        .ptr = data,
+    }));
+
+    const int bound = 4; // iterations * radius
+    for (int y = bound; y < FBO_H - bound; y++) {
+        for (int x = bound; x < FBO_W - bound; x++) {
+            float *color = &data[(y * FBO_W + x) * 4];
+            REQUIRE(feq(color[0], (x + 0.5) / FBO_W, 1e-6));
+            REQUIRE(feq(color[1], (y + 0.5) / FBO_H, 1e-6));
+        }
+    }
+
     // Test peak detection and readback if possible
     sh = pl_dispatch_begin(dp);
     pl_shader_sample_direct(sh, &(struct pl_sample_src) { .tex = src });
@@ -497,6 +545,178 @@ static void pl_shader_tests(const struct pl_gpu *gpu)
     pl_dispatch_abort(dp, &sh);
     pl_shader_obj_destroy(&peak_state);
 
+    // Test subsampled peak detection in place
+    struct pl_peak_detect_params peak_params = pl_peak_detect_default_params;
+    peak_params.sample_stride = 2;
+    sh = pl_dispatch_begin(dp);
+    pl_shader_sample_direct(sh, &(struct pl_sample_src) { .tex = src });
+    if (pl_shader_detect_peak(sh, pl_color_space_monitor, &peak_state,
+                              &peak_params))
+    {
+        REQUIRE(pl_dispatch_compute(dp, &(struct pl_dispatch_compute_params) {
+            .shader = &sh,
+            .width = fbo->params.w,
+            .height = fbo->params.h,
+        }));
+
+        float peak, avg;
+        REQUIRE(pl_get_detected_peak(peak_state, &peak, &avg));
+
+        float real_peak = 0, real_avg = 0;
+        for (int y = 0; y < FBO_H; y += 2) {
+            for (int x = 0; x < FBO_W; x += 2) {
+                float *color = &data[(y * FBO_W + x) * 4];
+                float smax = powf(PL_MAX(color[0], color[1]), 2.2);
+                float slog = logf(PL_MAX(smax, 0.001));
+                real_peak = PL_MAX(smax, real_peak);
+                real_avg += slog;
+            }
+        }
+
+        real_peak *= 1.0 + pl_peak_detect_default_params.overshoot_margin;
+        real_avg = expf(real_avg / (FBO_W / 2 * FBO_H / 2));
+        REQUIRE(feq(peak, real_peak, 1e-4));
+        REQUIRE(feq(avg, real_avg, 1e-3));
+    }
+
+    pl_dispatch_abort(dp, &sh);
+    pl_shader_obj_destroy(&peak_state);
+
+    // Test subsampled peak detection of a cropped region as a standalone pass
+    const struct pl_rect2d peak_rect = { 2, 4, FBO_W, FBO_H - 1 };
+    sh = pl_dispatch_begin(dp);
+    if (pl_shader_detect_peak_tex(sh, src, &peak_rect, pl_color_space_monitor,
+                                  &peak_state, &peak_params))
+    {
+        int w = 0, h = 0;
+        REQUIRE(pl_shader_output_size(sh, &w, &h));
+        REQUIRE(w == 7 && h == 6);
+        REQUIRE(pl_dispatch_compute(dp, &(struct pl_dispatch_compute_params) {
+            .shader = &sh,
+            .width = w,
+            .height = h,
+        }));
+
+        float peak, avg;
+        REQUIRE(pl_get_detected_peak(peak_state, &peak, &avg));
+
+        float real_peak = 0, real_avg = 0;
+        for (int y = peak_rect.y0; y < peak_rect.y1; y += 2) {
+            for (int x = peak_rect.x0; x < peak_rect.x1; x += 2) {
+                float *color = &data[(y * FBO_W + x) * 4];
+                float smax = powf(PL_MAX(color[0], color[1]), 2.2);
+                float slog = logf(PL_MAX(smax, 0.001));
+                real_peak = PL_MAX(smax, real_peak);
+                real_avg += slog;
+            }
+        }
+
+        real_peak *= 1.0 + pl_peak_detect_default_params.overshoot_margin;
+        real_avg = expf(real_avg / (w * h));
+        REQUIRE(feq(peak, real_peak, 1e-4));
+        REQUIRE(feq(avg, real_avg, 1e-3));
+    }
+
+    pl_dispatch_abort(dp, &sh);
+    pl_shader_obj_destroy(&peak_state);
+
+    // Test percentile-based peak detection with asynchronous readback
+    peak_params = pl_peak_detect_default_params;
+    peak_params.percentile = 50.0;
+    for (int i = 0; i < 4; i++) {
+        sh = pl_dispatch_begin(dp);
+        if (!pl_shader_detect_peak_tex(sh, src, NULL, pl_color_space_monitor,
+                                       &peak_state, &peak_params))
+        {
+            pl_dispatch_abort(dp, &sh);
+            break;
+        }
+
+        int w = 0, h = 0;
+        REQUIRE(pl_shader_output_size(sh, &w, &h));
+        REQUIRE(pl_dispatch_compute(dp, &(struct pl_dispatch_compute_params) {
+            .shader = &sh,
+            .width = w,
+            .height = h,
+        }));
+
+        float peak, avg;
+        if (pl_poll_detected_peak(peak_state, &peak, &avg))
+            REQUIRE(peak > 0);
+        pl_gpu_finish(gpu);
+    }
+
+    if (peak_state) {
+        // The median of this test pattern (~0.47) is well below the
+        // maximum (~0.93), even after quantization and overshoot margin
+        float peak, avg;
+        REQUIRE(pl_poll_detected_peak(peak_state, &peak, &avg));
+        printf("detected median: %f\n", peak);
+        REQUIRE(peak > 0.4 && peak < 0.75);
+    }
+
+    pl_shader_obj_destroy(&peak_state);
+
+    // Test error diffusion, which should preserve the average brightness
+    sh = pl_dispatch_begin(dp);
+    bool diffused = fbo->params.storable &&
+        pl_shader_error_diffusion(sh, &(struct pl_error_diffusion_params) {
+            .input_tex  = src,
+            .output_tex = fbo,
+            .new_depth  = 1,
+        });
+
+    if (diffused) {
+        REQUIRE(pl_dispatch_compute(dp, &(struct pl_dispatch_compute_params) {
+            .shader = &sh,
+            .dispatch_size = {1, 1, 1},
+        }));
+
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex = fbo,
+            .ptr = data,
+        }));
+
+        // Compare against a sequential implementation of Floyd-Steinberg,
+        // including the snorm8 quantization of the errors diffused into the
+        // next row (the error carried to the right is kept as-is)
+        const struct pl_error_diffusion_kernel *k;
+        k = &pl_error_diffusion_floyd_steinberg;
+        const float div = k->divisor;
+        static float row_err[FBO_H][FBO_W];
+        float sum[2] = {0};
+        for (int c = 0; c < 2; c++) {
+            memset(row_err, 0, sizeof(row_err));
+            for (int y = 0; y < FBO_H; y++) {
+                float carry = 0.0;
+                for (int x = 0; x < FBO_W; x++) {
+                    float v = c == 0 ? (x + 0.5) / FBO_W : (y + 0.5) / FBO_H;
+                    v += row_err[y][x] + carry;
+                    float q = PL_MIN(PL_MAX(floorf(v + 0.5f), 0.0), 1.0);
+                    float e = v - q;
+                    REQUIRE(data[(y * FBO_W + x) * 4 + c] == q);
+                    sum[c] += q;
+
+                    carry = e * (k->right / div);
+                    if (y + 1 == FBO_H)
+                        continue;
+
+                    float *next = row_err[y + 1];
+                    if (x > 0)
+                        next[x - 1] = snorm8(next[x - 1] + e * (k->below_left / div));
+                    next[x] = snorm8(next[x] + e * (k->below / div));
+                    if (x + 1 < FBO_W)
+                        next[x + 1] = snorm8(next[x + 1] + e * (k->below_right / div));
+                }
+            }
+        }
+
+        printf("error diffusion averages: %f %f\n", sum[0] / (FBO_W * FBO_H),
+               sum[1] / (FBO_W * FBO_H));
+    }
+
+    pl_dispatch_abort(dp, &sh);
+
 #ifdef PL_HAVE_LCMS
     // Test the use of 3DLUTs if available
     sh = pl_dispatch_begin(dp);
@@ -517,6 +737,66 @@ static void pl_shader_tests(const struct pl_gpu *gpu)
 
     pl_dispatch_abort(dp, &sh);
     pl_shader_obj_destroy(&lut3d);
+
+    // Compare the 3DLUT generated on the GPU (for matrix/TRC profiles) against
+    // the one computed by LittleCMS, by sampling it exactly at the grid points
+    // of a 6x6x6 LUT. The tolerance covers the fp16 storage and the
+    // interpolation of the inverse output curves.
+    const int lut_size = 6;
+    pl_assert(lut_size * lut_size * lut_size <= FBO_W * FBO_H);
+    static float grid[FBO_W * FBO_H * 4], lcms_lut[FBO_W * FBO_H * 4];
+    memset(grid, 0, sizeof(grid));
+    for (int i = 0; i < lut_size * lut_size * lut_size; i++) {
+        grid[i * 4 + 0] = (i % lut_size) / (lut_size - 1.0);
+        grid[i * 4 + 1] = (i / lut_size % lut_size) / (lut_size - 1.0);
+        grid[i * 4 + 2] = (i / lut_size / lut_size) / (lut_size - 1.0);
+        grid[i * 4 + 3] = 1.0;
+    }
+
+    const struct pl_tex *grid_tex = pl_tex_create(gpu, &(struct pl_tex_params) {
+        .format         = fbo_fmt,
+        .w              = FBO_W,
+        .h              = FBO_H,
+        .sampleable     = true,
+        .initial_data   = grid,
+    });
+    REQUIRE(grid_tex);
+
+    src_color.color = (struct pl_color_space) {
+        .primaries = PL_COLOR_PRIM_BT_2020,
+        .transfer = PL_COLOR_TRC_GAMMA22,
+    };
+    dst_color.color = pl_color_space_srgb;
+    struct pl_3dlut_params lut_params = pl_3dlut_default_params;
+    lut_params.size_r = lut_params.size_g = lut_params.size_b = lut_size;
+
+    sh = pl_dispatch_begin(dp);
+    pl_shader_sample_direct(sh, &(struct pl_sample_src) { .tex = grid_tex });
+    if (pl_3dlut_update(sh, &src_color, &dst_color, &lut3d, &out, &lut_params)) {
+        pl_3dlut_apply(sh, &lut3d);
+        REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+            .shader = &sh,
+            .target = fbo,
+        }));
+
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex = fbo,
+            .ptr = data,
+        }));
+
+        REQUIRE(pl_lcms_compute_lut(gpu->ctx, lut_params.intent, src_color,
+                                    dst_color, lcms_lut, lut_size, lut_size,
+                                    lut_size, &out));
+
+        for (int i = 0; i < lut_size * lut_size * lut_size; i++) {
+            for (int c = 0; c < 3; c++)
+                REQUIRE(feq(data[i * 4 + c], lcms_lut[i * 4 + c], 5e-3));
+        }
+    }
+
+    pl_dispatch_abort(dp, &sh);
+    pl_shader_obj_destroy(&lut3d);
+    pl_tex_destroy(gpu, &grid_tex);
 #endif
 
     // Test AV1 grain synthesis
@@ -545,6 +825,98 @@ static void pl_shader_tests(const struct pl_gpu *gpu)
     }
     pl_shader_obj_destroy(&grain);
 
+    // Test that generating the grain on the GPU matches the CPU
+    static float grain_ref[FBO_H * FBO_W * 4];
+    for (int i = 0; i < 2; i++) {
+        struct pl_av1_grain_params grain_params = {
+            .data = av1_grain_data,
+            .tex = src,
+            .components = 3,
+            .component_mapping = { 0, 1, 2 },
+            .repr = &(struct pl_color_repr) {
+                .sys = PL_COLOR_SYSTEM_BT_709,
+                .levels = PL_COLOR_LEVELS_TV,
+                .bits = { .color_depth = 10, .sample_depth = 10 },
+            },
+            .gpu_generate = !!i,
+        };
+
+        sh = pl_dispatch_begin(dp);
+        pl_shader_av1_grain(sh, &grain, &grain_params);
+        REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+            .shader = &sh,
+            .target = fbo,
+        }));
+        pl_shader_obj_destroy(&grain);
+
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex = fbo,
+            .ptr = i ? data : grain_ref,
+        }));
+    }
+
+    for (int i = 0; i < FBO_W * FBO_H * 4; i++)
+        REQUIRE(feq(data[i], grain_ref[i], 1e-3));
+
+    // Test that memoized shader builders reproduce the same shader as a
+    // shader built from scratch (without memoization)
+    uint64_t memo_sig[3];
+    for (int i = 0; i < 3; i++) {
+        struct pl_shader *ref = pl_shader_alloc(gpu->ctx, &(struct pl_shader_params) {
+            .gpu = gpu,
+        });
+
+        struct pl_shader *shs[2] = { pl_dispatch_begin(dp), ref };
+        const struct pl_shader_res *res[2];
+        for (int n = 0; n < 2; n++) {
+            struct pl_color_repr repr = {
+                .sys = i < 2 ? PL_COLOR_SYSTEM_BT_709 : PL_COLOR_SYSTEM_BT_601,
+                .levels = PL_COLOR_LEVELS_TV,
+            };
+
+            pl_shader_decode_color(shs[n], &repr, NULL);
+            REQUIRE(repr.sys == PL_COLOR_SYSTEM_RGB);
+            pl_shader_color_map(shs[n], NULL, pl_color_space_bt2020_hlg,
+                                pl_color_space_srgb, NULL, false);
+            if (!n)
+                memo_sig[i] = pl_shader_signature(shs[n]);
+            res[n] = pl_shader_finalize(shs[n]);
+            REQUIRE(res[n]);
+        }
+
+        REQUIRE(strcmp(res[0]->glsl, res[1]->glsl) == 0);
+        REQUIRE(res[0]->num_variables == res[1]->num_variables);
+        REQUIRE(res[0]->num_descriptors == res[1]->num_descriptors);
+
+        pl_dispatch_abort(dp, &shs[0]);
+        pl_shader_free(&ref);
+    }
+
+    REQUIRE(memo_sig[0] == memo_sig[1]);
+    REQUIRE(memo_sig[1] != memo_sig[2]);
+
+    // The output size of a (non-resizable) shader must not affect its
+    // signature, so that it can re-use the same pass for every size
+    uint64_t size_sig[2];
+    for (int i = 0; i < 2; i++) {
+        const struct pl_tex *tex = pl_tex_create(gpu, &(struct pl_tex_params) {
+            .format         = fbo_fmt,
+            .w              = 100 + 50 * i,
+            .h              = 100 + 50 * i,
+            .sampleable     = true,
+            .sample_mode    = PL_TEX_SAMPLE_LINEAR,
+        });
+        REQUIRE(tex);
+
+        sh = pl_dispatch_begin(dp);
+        pl_shader_deband(sh, &(struct pl_sample_src) { .tex = tex }, NULL);
+        size_sig[i] = pl_shader_signature(sh);
+        pl_dispatch_abort(dp, &sh);
+        pl_tex_destroy(gpu, &tex);
+    }
+
+    REQUIRE(size_sig[0] == size_sig[1]);
+
     pl_dispatch_destroy(&dp);
     pl_tex_destroy(gpu, &src);
     pl_tex_destroy(gpu, &fbo);
@@ -561,6 +933,7 @@ static void pl_scaler_tests(const struct pl_gpu *gpu)
         return;
 
     float *fbo_data = NULL;
+    const struct pl_tex *sep = NULL, *aniso = NULL;
     struct pl_shader_obj *lut = NULL;
 
     static float data_5x5[5][5] = {
@@ -637,10 +1010,219 @@ static void pl_scaler_tests(const struct pl_gpu *gpu)
         }
     }
 
+    // Test that single-pass separated sampling matches two separate passes
+    const struct pl_fmt *sep_fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 16, 32,
+                                               PL_FMT_CAP_RENDERABLE |
+                                               PL_FMT_CAP_LINEAR);
+    if (sep_fmt && fbo->params.host_readable && fbo->params.storable) {
+        sep = pl_tex_create(gpu, &(struct pl_tex_params) {
+            .w              = dot5x5->params.w,
+            .h              = fbo->params.h,
+            .format         = sep_fmt,
+            .renderable     = true,
+            .sampleable     = true,
+            .sample_mode    = PL_TEX_SAMPLE_LINEAR,
+        });
+        REQUIRE(sep);
+    }
+
+    sh = pl_dispatch_begin(dp);
+    struct pl_sample_src src = {
+        .tex        = dot5x5,
+        .new_w      = fbo->params.w,
+        .new_h      = fbo->params.h,
+    };
+    struct pl_sample_filter_params fparams = {
+        .filter     = pl_filter_spline36,
+        .antiring   = 0.5,
+        .lut        = &lut,
+    };
+
+    if (sep && pl_shader_sample_ortho2(sh, &src, &fparams)) {
+        float *ref = malloc(fbo->params.w * fbo->params.h * sizeof(float));
+        float *out = malloc(fbo->params.w * fbo->params.h * sizeof(float));
+        REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+            .shader = &sh,
+            .target = fbo,
+        }));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = out,
+        }));
+
+        sh = pl_dispatch_begin(dp);
+        REQUIRE(pl_shader_sample_ortho(sh, PL_SEP_VERT, &src, &fparams));
+        REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+            .shader = &sh,
+            .target = sep,
+        }));
+
+        struct pl_sample_src src2 = src;
+        src2.tex = sep;
+        sh = pl_dispatch_begin(dp);
+        REQUIRE(pl_shader_sample_ortho(sh, PL_SEP_HORIZ, &src2, &fparams));
+        REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+            .shader = &sh,
+            .target = fbo,
+        }));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = ref,
+        }));
+
+        for (int i = 0; i < fbo->params.w * fbo->params.h; i++)
+            REQUIRE(feq(out[i], ref[i], 1e-2));
+
+        free(ref);
+        free(out);
+    } else {
+        pl_dispatch_abort(dp, &sh);
+    }
+
+    // Test that the fast paths of separated sampling are approximately
+    // equivalent to the regular path. The reference is shifted by a tiny
+    // offset, which forces the use of the LUT instead of fixed-ratio weights.
+    // The tap merging and half precision paths are tested both with the LUT
+    // and with fixed-ratio weights.
+    if (fbo->params.host_readable) {
+        float *ref = malloc(fbo->params.w * fbo->params.h * sizeof(float));
+        float *out = malloc(fbo->params.w * fbo->params.h * sizeof(float));
+        fparams.filter = pl_filter_mitchell;
+
+        for (int i = 0; i < 6; i++) {
+            struct pl_sample_src vsrc = {
+                .tex    = dot5x5,
+                .rect   = {0, 0, dot5x5->params.w, fbo->params.h / 2},
+                .new_h  = fbo->params.h,
+            };
+
+            // Without the shift, 2x scaling uses fixed-ratio weights
+            if (i == 0 || i >= 4) {
+                vsrc.rect.y0 += 1e-3;
+                vsrc.rect.y1 += 1e-3;
+            }
+
+            fparams.merge_taps = i == 2 || i == 4;
+            pl_dispatch_set_half_precision(dp, i == 3 || i == 5);
+
+            sh = pl_dispatch_begin(dp);
+            REQUIRE(pl_shader_sample_ortho(sh, PL_SEP_VERT, &vsrc, &fparams));
+            REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+                .shader = &sh,
+                .target = fbo,
+                .rect   = {0, 0, dot5x5->params.w, fbo->params.h},
+            }));
+            REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+                .tex            = fbo,
+                .ptr            = i ? out : ref,
+            }));
+
+            fparams.merge_taps = false;
+            pl_dispatch_set_half_precision(dp, false);
+            for (int n = 0; i && n < fbo->params.w * fbo->params.h; n++)
+                REQUIRE(feq(out[n], ref[n], 1e-2));
+        }
+
+        // Also test the fixed-ratio weights against the LUT for left-sited
+        // 4:2:0 chroma (offset by 1/4 texel) and for a ratio-1 pass, where
+        // the sampled positions fall exactly on texel boundaries
+        static const struct { float y0, h; } cases[] = {
+            { 0.25, 50 }, { 0.0, 100 }, { 0.5, 100 },
+        };
+
+        for (int c = 0; c < PL_ARRAY_SIZE(cases); c++) {
+            for (int i = 0; i < 2; i++) {
+                float y0 = cases[c].y0 + (i ? 0.0 : 1e-3);
+                struct pl_sample_src vsrc = {
+                    .tex    = dot5x5,
+                    .rect   = {0, y0, dot5x5->params.w, y0 + cases[c].h},
+                    .new_h  = fbo->params.h,
+                };
+
+                sh = pl_dispatch_begin(dp);
+                REQUIRE(pl_shader_sample_ortho(sh, PL_SEP_VERT, &vsrc, &fparams));
+                REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+                    .shader = &sh,
+                    .target = fbo,
+                    .rect   = {0, 0, dot5x5->params.w, fbo->params.h},
+                }));
+                REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+                    .tex            = fbo,
+                    .ptr            = i ? out : ref,
+                }));
+            }
+
+            for (int n = 0; n < fbo->params.w * fbo->params.h; n++)
+                REQUIRE(feq(out[n], ref[n], 1e-2));
+        }
+
+        free(ref);
+        free(out);
+    }
+
+    // Test that both orders of the separated passes agree, for the kind of
+    // anisotropic scaling where the renderer runs the horizontal pass first
+    if (sep_fmt && fbo->params.host_readable) {
+        int num = fbo->params.w * fbo->params.h;
+        float *out[2] = { malloc(num * sizeof(float)), malloc(num * sizeof(float)) };
+        fparams.filter = pl_filter_spline36;
+        fparams.antiring = 0.0; // not separable, so it depends on the order
+
+        for (int i = 0; i < 2; i++) {
+            struct pl_sample_src asrc = {
+                .tex    = dot5x5,
+                .new_w  = i ? fbo->params.w : 3,
+                .new_h  = i ? 3 : fbo->params.h,
+            };
+
+            for (int horiz = 0; horiz < 2; horiz++) {
+                REQUIRE(pl_tex_recreate(gpu, &aniso, &(struct pl_tex_params) {
+                    .w              = horiz ? asrc.new_w : dot5x5->params.w,
+                    .h              = horiz ? dot5x5->params.h : asrc.new_h,
+                    .format         = sep_fmt,
+                    .renderable     = true,
+                    .sampleable     = true,
+                    .sample_mode    = PL_TEX_SAMPLE_LINEAR,
+                }));
+
+                sh = pl_dispatch_begin(dp);
+                REQUIRE(pl_shader_sample_ortho(sh, horiz ? PL_SEP_HORIZ : PL_SEP_VERT,
+                                               &asrc, &fparams));
+                REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+                    .shader = &sh,
+                    .target = aniso,
+                }));
+
+                struct pl_sample_src asrc2 = asrc;
+                asrc2.tex = aniso;
+                sh = pl_dispatch_begin(dp);
+                REQUIRE(pl_shader_sample_ortho(sh, horiz ? PL_SEP_VERT : PL_SEP_HORIZ,
+                                               &asrc2, &fparams));
+                REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+                    .shader = &sh,
+                    .target = fbo,
+                    .rect   = {0, 0, asrc.new_w, asrc.new_h},
+                }));
+                REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+                    .tex            = fbo,
+                    .ptr            = out[horiz],
+                }));
+            }
+
+            for (int n = 0; n < num; n++)
+                REQUIRE(feq(out[0][n], out[1][n], 1e-2));
+        }
+
+        free(out[0]);
+        free(out[1]);
+    }
+
 error:
     free(fbo_data);
     pl_shader_obj_destroy(&lut);
     pl_dispatch_destroy(&dp);
+    pl_tex_destroy(gpu, &sep);
+    pl_tex_destroy(gpu, &aniso);
     pl_tex_destroy(gpu, &dot5x5);
     pl_tex_destroy(gpu, &fbo);
 }
@@ -702,7 +1284,8 @@ static void pl_render_tests(const struct pl_gpu *gpu)
     if (!fbo_fmt)
         return;
 
-    float *fbo_data = NULL;
+    float *fbo_data = NULL, *ref_data = NULL;
+    const struct pl_tex *grad_tex = NULL, *chroma_tex = NULL;
     static float data_5x5[5][5] = {
         { 0.0, 0.0, 0.0, 0.0, 0.0 },
         { 0.0, 0.0, 0.0, 0.0, 0.0 },
@@ -804,12 +1387,342 @@ static void pl_render_tests(const struct pl_gpu *gpu)
         pl_gpu_flush(gpu);
     }
 
+    // Test anisotropic scaling, which changes the order of separable passes.
+    // (That both orders agree is tested by pl_scaler_tests)
+    for (int i = 0; i < 2; i++) {
+        struct pl_render_target aniso = target;
+        aniso.dst_rect = i ? (struct pl_rect2df) {0, 0, 3, fbo->params.h}
+                           : (struct pl_rect2df) {0, 0, fbo->params.w, 3};
+        REQUIRE(pl_render_image(rr, &image, &aniso, NULL));
+        pl_gpu_flush(gpu);
+    }
+
+    // Test large downscales, which go through the downscale pyramid
+    struct pl_render_params pyramid_params = pl_render_default_params;
+    pyramid_params.downscale_pyramid_ratio = 2.0;
+    struct pl_render_target thumb = target;
+    thumb.dst_rect = (struct pl_rect2df) {0, 0, 1, 2};
+    REQUIRE(pl_render_image(rr, &image, &thumb, &pyramid_params));
+    pl_gpu_flush(gpu);
+
+    // Both the box filter and the default downscaler preserve linear
+    // gradients, so the pyramid should not change the result of downscaling
+    // one, except near the edges
+    static float data_grad[64][64];
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 64; x++)
+            data_grad[y][x] = (x + y) / 126.0;
+    }
+
+    struct pl_plane grad = {0};
+    REQUIRE(pl_upload_plane(gpu, &grad, &grad_tex, &(struct pl_plane_data) {
+        .type = PL_FMT_FLOAT,
+        .width = 64,
+        .height = 64,
+        .component_size = { 8 * sizeof(float) },
+        .component_map  = { 0 },
+        .pixel_stride = sizeof(float),
+        .pixels = &data_grad,
+    }));
+
+    ref_data = malloc(fbo->params.w * fbo->params.h * sizeof(float[4]));
+    REQUIRE(ref_data);
+
+    struct pl_image grad_img = image;
+    grad_img.planes[0] = grad;
+    grad_img.src_rect = (struct pl_rect2df) {0, 0, 64, 64};
+    thumb.dst_rect = (struct pl_rect2df) {0, 0, 8, 8};
+    pyramid_params.disable_linear_scaling = true;
+    for (int i = 0; i < 2; i++) {
+        pyramid_params.downscale_pyramid_ratio = i ? 2.0 : 0.0;
+        REQUIRE(pl_render_image(rr, &grad_img, &thumb, &pyramid_params));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = i ? fbo_data : ref_data,
+        }));
+    }
+
+    for (int y = 2; y < 6; y++) {
+        for (int x = 2; x < 6; x++) {
+            int idx = (y * fbo->params.w + x) * 4;
+            for (int c = 0; c < 4; c++)
+                REQUIRE(feq(fbo_data[idx + c], ref_data[idx + c], 1e-2));
+        }
+    }
+
+    // Test subsampled chroma, scaled straight to the output size. The chroma
+    // plane is a horizontal gradient, which both ways of scaling it preserve,
+    // so the results should agree except near the edges
+    static float data_chroma[16][16];
+    for (int y = 0; y < 16; y++) {
+        for (int x = 0; x < 16; x++)
+            data_chroma[y][x] = 0.25 + 0.5 * x / 15.0;
+    }
+
+    struct pl_plane chroma = {0};
+    REQUIRE(pl_upload_plane(gpu, &chroma, &chroma_tex, &(struct pl_plane_data) {
+        .type = PL_FMT_FLOAT,
+        .width = 16,
+        .height = 16,
+        .component_size = { 8 * sizeof(float) },
+        .component_map  = { 0 },
+        .pixel_stride = sizeof(float),
+        .pixels = &data_chroma,
+    }));
+
+    const struct pl_tex *luma_tex = pl_tex_create(gpu, &(struct pl_tex_params) {
+        .w              = 32,
+        .h              = 32,
+        .format         = chroma.texture->params.format,
+        .sampleable     = true,
+        .blit_dst       = true,
+    });
+
+    if (luma_tex) {
+        pl_tex_clear(gpu, luma_tex, (float[4]){0.5});
+        struct pl_image yuv = image;
+        yuv.num_planes = 2;
+        yuv.planes[0] = (struct pl_plane) {
+            .texture            = luma_tex,
+            .components         = 1,
+            .component_mapping  = { PL_CHANNEL_Y },
+        };
+        yuv.planes[1] = chroma;
+        yuv.planes[1].component_mapping[0] = PL_CHANNEL_CB;
+        yuv.src_rect = (struct pl_rect2df) {0, 0, 32, 32};
+        yuv.color = target.color;
+
+        struct pl_render_params direct_params = pl_render_default_params;
+        direct_params.sigmoid_params = NULL;
+        for (int i = 0; i < 2; i++) {
+            direct_params.direct_chroma_scaling = i;
+            REQUIRE(pl_render_image(rr, &yuv, &target, &direct_params));
+            REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+                .tex            = fbo,
+                .ptr            = i ? fbo_data : ref_data,
+            }));
+        }
+
+        // One chroma texel covers about 2 output pixels, and spline36 has
+        // a radius of 3 texels
+        for (int y = 10; y < fbo->params.h - 10; y++) {
+            for (int x = 10; x < fbo->params.w - 10; x++) {
+                int idx = (y * fbo->params.w + x) * 4;
+                for (int c = 0; c < 4; c++)
+                    REQUIRE(feq(fbo_data[idx + c], ref_data[idx + c], 1e-2));
+            }
+        }
+
+        direct_params.disable_linear_scaling = true;
+        REQUIRE(pl_render_image(rr, &yuv, &thumb, &direct_params));
+        pl_gpu_flush(gpu);
+        pl_tex_destroy(gpu, &luma_tex);
+    }
+
+    // Test unscaled RGB images, which can be passed through using a blit
+    const struct pl_tex *rgb_tex = pl_tex_create(gpu, &(struct pl_tex_params) {
+        .w              = width,
+        .h              = height,
+        .format         = fbo_fmt,
+        .sampleable     = true,
+        .blit_src       = true,
+        .blit_dst       = true,
+    });
+
+    if (rgb_tex) {
+        static const float rgb_color[4] = { 0.25, 0.5, 0.75, 1.0 };
+        pl_tex_clear(gpu, rgb_tex, rgb_color);
+        pl_tex_clear(gpu, fbo, (float[4]){0});
+
+        struct pl_image rgb = {
+            .num_planes     = 1,
+            .planes         = {{
+                .texture            = rgb_tex,
+                .components         = 4,
+                .component_mapping  = { 0, 1, 2, 3 },
+            }},
+            .repr           = target.repr,
+            .color          = target.color,
+        };
+
+        struct pl_render_target rgb_target = target;
+        rgb_target.dst_rect = (struct pl_rect2df) {2, 2, 2 + width, 2 + height};
+        REQUIRE(pl_render_image(rr, &rgb, &rgb_target, NULL));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = fbo_data,
+        }));
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const float *px = &fbo_data[((y + 2) * fbo->params.w + x + 2) * 4];
+                for (int c = 0; c < 4; c++)
+                    REQUIRE(feq(px[c], rgb_color[c], 1e-6));
+            }
+        }
+
+#ifdef PL_HAVE_LCMS
+        // Profiles have to be applied, so this can't be passed through. Tag
+        // the target as BT.2020, which changes the result
+        cmsToneCurve *trc = cmsBuildGamma(NULL, 2.2);
+        const struct pl_raw_primaries *bt2020 =
+            pl_raw_primaries_get(PL_COLOR_PRIM_BT_2020);
+        cmsHPROFILE prof = cmsCreateRGBProfile(
+            &(cmsCIExyY) { bt2020->white.x, bt2020->white.y, 1.0 },
+            &(cmsCIExyYTRIPLE) {
+                .Red   = { bt2020->red.x,   bt2020->red.y,   1.0 },
+                .Green = { bt2020->green.x, bt2020->green.y, 1.0 },
+                .Blue  = { bt2020->blue.x,  bt2020->blue.y,  1.0 },
+            },
+            (cmsToneCurve *[3]) { trc, trc, trc });
+        cmsFreeToneCurve(trc);
+        REQUIRE(prof);
+
+        cmsUInt32Number icc_size = 0;
+        REQUIRE(cmsSaveProfileToMem(prof, NULL, &icc_size));
+        void *icc = malloc(icc_size);
+        REQUIRE(icc && cmsSaveProfileToMem(prof, icc, &icc_size));
+        cmsCloseProfile(prof);
+
+        rgb_target.profile = (struct pl_icc_profile) {
+            .data       = icc,
+            .len        = icc_size,
+            .signature  = (uintptr_t) icc,
+        };
+
+        pl_tex_clear(gpu, fbo, (float[4]){0});
+        REQUIRE(pl_render_image(rr, &rgb, &rgb_target, NULL));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = fbo_data,
+        }));
+
+        const float *px = &fbo_data[(2 * fbo->params.w + 2) * 4];
+        REQUIRE(!feq(px[0], rgb_color[0], 1e-2) ||
+                !feq(px[1], rgb_color[1], 1e-2) ||
+                !feq(px[2], rgb_color[2], 1e-2));
+        free(icc);
+#endif
+
+        pl_tex_destroy(gpu, &rgb_tex);
+    }
+
+    // Test re-rendering only a damaged region, which should reproduce the
+    // corresponding part of the full rendering and leave the rest untouched.
+    // Crop the image, so the texels outside of the src_rect must be ignored
+    static float data_16x16[16][16];
+    for (int y = 0; y < 16; y++) {
+        for (int x = 0; x < 16; x++)
+            data_16x16[y][x] = ((x * y) % 7) / 7.0;
+    }
+
+    struct pl_plane img16 = {0};
+    const struct pl_tex *img16_tex = NULL;
+    ok = pl_upload_plane(gpu, &img16, &img16_tex, &(struct pl_plane_data) {
+        .type = PL_FMT_FLOAT,
+        .width = 16,
+        .height = 16,
+        .component_size = { 8 * sizeof(float) },
+        .component_map  = { 0 },
+        .pixel_stride = sizeof(float),
+        .pixels = &data_16x16,
+    });
+
+    if (ok) {
+        struct pl_image damaged = image;
+        damaged.planes[0] = img16;
+        damaged.src_rect = (struct pl_rect2df) {1.5, 2, 13.5, 14};
+
+        pl_tex_clear(gpu, fbo, (float[4]){0});
+        REQUIRE(pl_render_image(rr, &damaged, &target, NULL));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = fbo_data,
+        }));
+
+        int num_px = fbo->params.w * fbo->params.h;
+        float *fbo_data2 = malloc(num_px * sizeof(float[4]));
+        REQUIRE(fbo_data2);
+
+        damaged.damage_rects = &(struct pl_rect2d) {7, 7, 8, 8};
+        damaged.num_damage_rects = 1;
+        pl_tex_clear(gpu, fbo, (float[4]){0});
+        REQUIRE(pl_render_image(rr, &damaged, &target, NULL));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = fbo_data2,
+        }));
+
+        int rendered = 0;
+        for (int i = 0; i < num_px; i++) {
+            if (!fbo_data2[i * 4 + 3])
+                continue; // untouched
+            for (int c = 0; c < 4; c++)
+                REQUIRE(feq(fbo_data2[i * 4 + c], fbo_data[i * 4 + c], 1e-3));
+            rendered++;
+        }
+
+        // The pixel corresponding to the damaged texel must be included
+        REQUIRE(fbo_data2[(19 * fbo->params.w + 19) * 4 + 3]);
+        REQUIRE(rendered < 36 * 36);
+
+        // Overlapping damage rects must give the same result
+        struct pl_rect2d overlapping[] = {
+            {7, 7, 8, 8}, {6, 7, 9, 8}, {7, 6, 8, 9},
+        };
+        damaged.damage_rects = overlapping;
+        damaged.num_damage_rects = PL_ARRAY_SIZE(overlapping);
+        pl_tex_clear(gpu, fbo, (float[4]){0});
+        REQUIRE(pl_render_image(rr, &damaged, &target, NULL));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = fbo_data2,
+        }));
+
+        rendered = 0;
+        for (int i = 0; i < num_px; i++) {
+            if (!fbo_data2[i * 4 + 3])
+                continue;
+            for (int c = 0; c < 4; c++)
+                REQUIRE(feq(fbo_data2[i * 4 + c], fbo_data[i * 4 + c], 1e-3));
+            rendered++;
+        }
+        REQUIRE(fbo_data2[(19 * fbo->params.w + 19) * 4 + 3]);
+        REQUIRE(rendered < 36 * 36);
+
+        // Debanding can't be re-rendered partially, so this must fall back
+        // to rendering the whole image
+        struct pl_render_params deband_params = pl_render_default_params;
+        deband_params.deband_params = &pl_deband_default_params;
+        pl_tex_clear(gpu, fbo, (float[4]){0});
+        REQUIRE(pl_render_image(rr, &damaged, &target, &deband_params));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = fbo_data2,
+        }));
+
+        rendered = 0;
+        for (int i = 0; i < num_px; i++)
+            rendered += !!fbo_data2[i * 4 + 3];
+        REQUIRE(rendered == 36 * 36);
+        free(fbo_data2);
+    }
+
+    pl_tex_destroy(gpu, &img16_tex);
+
     TEST_PARAMS(deband, iterations, 3);
     TEST_PARAMS(sigmoid, center, 1);
     TEST_PARAMS(color_map, intent, PL_INTENT_ABSOLUTE_COLORIMETRIC);
     TEST_PARAMS(color_map, gamut_warning, 1);
     TEST_PARAMS(dither, method, PL_DITHER_WHITE_NOISE);
     TEST_PARAMS(dither, temporal, true);
+
+    struct pl_dither_params ed_params = pl_dither_default_params;
+    ed_params.error_diffusion = &pl_error_diffusion_sierra_lite;
+    struct pl_render_params ed_rparams = pl_render_default_params;
+    ed_rparams.dither_params = &ed_params;
+    ed_rparams.force_dither = true;
+    REQUIRE(pl_render_image(rr, &image, &target, &ed_rparams));
     TEST(cone_params, pl_cone_params, pl_vision_deuteranomaly, strength, 0);
 
     // Test HDR stuff
@@ -817,6 +1730,111 @@ static void pl_render_tests(const struct pl_gpu *gpu)
     target.color.sig_scale = 2.0;
     TEST_PARAMS(color_map, tone_mapping_algo, PL_TONE_MAPPING_BT_2390);
     TEST_PARAMS(color_map, desaturation_strength, 1);
+
+    // Test that the tone mapping LUT matches the direct evaluation
+    float *lut_data = malloc(fbo->params.w * fbo->params.h * sizeof(float[4]));
+    for (int algo = 0; algo <= PL_TONE_MAPPING_BT_2390; algo++) {
+        struct pl_color_map_params cparams = pl_color_map_default_params;
+        struct pl_render_params params = pl_render_default_params;
+        params.color_map_params = &cparams;
+        params.peak_detect_params = NULL;
+        cparams.tone_mapping_algo = algo;
+
+        REQUIRE(pl_render_image(rr, &image, &target, &params));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = fbo_data,
+        }));
+
+        cparams.tone_mapping_lut_size = 256;
+        REQUIRE(pl_render_image(rr, &image, &target, &params));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex            = fbo,
+            .ptr            = lut_data,
+        }));
+
+        for (int i = 0; i < fbo->params.w * fbo->params.h * 4; i++)
+            REQUIRE(feq(fbo_data[i], lut_data[i], 1e-2));
+    }
+
+    // Test the tone mapping LUT with peak detection, which only takes effect
+    // once the detected values have been read back
+    pl_renderer_flush_cache(rr);
+    struct pl_color_map_params dyn_cparams = pl_color_map_default_params;
+    struct pl_render_params dyn_params = pl_render_default_params;
+    dyn_params.color_map_params = &dyn_cparams;
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(pl_render_image(rr, &image, &target, &dyn_params));
+        pl_gpu_finish(gpu);
+    }
+
+    REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+        .tex            = fbo,
+        .ptr            = fbo_data,
+    }));
+
+    dyn_cparams.tone_mapping_lut_size = 256;
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(pl_render_image(rr, &image, &target, &dyn_params));
+        pl_gpu_finish(gpu);
+    }
+
+    REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+        .tex            = fbo,
+        .ptr            = lut_data,
+    }));
+
+    for (int i = 0; i < fbo->params.w * fbo->params.h * 4; i++)
+        REQUIRE(feq(fbo_data[i], lut_data[i], 1e-2));
+
+    // Test the fused color LUT against the direct color mapping
+    struct pl_render_params lut_params = pl_render_default_params;
+    lut_params.peak_detect_params = NULL;
+    REQUIRE(pl_render_image(rr, &image, &target, &lut_params));
+    REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+        .tex            = fbo,
+        .ptr            = fbo_data,
+    }));
+
+    lut_params.color_lut_size = 33;
+    REQUIRE(pl_render_image(rr, &image, &target, &lut_params));
+    REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+        .tex            = fbo,
+        .ptr            = lut_data,
+    }));
+
+    for (int i = 0; i < fbo->params.w * fbo->params.h * 4; i++)
+        REQUIRE(feq(fbo_data[i], lut_data[i], 1e-2));
+
+    // Same, but with peak detection, for which the LUT is keyed on the
+    // detected values once they have been read back
+    pl_renderer_flush_cache(rr);
+    lut_params = pl_render_default_params;
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(pl_render_image(rr, &image, &target, &lut_params));
+        pl_gpu_finish(gpu);
+    }
+
+    REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+        .tex            = fbo,
+        .ptr            = fbo_data,
+    }));
+
+    lut_params.color_lut_size = 33;
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(pl_render_image(rr, &image, &target, &lut_params));
+        pl_gpu_finish(gpu);
+    }
+
+    REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+        .tex            = fbo,
+        .ptr            = lut_data,
+    }));
+
+    for (int i = 0; i < fbo->params.w * fbo->params.h * 4; i++)
+        REQUIRE(feq(fbo_data[i], lut_data[i], 1e-2));
+    free(lut_data);
+
     image.color.sig_scale = target.color.sig_scale = 0.0;
 
     // Test some misc stuff
@@ -877,10 +1895,57 @@ static void pl_render_tests(const struct pl_gpu *gpu)
     REQUIRE(pl_render_image(rr, &image, &target, &params));
     target.num_overlays = 0;
 
+    // Test per-pass statistics
+    pl_renderer_set_stats(rr, true);
+    for (int i = 0; i < 5; i++) {
+        REQUIRE(pl_render_image(rr, &image, &target, &params));
+        pl_gpu_finish(gpu);
+    }
+
+    const struct pl_dispatch_pass_stats *stats;
+    int num_stats = pl_renderer_query_stats(rr, &stats);
+    REQUIRE(num_stats > 0);
+    for (int i = 0; i < num_stats; i++) {
+        REQUIRE(stats[i].description);
+        REQUIRE(stats[i].num_runs > 0);
+        printf("pass '%s': gpu %"PRIu64" ns, cpu %"PRIu64" + %"PRIu64" ns\n",
+               stats[i].description, stats[i].gpu_time,
+               stats[i].cpu_setup_time, stats[i].cpu_run_time);
+    }
+    pl_renderer_set_stats(rr, false);
+
+    // Test sharing objects between two renderers
+    struct pl_dispatch_cache *cache = pl_dispatch_cache_create(gpu->ctx, gpu);
+    struct pl_renderer *rr2 = pl_renderer_create(gpu->ctx, gpu);
+    pl_renderer_set_cache(rr, cache);
+    pl_renderer_set_cache(rr2, cache);
+    pl_dispatch_cache_unref(&cache);
+
+    int num_px = fbo->params.w * fbo->params.h * 4;
+    float *fbo_data2 = malloc(num_px * sizeof(float));
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+    REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+        .tex            = fbo,
+        .ptr            = fbo_data,
+    }));
+    REQUIRE(pl_render_image(rr2, &image, &target, &params));
+    REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+        .tex            = fbo,
+        .ptr            = fbo_data2,
+    }));
+    for (int i = 0; i < num_px; i++)
+        REQUIRE(feq(fbo_data[i], fbo_data2[i], 1e-4));
+
+    free(fbo_data2);
+    pl_renderer_destroy(&rr2);
+
 error:
     free(fbo_data);
+    free(ref_data);
     pl_renderer_destroy(&rr);
     pl_tex_destroy(gpu, &img5x5_tex);
+    pl_tex_destroy(gpu, &grad_tex);
+    pl_tex_destroy(gpu, &chroma_tex);
     pl_tex_destroy(gpu, &fbo);
 }
 
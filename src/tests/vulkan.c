@@ -2,6 +2,7 @@
 #include "vulkan/command.h"
 #include "vulkan/gpu.h"
 #include <vulkan/vulkan.h>
+#include <pthread.h>
 
 static void vulkan_interop_tests(const struct pl_vulkan *pl_vk,
                                  enum pl_handle_type handle_type)
@@ -101,6 +102,72 @@ static void vulkan_test_export_import(const struct pl_vulkan *pl_vk,
     pl_tex_destroy(gpu, &export);
 }
 
+static void vulkan_barrier_tests(const struct pl_vulkan *pl_vk)
+{
+    const struct pl_gpu *gpu = pl_vk->gpu;
+    struct vk_ctx *vk = TA_PRIV(pl_vk);
+
+    const struct pl_fmt *fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 4, 8, 8,
+                                           PL_FMT_CAP_SAMPLEABLE |
+                                           PL_FMT_CAP_RENDERABLE);
+    if (!fmt)
+        return;
+
+#define NUM_TEX 8
+    const struct pl_tex *tex[NUM_TEX];
+    for (int i = 0; i < NUM_TEX; i++) {
+        tex[i] = pl_tex_create(gpu, &(struct pl_tex_params) {
+            .w = 16,
+            .h = 16,
+            .format = fmt,
+            .sampleable = true,
+            .renderable = true,
+            .blit_dst = true,
+        });
+        REQUIRE(tex[i]);
+        pl_tex_clear(gpu, tex[i], (float[4]){ 0.1 * i });
+    }
+
+    const struct pl_tex *fbo = pl_tex_create(gpu, &(struct pl_tex_params) {
+        .w = 16,
+        .h = 16,
+        .format = fmt,
+        .renderable = true,
+    });
+    REQUIRE(fbo);
+
+    struct pl_dispatch *dp = pl_dispatch_create(gpu->ctx, gpu);
+    REQUIRE(dp);
+
+    for (int n = 0; n < 2; n++) {
+        struct pl_shader *sh = pl_dispatch_begin(dp);
+        REQUIRE(sh_require(sh, PL_SHADER_SIG_NONE, 16, 16));
+        GLSL("vec4 color = vec4(0.0); \n");
+        for (int i = 0; i < NUM_TEX; i++) {
+            ident_t pos, src = sh_bind(sh, tex[i], "src", NULL, &pos, NULL, NULL);
+            REQUIRE(src);
+            GLSL("color += texture(%s, %s); \n", src, pos);
+        }
+
+        uint64_t num_barriers = vk->num_barriers;
+        REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+            .shader = &sh,
+            .target = fbo,
+        }));
+
+        // All of the textures need a layout transition on the first pass, but
+        // they should end up batched into a single barrier (plus possibly one
+        // event wait)
+        REQUIRE(vk->num_barriers - num_barriers <= 2);
+    }
+
+    pl_dispatch_destroy(&dp);
+    pl_tex_destroy(gpu, &fbo);
+    for (int i = 0; i < NUM_TEX; i++)
+        pl_tex_destroy(gpu, &tex[i]);
+#undef NUM_TEX
+}
+
 static void vulkan_swapchain_tests(const struct pl_vulkan *vk, VkSurfaceKHR surf)
 {
     if (!surf)
@@ -141,6 +208,56 @@ static void vulkan_swapchain_tests(const struct pl_vulkan *vk, VkSurfaceKHR surf
     pl_swapchain_destroy(&sw);
 }
 
+#define NUM_THREADS 4
+
+static void *vulkan_thread_fn(void *arg)
+{
+    const struct pl_gpu *gpu = arg;
+    const struct pl_fmt *fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 16, 32,
+                                           PL_FMT_CAP_HOST_READABLE);
+    if (!fmt)
+        return NULL;
+
+    float data[16*16], out[16*16];
+    for (int i = 0; i < PL_ARRAY_SIZE(data); i++)
+        data[i] = i;
+
+    const struct pl_tex *tex = pl_tex_create(gpu, &(struct pl_tex_params) {
+        .w = 16,
+        .h = 16,
+        .format = fmt,
+        .host_writable = true,
+        .host_readable = true,
+    });
+    REQUIRE(tex);
+
+    for (int n = 0; n < 50; n++) {
+        memset(out, 0, sizeof(out));
+        REQUIRE(pl_tex_upload(gpu, &(struct pl_tex_transfer_params) {
+            .tex = tex,
+            .ptr = data,
+        }));
+        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+            .tex = tex,
+            .ptr = out,
+        }));
+        REQUIRE(memcmp(data, out, sizeof(data)) == 0);
+    }
+
+    pl_tex_destroy(gpu, &tex);
+    return NULL;
+}
+
+static void vulkan_thread_tests(const struct pl_vulkan *pl_vk)
+{
+    pthread_t threads[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++)
+        REQUIRE(pthread_create(&threads[i], NULL, vulkan_thread_fn,
+                               (void *) pl_vk->gpu) == 0);
+    for (int i = 0; i < NUM_THREADS; i++)
+        pthread_join(threads[i], NULL);
+}
+
 int main()
 {
     struct pl_context *ctx = pl_test_context();
@@ -222,6 +339,7 @@ int main()
             continue;
 
         gpu_tests(vk->gpu);
+        vulkan_barrier_tests(vk);
         vulkan_swapchain_tests(vk, surf);
 
         // Test importing this context via the vulkan interop API
@@ -272,6 +390,13 @@ int main()
 
         pl_vulkan_destroy(&vk);
 
+        // Hammer the same pl_gpu from several threads at once
+        params.thread_safe = true;
+        vk = pl_vulkan_create(ctx, &params);
+        REQUIRE(vk);
+        vulkan_thread_tests(vk);
+        pl_vulkan_destroy(&vk);
+
         // Reduce log spam after first tested device
         pl_test_set_verbosity(ctx, PL_LOG_INFO);
     }
@@ -36,6 +36,7 @@ static void vk_cmd_reset(struct vk_ctx *vk, struct vk_cmd *cmd)
     cmd->num_deps = 0;
     cmd->num_sigs = 0;
     cmd->num_objs = 0;
+    cmd->gen++;
 
     // also make sure to reset vk->last_cmd in case this was the last command
     if (vk->last_cmd == cmd)
@@ -88,12 +89,14 @@ error:
 void vk_dev_callback(struct vk_ctx *vk, vk_cb callback,
                      const void *priv, const void *arg)
 {
+    vk_lock(vk);
     if (vk->last_cmd) {
         vk_cmd_callback(vk->last_cmd, callback, priv, arg);
     } else {
         // The device was already idle, so we can just immediately call it
         callback((void *) priv, (void *) arg);
     }
+    vk_unlock(vk);
 }
 
 void vk_cmd_callback(struct vk_cmd *cmd, vk_cb callback,
@@ -136,7 +139,10 @@ struct vk_signal *vk_cmd_signal(struct vk_ctx *vk, struct vk_cmd *cmd,
                                 VkPipelineStageFlags stage)
 {
     struct vk_signal *sig = NULL;
-    if (TARRAY_POP(vk->signals, vk->num_signals, &sig))
+    vk_lock(vk);
+    bool reused = TARRAY_POP(vk->signals, vk->num_signals, &sig);
+    vk_unlock(vk);
+    if (reused)
         goto done;
 
     // no available signal => initialize a new one
@@ -230,7 +236,9 @@ static void release_signal(struct vk_ctx *vk, struct vk_signal *sig)
     if (sig->event)
         vk->ResetEvent(vk->dev, sig->event);
     sig->source = NULL;
+    vk_lock(vk);
     TARRAY_APPEND(vk->ta, vk->signals, vk->num_signals, sig);
+    vk_unlock(vk);
 }
 
 enum vk_wait_type vk_cmd_wait(struct vk_ctx *vk, struct vk_cmd *cmd,
@@ -242,7 +250,11 @@ enum vk_wait_type vk_cmd_wait(struct vk_ctx *vk, struct vk_cmd *cmd,
     if (!sig)
         return VK_WAIT_NONE;
 
-    if (sig->source == cmd->queue && unsignal(vk, cmd, sig->semaphore)) {
+    vk_lock(vk);
+    bool same_queue = sig->source == cmd->queue && unsignal(vk, cmd, sig->semaphore);
+    vk_unlock(vk);
+
+    if (same_queue) {
         // If we can remove the semaphore signal operation from the history and
         // pretend it never happened, then we get to use the more efficient
         // synchronization primitives. However, this requires that we're still
@@ -321,6 +333,19 @@ void vk_cmdpool_destroy(struct vk_ctx *vk, struct vk_cmdpool *pool)
     talloc_free(pool);
 }
 
+struct vk_cmdpool *vk_cmdpool_clone(struct vk_ctx *vk, struct vk_cmdpool *parent)
+{
+    struct VkDeviceQueueCreateInfo qinfo = {
+        .queueFamilyIndex = parent->qf,
+        .queueCount = parent->num_queues,
+    };
+
+    struct vk_cmdpool *pool = vk_cmdpool_create(vk, qinfo, parent->props);
+    if (pool)
+        pool->parent = parent;
+    return pool;
+}
+
 struct vk_cmd *vk_cmd_begin(struct vk_ctx *vk, struct vk_cmdpool *pool)
 {
     // Garbage collect the cmdpool first, to increase the chances of getting
@@ -328,7 +353,10 @@ struct vk_cmd *vk_cmd_begin(struct vk_ctx *vk, struct vk_cmdpool *pool)
     vk_poll_commands(vk, 0);
 
     struct vk_cmd *cmd = NULL;
-    if (TARRAY_POP(pool->cmds, pool->num_cmds, &cmd))
+    vk_lock(vk);
+    bool reused = TARRAY_POP(pool->cmds, pool->num_cmds, &cmd);
+    vk_unlock(vk);
+    if (reused)
         goto done;
 
     // No free command buffers => allocate another one
@@ -345,7 +373,11 @@ done: ;
 
     VK(vk->BeginCommandBuffer(cmd->buf, &binfo));
 
-    cmd->queue = pool->queues[pool->idx_queues];
+    // Per-thread pools follow the queue rotation of their parent
+    const struct vk_cmdpool *qpool = PL_DEF(pool->parent, pool);
+    vk_lock(vk);
+    cmd->queue = qpool->queues[qpool->idx_queues];
+    vk_unlock(vk);
     return cmd;
 
 error:
@@ -364,10 +396,14 @@ bool vk_cmd_queue(struct vk_ctx *vk, struct vk_cmd **pcmd)
     VK(vk->EndCommandBuffer(cmd->buf));
 
     VK(vk->ResetFences(vk->dev, 1, &cmd->fence));
+
+    vk_lock(vk);
     TARRAY_APPEND(vk->ta, vk->cmds_queued, vk->num_cmds_queued, cmd);
     vk->last_cmd = cmd;
+    bool flush = vk->num_cmds_queued >= PL_VK_MAX_QUEUED_CMDS;
+    vk_unlock(vk);
 
-    if (vk->num_cmds_queued >= PL_VK_MAX_QUEUED_CMDS) {
+    if (flush) {
         PL_WARN(vk, "Exhausted the queued command limit.. forcing a flush now. "
                 "Consider using pl_gpu_flush after submitting a batch of work?");
         vk_flush_commands(vk);
@@ -376,20 +412,44 @@ bool vk_cmd_queue(struct vk_ctx *vk, struct vk_cmd **pcmd)
     return true;
 
 error:
+    vk_lock(vk);
     vk_cmd_reset(vk, cmd);
     TARRAY_APPEND(pool, pool->cmds, pool->num_cmds, cmd);
     vk->failed = true;
+    vk_unlock(vk);
     return false;
 }
 
 bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout)
 {
     bool ret = false;
+    vk_lock(vk);
 
     while (vk->num_cmds_pending > 0) {
         struct vk_cmd *cmd = vk->cmds_pending[0];
         struct vk_cmdpool *pool = cmd->pool;
-        VkResult res = vk_cmd_poll(vk, cmd, timeout);
+        VkResult res = vk_cmd_poll(vk, cmd, 0);
+        if (res == VK_TIMEOUT && timeout) {
+            // Avoid holding the lock while blocking on the GPU, so other
+            // threads can keep recording and submitting in the meantime. By
+            // the time we re-acquire it, the command may have been completed,
+            // reset and even resubmitted by another thread, which is detected
+            // by the generation counter. (Note that this does not release
+            // the lock if the caller is already holding it)
+            VkFence fence = cmd->fence;
+            uint64_t gen = cmd->gen;
+            vk_unlock(vk);
+            res = vk->WaitForFences(vk->dev, 1, &fence, false, timeout);
+            vk_lock(vk);
+            if (!vk->num_cmds_pending || vk->cmds_pending[0] != cmd ||
+                cmd->gen != gen)
+            {
+                // Another thread already processed this command
+                ret = true;
+                timeout = 0;
+                continue;
+            }
+        }
         if (res == VK_TIMEOUT)
             break;
         PL_TRACE(vk, "VkFence signalled: %p", (void *) cmd->fence);
@@ -406,6 +466,7 @@ bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout)
         timeout = 0;
     }
 
+    vk_unlock(vk);
     return ret;
 }
 
@@ -416,6 +477,8 @@ bool vk_flush_commands(struct vk_ctx *vk)
 
 bool vk_flush_obj(struct vk_ctx *vk, const void *obj)
 {
+    vk_lock(vk);
+
     // Count how many commands we want to flush
     int num_to_flush = vk->num_cmds_queued;
     if (obj) {
@@ -433,8 +496,10 @@ next_cmd: ;
         }
     }
 
-    if (!num_to_flush)
+    if (!num_to_flush) {
+        vk_unlock(vk);
         return true;
+    }
 
     PL_TRACE(vk, "Flushing %d/%d queued commands",
              num_to_flush, vk->num_cmds_queued);
@@ -488,9 +553,17 @@ error:
                 vk->num_cmds_queued * sizeof(vk->cmds_queued[0]));
     }
 
-    // Wait until we've processed some of the now pending commands
-    while (vk->num_cmds_pending > PL_VK_MAX_PENDING_CMDS)
+    // Wait until we've processed some of the now pending commands. This is
+    // done after releasing the lock, to avoid blocking other threads
+    bool wait = vk->num_cmds_pending > PL_VK_MAX_PENDING_CMDS;
+    vk_unlock(vk);
+
+    while (wait) {
         vk_poll_commands(vk, UINT64_MAX);
+        vk_lock(vk);
+        wait = vk->num_cmds_pending > PL_VK_MAX_PENDING_CMDS;
+        vk_unlock(vk);
+    }
 
     return ret;
 }
@@ -498,11 +571,13 @@ error:
 void vk_rotate_queues(struct vk_ctx *vk)
 {
     // Rotate the queues to ensure good parallelism across frames
+    vk_lock(vk);
     for (int i = 0; i < vk->num_pools; i++) {
         struct vk_cmdpool *pool = vk->pools[i];
         pool->idx_queues = (pool->idx_queues + 1) % pool->num_queues;
         PL_TRACE(vk, "QF %d: %d/%d", pool->qf, pool->idx_queues, pool->num_queues);
     }
+    vk_unlock(vk);
 }
 
 void vk_wait_idle(struct vk_ctx *vk)
@@ -42,6 +42,7 @@ struct vk_cmd {
     VkQueue queue;           // the submission queue (for recording/pending)
     VkCommandBuffer buf;     // the command buffer itself
     VkFence fence;           // the fence guards cmd buffer reuse
+    uint64_t gen;            // incremented on every reset, see `vk_poll_commands`
     // The semaphores represent dependencies that need to complete before
     // this command can be executed. These are *not* owned by the vk_cmd
     VkSemaphore *deps;
@@ -120,6 +121,7 @@ void vk_signal_destroy(struct vk_ctx *vk, struct vk_signal **sig);
 struct vk_cmdpool {
     VkQueueFamilyProperties props;
     int qf; // queue family index
+    struct vk_cmdpool *parent; // for per-thread pools, see `vk_cmdpool_clone`
     VkCommandPool pool;
     VkQueue *queues;
     int num_queues;
@@ -137,6 +139,11 @@ struct vk_cmdpool *vk_cmdpool_create(struct vk_ctx *vk,
 
 void vk_cmdpool_destroy(struct vk_ctx *vk, struct vk_cmdpool *pool);
 
+// Create a new command pool for the same queue family as `parent`, sharing its
+// queues (and queue rotation). Since VkCommandPools must be externally
+// synchronized, this is used to give each recording thread its own pool.
+struct vk_cmdpool *vk_cmdpool_clone(struct vk_ctx *vk, struct vk_cmdpool *parent);
+
 // Fetch a command buffer from a command pool and begin recording to it.
 // Returns NULL on failure.
 struct vk_cmd *vk_cmd_begin(struct vk_ctx *vk, struct vk_cmdpool *pool);
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <pthread.h>
+
 #include "../common.h"
 #include "../context.h"
 
@@ -67,6 +69,13 @@ struct vk_ctx {
     // Generic error flag for catching "failed" devices
     bool failed;
 
+    // Guards all of the shared command state below (queued/pending commands,
+    // free command buffers, signals, callbacks and queue submission). This is
+    // a recursive mutex, since callbacks may run arbitrary code. Only used if
+    // `thread_safe` is set, see `vk_lock`/`vk_unlock`.
+    pthread_mutex_t lock;
+    bool thread_safe; // use per-thread command pools (see `pl_vulkan_params`)
+
     // Enabled extensions
     const char **exts;
     int num_exts;
@@ -96,6 +105,10 @@ struct vk_ctx {
     int num_signals;
     bool disable_events;
 
+    // Synchronization statistics, for debugging and benchmarking purposes
+    uint64_t num_barriers;     // vkCmdPipelineBarrier/vkCmdWaitEvents calls
+    uint64_t num_mem_barriers; // individual memory barriers contained therein
+
     // Instance-level function pointers
     VK_FUN(CreateDevice);
     VK_FUN(EnumerateDeviceExtensionProperties);
@@ -221,3 +234,17 @@ struct vk_ctx {
     VK_FUN(GetSemaphoreWin32HandleKHR);
 #endif
 };
+
+// Lock/unlock the shared command state. These are no-ops unless the context
+// was created with `thread_safe`.
+static inline void vk_lock(struct vk_ctx *vk)
+{
+    if (vk->thread_safe)
+        pthread_mutex_lock(&vk->lock);
+}
+
+static inline void vk_unlock(struct vk_ctx *vk)
+{
+    if (vk->thread_safe)
+        pthread_mutex_unlock(&vk->lock);
+}
@@ -164,6 +164,12 @@ static const struct vk_ext vk_device_extensions[] = {
             VK_DEV_FUN(SetHdrMetadataEXT),
             {0},
         },
+    }, {
+        .name = VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME,
+        .core_ver = VK_API_VERSION_1_2,
+        .funs = (struct vk_fun[]) {
+            {0}
+        },
     }, {
         .name = VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME,
         .core_ver = VK_API_VERSION_1_2,
@@ -188,6 +194,7 @@ const char * const pl_vulkan_recommended_extensions[] = {
 #endif
     VK_EXT_PCI_BUS_INFO_EXTENSION_NAME,
     VK_EXT_HDR_METADATA_EXTENSION_NAME,
+    VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME,
     VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME,
 };
 
@@ -195,8 +202,14 @@ const int pl_vulkan_num_recommended_extensions =
     PL_ARRAY_SIZE(pl_vulkan_recommended_extensions);
 
 // pNext chain of features we want enabled
+static const VkPhysicalDeviceShaderFloat16Int8FeaturesKHR float16_int8 = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES_KHR,
+    .shaderFloat16 = true,
+};
+
 static const VkPhysicalDeviceHostQueryResetFeaturesEXT host_query_reset = {
     .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES_EXT,
+    .pNext = (void *) &float16_int8,
     .hostQueryReset = true,
 };
 
@@ -781,6 +794,15 @@ const struct pl_vulkan_params pl_vulkan_default_params = {
     .queue_count    = 1, // enabling multiple queues often decreases perf
 };
 
+static void vk_ctx_init_lock(struct vk_ctx *vk)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&vk->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
 void pl_vulkan_destroy(const struct pl_vulkan **pl_vk)
 {
     if (!*pl_vk)
@@ -799,11 +821,16 @@ void pl_vulkan_destroy(const struct pl_vulkan **pl_vk)
         for (int i = 0; i < vk->num_signals; i++)
             vk_signal_destroy(vk, &vk->signals[i]);
 
+        PL_DEBUG(vk, "Issued %"PRIu64" pipeline barriers (containing %"PRIu64
+                 " memory barriers) over the lifetime of this device",
+                 vk->num_barriers, vk->num_mem_barriers);
+
         if (!vk->imported)
             vk->DestroyDevice(vk->dev, VK_ALLOC);
     }
 
     pl_vk_inst_destroy(&vk->internal_instance);
+    pthread_mutex_destroy(&vk->lock);
     TA_FREEP((void **) pl_vk);
 }
 
@@ -1241,8 +1268,10 @@ const struct pl_vulkan *pl_vulkan_create(struct pl_context *ctx,
         .ctx = ctx,
         .inst = params->instance,
         .GetInstanceProcAddr = get_proc_addr_fallback(ctx, params->get_proc_addr),
+        .thread_safe = params->thread_safe,
     };
 
+    vk_ctx_init_lock(vk);
     if (!vk->GetInstanceProcAddr)
         goto error;
 
@@ -1391,8 +1420,11 @@ const struct pl_vulkan *pl_vulkan_import(struct pl_context *ctx,
         .physd = params->phys_device,
         .dev = params->device,
         .GetInstanceProcAddr = get_proc_addr_fallback(ctx, params->get_proc_addr),
+        .thread_safe = params->thread_safe,
     };
 
+    vk_ctx_init_lock(vk);
+
     if (!vk->GetInstanceProcAddr)
         goto error;
 
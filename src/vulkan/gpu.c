@@ -33,6 +33,42 @@ enum queue_type {
     TRANSFER,
 };
 
+// Pipeline barriers collected while binding the resources of a pass, so they
+// can be emitted as (at most) one vkCmdPipelineBarrier plus one
+// vkCmdWaitEvents call, with merged stage masks
+struct vk_barrier_batch {
+    bool active;
+    struct vk_cmd *cmd;
+    // for vkCmdPipelineBarrier
+    VkPipelineStageFlags src_stages, dst_stages;
+    VkImageMemoryBarrier *img;
+    VkBufferMemoryBarrier *buf;
+    int num_img, num_buf;
+    // for vkCmdWaitEvents
+    VkPipelineStageFlags ev_src_stages, ev_dst_stages;
+    VkEvent *events;
+    VkImageMemoryBarrier *ev_img;
+    VkBufferMemoryBarrier *ev_buf;
+    int num_events, num_ev_img, num_ev_buf;
+};
+
+// Per-thread command recording state
+struct vk_thread {
+    // Command pools used by this thread, either the pools from the vk_ctx
+    // itself, or per-thread clones of them (see `pl_vulkan_params.thread_safe`)
+    struct vk_cmdpool *pool_graphics;
+    struct vk_cmdpool *pool_compute;
+    struct vk_cmdpool *pool_transfer;
+    bool owns_pools;
+
+    // The "currently recording" command. This will be queued and replaced by
+    // a new command every time we need to "switch" between queue families.
+    struct vk_cmd *cmd;
+
+    // Pending pipeline barriers, see `vk_barrier`
+    struct vk_barrier_batch barriers;
+};
+
 // For gpu.priv
 struct pl_vk {
     struct pl_gpu_fns impl;
@@ -50,19 +86,125 @@ struct pl_vk {
     // (e.g. partial clears, blits or emulated texture transfers).
     // Warning: Care must be taken to avoid recursive calls.
     struct pl_dispatch *dp;
+    pthread_mutex_t dp_lock; // guards `dp` against concurrent use
 
-    // The "currently recording" command. This will be queued and replaced by
-    // a new command every time we need to "switch" between queue families.
-    struct vk_cmd *cmd;
+    // Guards the use of `spirv`, which is not necessarily thread-safe
+    pthread_mutex_t spirv_lock;
+
+    // Recording state. If `vk->thread_safe` is set, every thread gets its own
+    // state (looked up via `tls`). Otherwise, `main` is always used.
+    struct vk_thread *main;
+    pthread_key_t tls;
+    struct vk_thread **threads; // all states created so far, guarded by vk->lock
+    int num_threads;
 };
 
+static void vk_thread_destroy(const struct pl_gpu *gpu, struct vk_thread *t);
+
+// Returns the recording state for the calling thread, or NULL on error
+static struct vk_thread *vk_thread(const struct pl_gpu *gpu)
+{
+    struct pl_vk *p = TA_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+    if (!vk->thread_safe)
+        return p->main;
+
+    struct vk_thread *t = pthread_getspecific(p->tls);
+    if (t)
+        return t;
+
+    vk_lock(vk);
+    t = talloc_zero((void *) gpu, struct vk_thread);
+    t->owns_pools = true;
+
+    struct vk_cmdpool **pools[] = {
+        &t->pool_graphics, &t->pool_compute, &t->pool_transfer,
+    };
+    struct vk_cmdpool *parents[] = {
+        vk->pool_graphics, vk->pool_compute, vk->pool_transfer,
+    };
+
+    for (int i = 0; i < PL_ARRAY_SIZE(pools); i++) {
+        if (!parents[i])
+            continue;
+
+        // Re-use our clone if several capabilities map to the same pool
+        for (int j = 0; j < i; j++) {
+            if (parents[j] == parents[i])
+                *pools[i] = *pools[j];
+        }
+
+        if (!*pools[i])
+            *pools[i] = vk_cmdpool_clone(vk, parents[i]);
+        if (!*pools[i]) {
+            PL_ERR(gpu, "Failed creating per-thread command pools!");
+            goto error;
+        }
+    }
+
+    TARRAY_APPEND((void *) gpu, p->threads, p->num_threads, t);
+    pthread_setspecific(p->tls, t);
+    PL_DEBUG(gpu, "Created recording state for new thread (%d total)",
+             p->num_threads);
+    vk_unlock(vk);
+    return t;
+
+error:
+    vk_thread_destroy(gpu, t);
+    talloc_free(t);
+    vk_unlock(vk);
+    return NULL;
+}
+
+static void vk_thread_destroy(const struct pl_gpu *gpu, struct vk_thread *t)
+{
+    struct pl_vk *p = TA_PRIV(gpu);
+    if (!t->owns_pools)
+        return;
+
+    struct vk_cmdpool *pools[] = {
+        t->pool_graphics, t->pool_compute, t->pool_transfer,
+    };
+
+    for (int i = 0; i < PL_ARRAY_SIZE(pools); i++) {
+        bool dupe = false;
+        for (int j = 0; j < i; j++)
+            dupe |= pools[j] == pools[i];
+        if (!dupe)
+            vk_cmdpool_destroy(p->vk, pools[i]);
+    }
+}
+
+// Returns the currently recording command of the calling thread, or NULL
+static struct vk_cmd *vk_cur_cmd(const struct pl_gpu *gpu)
+{
+    struct vk_thread *t = vk_thread(gpu);
+    return t ? t->cmd : NULL;
+}
+
 static void vk_submit(const struct pl_gpu *gpu)
 {
     struct pl_vk *p = TA_PRIV(gpu);
     struct vk_ctx *vk = p->vk;
+    struct vk_thread *t = vk_thread(gpu);
 
-    if (p->cmd)
-        vk_cmd_queue(vk, &p->cmd);
+    if (t && t->cmd)
+        vk_cmd_queue(vk, &t->cmd);
+}
+
+// Submits the currently recording commands of *all* threads. Only safe to
+// call when no other thread is using the `pl_gpu`.
+static void vk_submit_all(const struct pl_gpu *gpu)
+{
+    struct pl_vk *p = TA_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+
+    if (p->main && p->main->cmd)
+        vk_cmd_queue(vk, &p->main->cmd);
+    for (int i = 0; i < p->num_threads; i++) {
+        if (p->threads[i]->cmd)
+            vk_cmd_queue(vk, &p->threads[i]->cmd);
+    }
 }
 
 // Returns a command buffer, or NULL on error
@@ -71,30 +213,33 @@ static struct vk_cmd *vk_require_cmd(const struct pl_gpu *gpu,
 {
     struct pl_vk *p = TA_PRIV(gpu);
     struct vk_ctx *vk = p->vk;
+    struct vk_thread *t = vk_thread(gpu);
+    if (!t)
+        return NULL;
 
     struct vk_cmdpool *pool;
     switch (type) {
-    case GRAPHICS: pool = vk->pool_graphics; break;
-    case COMPUTE:  pool = vk->pool_compute;  break;
+    case GRAPHICS: pool = t->pool_graphics; break;
+    case COMPUTE:  pool = t->pool_compute;  break;
 
     // GRAPHICS and COMPUTE also imply TRANSFER capability (vulkan spec)
     case TRANSFER:
-        pool = vk->pool_transfer;
+        pool = t->pool_transfer;
         if (!pool)
-            pool = vk->pool_compute;
+            pool = t->pool_compute;
         if (!pool)
-            pool = vk->pool_graphics;
+            pool = t->pool_graphics;
         break;
     default: abort();
     }
 
     pl_assert(pool);
-    if (p->cmd && p->cmd->pool == pool)
-        return p->cmd;
+    if (t->cmd && t->cmd->pool == pool)
+        return t->cmd;
 
     vk_submit(gpu);
-    p->cmd = vk_cmd_begin(vk, pool);
-    return p->cmd;
+    t->cmd = vk_cmd_begin(vk, pool);
+    return t->cmd;
 }
 
 static inline bool supports_marks(struct vk_cmd *cmd) {
@@ -123,8 +268,9 @@ static inline bool supports_marks(struct vk_cmd *cmd) {
     static void fun##_lazy(const struct pl_gpu *gpu, argtype *arg) {        \
         struct pl_vk *p = TA_PRIV(gpu);                                     \
         struct vk_ctx *vk = p->vk;                                          \
-        if (p->cmd) {                                                       \
-            vk_cmd_callback(p->cmd, (vk_cb) fun, gpu, (void *) arg);        \
+        struct vk_cmd *cmd = vk_cur_cmd(gpu);                               \
+        if (cmd) {                                                          \
+            vk_cmd_callback(cmd, (vk_cb) fun, gpu, (void *) arg);           \
         } else {                                                            \
             vk_dev_callback(vk, (vk_cb) fun, gpu, (void *) arg);            \
         }                                                                   \
@@ -136,9 +282,16 @@ static void vk_destroy_gpu(const struct pl_gpu *gpu)
     struct vk_ctx *vk = p->vk;
 
     pl_dispatch_destroy(&p->dp);
-    vk_submit(gpu);
+    vk_submit_all(gpu);
     vk_wait_idle(vk);
 
+    for (int i = 0; i < p->num_threads; i++)
+        vk_thread_destroy(gpu, p->threads[i]);
+    if (vk->thread_safe)
+        pthread_key_delete(p->tls);
+    pthread_mutex_destroy(&p->dp_lock);
+    pthread_mutex_destroy(&p->spirv_lock);
+
     vk_malloc_destroy(&p->alloc);
     spirv_compiler_destroy(&p->spirv);
 
@@ -358,6 +511,21 @@ const struct pl_gpu *pl_gpu_create_vk(struct vk_ctx *vk)
     p->impl = pl_fns_vk;
     p->vk = vk;
 
+    pthread_mutex_init(&p->dp_lock, NULL);
+    pthread_mutex_init(&p->spirv_lock, NULL);
+    if (vk->thread_safe && pthread_key_create(&p->tls, NULL) != 0) {
+        PL_ERR(gpu, "Failed creating thread-local storage key!");
+        vk->thread_safe = false;
+        goto error;
+    }
+
+    p->main = talloc_ptrtype(gpu, p->main);
+    *p->main = (struct vk_thread) {
+        .pool_graphics = vk->pool_graphics,
+        .pool_compute  = vk->pool_compute,
+        .pool_transfer = vk->pool_transfer,
+    };
+
     p->spirv = spirv_compiler_create(vk->ctx, vk->api_ver);
     p->alloc = vk_malloc_create(vk);
     if (!p->alloc || !p->spirv)
@@ -371,6 +539,7 @@ const struct pl_gpu *pl_gpu_create_vk(struct vk_ctx *vk)
         .max_pushc_size    = vk->limits.maxPushConstantsSize,
         .max_xfer_size     = SIZE_MAX, // no limit imposed by vulkan
         .max_ubo_size      = vk->limits.maxUniformBufferRange,
+        .align_ubo_offset  = vk->limits.minUniformBufferOffsetAlignment,
         .max_ssbo_size     = vk->limits.maxStorageBufferRange,
         .max_buffer_texels = vk->limits.maxTexelBufferElements,
         .min_gather_offset = vk->limits.minTexelGatherOffset,
@@ -449,6 +618,20 @@ const struct pl_gpu *pl_gpu_create_vk(struct vk_ctx *vk)
         gpu->caps |= PL_GPU_CAP_SUBGROUPS;
     }
 
+    // The feature struct is only filled in by drivers supporting it, so also
+    // make sure the extension was actually enabled
+    bool has_float16 = vk->api_ver >= VK_API_VERSION_1_2;
+    for (int i = 0; i < vk->num_exts; i++) {
+        if (strcmp(vk->exts[i], VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME) == 0)
+            has_float16 = true;
+    }
+
+    const VkPhysicalDeviceShaderFloat16Int8FeaturesKHR *float16;
+    float16 = vk_find_struct(&vk->features,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES_KHR);
+    if (has_float16 && float16 && float16->shaderFloat16)
+        gpu->caps |= PL_GPU_CAP_FLOAT16;
+
     // We ostensibly support this, although it can still fail on buffer
     // creation (for certain combinations of buffers)
     gpu->caps |= PL_GPU_CAP_MAPPED_BUFFERS;
@@ -615,9 +798,143 @@ static void vk_tex_deref(const struct pl_gpu *gpu, const struct pl_tex *tex)
     if (!tex)
         return;
 
+    struct pl_vk *p = TA_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
     struct pl_tex_vk *tex_vk = TA_PRIV(tex);
+
+    // Callbacks may run on any thread, so guard the refcount
+    vk_lock(vk);
     if (--tex_vk->refcount == 0)
         vk_tex_destroy(gpu, (struct pl_tex *) tex);
+    vk_unlock(vk);
+}
+
+
+static void vk_count_barriers(struct vk_ctx *vk, int num_mem_barriers)
+{
+    vk_lock(vk);
+    vk->num_barriers++;
+    vk->num_mem_barriers += num_mem_barriers;
+    vk_unlock(vk);
+}
+
+// Emits all barriers currently pending in the batch, and ends batching
+static void vk_barrier_flush(const struct pl_gpu *gpu)
+{
+    struct pl_vk *p = TA_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+    struct vk_barrier_batch *b = &vk_thread(gpu)->barriers;
+    if (!b->active)
+        return;
+
+    struct vk_cmd *cmd = b->cmd;
+    if (b->num_img || b->num_buf) {
+        vk->CmdPipelineBarrier(cmd->buf, b->src_stages, b->dst_stages, 0,
+                               0, NULL, b->num_buf, b->buf, b->num_img, b->img);
+        vk_count_barriers(vk, b->num_img + b->num_buf);
+    }
+
+    if (b->num_events) {
+        vk->CmdWaitEvents(cmd->buf, b->num_events, b->events, b->ev_src_stages,
+                          b->ev_dst_stages, 0, NULL, b->num_ev_buf, b->ev_buf,
+                          b->num_ev_img, b->ev_img);
+        vk_count_barriers(vk, b->num_ev_img + b->num_ev_buf);
+    }
+
+    *b = (struct vk_barrier_batch) {
+        // Preserve the allocations for the next batch
+        .img = b->img,
+        .buf = b->buf,
+        .events = b->events,
+        .ev_img = b->ev_img,
+        .ev_buf = b->ev_buf,
+    };
+}
+
+// Start collecting barriers instead of emitting them immediately. Must be
+// paired with a call to `vk_barrier_flush` before recording any command that
+// depends on them.
+static void vk_barrier_begin(const struct pl_gpu *gpu, struct vk_cmd *cmd)
+{
+    struct vk_barrier_batch *b = &vk_thread(gpu)->barriers;
+    pl_assert(!b->active);
+    b->active = true;
+    b->cmd = cmd;
+}
+
+// Returns whether the batch already contains a barrier for this resource.
+// Multiple barriers on the same resource can't be merged into one call, since
+// the order of execution between them would be undefined.
+static bool vk_barrier_pending(const struct vk_barrier_batch *b,
+                               const VkBufferMemoryBarrier *buf,
+                               const VkImageMemoryBarrier *img)
+{
+    for (int i = 0; buf && i < b->num_buf; i++) {
+        if (b->buf[i].buffer == buf->buffer)
+            return true;
+    }
+    for (int i = 0; buf && i < b->num_ev_buf; i++) {
+        if (b->ev_buf[i].buffer == buf->buffer)
+            return true;
+    }
+    for (int i = 0; img && i < b->num_img; i++) {
+        if (b->img[i].image == img->image)
+            return true;
+    }
+    for (int i = 0; img && i < b->num_ev_img; i++) {
+        if (b->ev_img[i].image == img->image)
+            return true;
+    }
+    return false;
+}
+
+// Record a single pipeline barrier (if `event` is VK_NULL_HANDLE) or event
+// wait. Exactly one of `buf` and `img` must be non-NULL. If a batch is
+// currently active, the barrier is deferred until `vk_barrier_flush`.
+static void vk_barrier(const struct pl_gpu *gpu, struct vk_cmd *cmd,
+                       VkEvent event, VkPipelineStageFlags src_stages,
+                       VkPipelineStageFlags dst_stages,
+                       const VkBufferMemoryBarrier *buf,
+                       const VkImageMemoryBarrier *img)
+{
+    struct pl_vk *p = TA_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+    struct vk_thread *t = vk_thread(gpu);
+    struct vk_barrier_batch *b = &t->barriers;
+
+    if (b->active && (b->cmd != cmd || vk_barrier_pending(b, buf, img))) {
+        vk_barrier_flush(gpu);
+        vk_barrier_begin(gpu, cmd);
+    }
+
+    if (!b->active) {
+        if (event) {
+            vk->CmdWaitEvents(cmd->buf, 1, &event, src_stages, dst_stages,
+                              0, NULL, !!buf, buf, !!img, img);
+        } else {
+            vk->CmdPipelineBarrier(cmd->buf, src_stages, dst_stages, 0,
+                                   0, NULL, !!buf, buf, !!img, img);
+        }
+        vk_count_barriers(vk, 1);
+        return;
+    }
+
+    if (event) {
+        TARRAY_APPEND(t, b->events, b->num_events, event);
+        if (buf)
+            TARRAY_APPEND(t, b->ev_buf, b->num_ev_buf, *buf);
+        if (img)
+            TARRAY_APPEND(t, b->ev_img, b->num_ev_img, *img);
+        b->ev_src_stages |= src_stages;
+        b->ev_dst_stages |= dst_stages;
+    } else {
+        if (buf)
+            TARRAY_APPEND(t, b->buf, b->num_buf, *buf);
+        if (img)
+            TARRAY_APPEND(t, b->img, b->num_img, *img);
+        b->src_stages |= src_stages;
+        b->dst_stages |= dst_stages;
+    }
 }
 
 
@@ -688,25 +1005,27 @@ static void tex_barrier(const struct pl_gpu *gpu, struct vk_cmd *cmd,
             // No synchronization required, so we can safely transition out of
             // VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT
             imgBarrier.srcAccessMask = 0;
-            vk->CmdPipelineBarrier(cmd->buf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                                   stage, 0, 0, NULL, 0, NULL, 1, &imgBarrier);
+            vk_barrier(gpu, cmd, VK_NULL_HANDLE, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       stage, NULL, &imgBarrier);
             break;
         case VK_WAIT_BARRIER:
             // Regular pipeline barrier is required
-            vk->CmdPipelineBarrier(cmd->buf, tex_vk->sig_stage, stage, 0, 0, NULL,
-                                   0, NULL, 1, &imgBarrier);
+            vk_barrier(gpu, cmd, VK_NULL_HANDLE, tex_vk->sig_stage, stage,
+                       NULL, &imgBarrier);
             break;
         case VK_WAIT_EVENT:
             // We can/should use the VkEvent for synchronization
-            vk->CmdWaitEvents(cmd->buf, 1, &event, tex_vk->sig_stage,
-                              stage, 0, NULL, 0, NULL, 1, &imgBarrier);
+            vk_barrier(gpu, cmd, event, tex_vk->sig_stage, stage,
+                       NULL, &imgBarrier);
             break;
         }
     }
 
     tex_vk->current_layout = newLayout;
     tex_vk->current_access = newAccess;
+    vk_lock(vk);
     tex_vk->refcount++;
+    vk_unlock(vk);
     vk_cmd_callback(cmd, (vk_cb) vk_tex_deref, gpu, tex);
     vk_cmd_obj(cmd, tex);
 }
@@ -1360,12 +1679,14 @@ static void vk_buf_deref(const struct pl_gpu *gpu, const struct pl_buf *buf)
     struct vk_ctx *vk = p->vk;
     struct pl_buf_vk *buf_vk = TA_PRIV(buf);
 
+    vk_lock(vk);
     if (--buf_vk->refcount == 0) {
         vk_signal_destroy(vk, &buf_vk->sig);
         vk->DestroyBufferView(vk->dev, buf_vk->view, VK_ALLOC);
         vk_free_memslice(p->alloc, buf_vk->slice.mem);
         talloc_free((void *) buf);
     }
+    vk_unlock(vk);
 }
 
 static void vk_buf_finish_write(const struct pl_gpu *gpu, const struct pl_buf *buf)
@@ -1373,8 +1694,32 @@ static void vk_buf_finish_write(const struct pl_gpu *gpu, const struct pl_buf *b
     if (!buf)
         return;
 
+    struct pl_vk *p = TA_PRIV(gpu);
     struct pl_buf_vk *buf_vk = TA_PRIV(buf);
+    vk_lock(p->vk);
     buf_vk->writes--;
+    vk_unlock(p->vk);
+}
+
+// The refcount and write count may be concurrently modified by callbacks
+static bool vk_buf_in_use(const struct pl_gpu *gpu, const struct pl_buf *buf)
+{
+    struct pl_vk *p = TA_PRIV(gpu);
+    struct pl_buf_vk *buf_vk = TA_PRIV(buf);
+    vk_lock(p->vk);
+    bool in_use = buf_vk->refcount > 1;
+    vk_unlock(p->vk);
+    return in_use;
+}
+
+static bool vk_buf_writing(const struct pl_gpu *gpu, const struct pl_buf *buf)
+{
+    struct pl_vk *p = TA_PRIV(gpu);
+    struct pl_buf_vk *buf_vk = TA_PRIV(buf);
+    vk_lock(p->vk);
+    bool writing = buf_vk->writes > 0;
+    vk_unlock(p->vk);
+    return writing;
 }
 
 enum buffer_op {
@@ -1459,23 +1804,24 @@ static void buf_barrier(const struct pl_gpu *gpu, struct vk_cmd *cmd,
             // VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT
             buffBarrier.srcAccessMask = 0;
             src_stages |= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            vk->CmdPipelineBarrier(cmd->buf, src_stages, stage, 0, 0, NULL,
-                                   1, &buffBarrier, 0, NULL);
+            vk_barrier(gpu, cmd, VK_NULL_HANDLE, src_stages, stage,
+                       &buffBarrier, NULL);
             break;
         case VK_WAIT_BARRIER:
             // Regular pipeline barrier is required
-            vk->CmdPipelineBarrier(cmd->buf, buf_vk->sig_stage | src_stages,
-                                   stage, 0, 0, NULL, 1, &buffBarrier, 0, NULL);
+            vk_barrier(gpu, cmd, VK_NULL_HANDLE, buf_vk->sig_stage | src_stages,
+                       stage, &buffBarrier, NULL);
             break;
         case VK_WAIT_EVENT:
             // We can/should use the VkEvent for synchronization
             pl_assert(!src_stages);
-            vk->CmdWaitEvents(cmd->buf, 1, &event, buf_vk->sig_stage,
-                              stage, 0, NULL, 1, &buffBarrier, 0, NULL);
+            vk_barrier(gpu, cmd, event, buf_vk->sig_stage, stage,
+                       &buffBarrier, NULL);
             break;
         }
     }
 
+    vk_lock(vk);
     if (op & BUF_WRITE) {
         buf_vk->writes++;
         vk_cmd_callback(cmd, (vk_cb) vk_buf_finish_write, gpu, buf);
@@ -1484,6 +1830,7 @@ static void buf_barrier(const struct pl_gpu *gpu, struct vk_cmd *cmd,
     buf_vk->current_access = newAccess;
     buf_vk->exported = (op & BUF_EXPORT);
     buf_vk->refcount++;
+    vk_unlock(vk);
     vk_cmd_callback(cmd, (vk_cb) vk_buf_deref, gpu, buf);
     vk_cmd_obj(cmd, buf);
 }
@@ -1543,9 +1890,8 @@ static void buf_flush(const struct pl_gpu *gpu, struct vk_cmd *cmd,
         .size = size,
     };
 
-    vk->CmdPipelineBarrier(cmd->buf, buf_vk->sig_stage,
-                           VK_PIPELINE_STAGE_HOST_BIT, 0,
-                           0, NULL, 1, &buffBarrier, 0, NULL);
+    vk_barrier(gpu, cmd, VK_NULL_HANDLE, buf_vk->sig_stage,
+               VK_PIPELINE_STAGE_HOST_BIT, &buffBarrier, NULL);
 
     // Invalidate the mapped memory as soon as this barrier completes
     if (buf_vk->slice.mem.data && !buf_vk->slice.mem.coherent)
@@ -1557,11 +1903,10 @@ static bool vk_buf_poll(const struct pl_gpu *gpu, const struct pl_buf *buf,
 {
     struct pl_vk *p = TA_PRIV(gpu);
     struct vk_ctx *vk = p->vk;
-    struct pl_buf_vk *buf_vk = TA_PRIV(buf);
 
     // Opportunistically check if we can re-use this buffer without flush
     vk_poll_commands(vk, 0);
-    if (buf_vk->refcount == 1)
+    if (!vk_buf_in_use(gpu, buf))
         return false;
 
     // Otherwise, we're force to submit all queued commands so that the
@@ -1571,7 +1916,7 @@ static bool vk_buf_poll(const struct pl_gpu *gpu, const struct pl_buf *buf,
     vk_flush_obj(vk, buf);
     vk_poll_commands(vk, timeout);
 
-    return buf_vk->refcount > 1;
+    return vk_buf_in_use(gpu, buf);
 }
 
 static void vk_buf_write(const struct pl_gpu *gpu, const struct pl_buf *buf,
@@ -1644,7 +1989,7 @@ static bool vk_buf_read(const struct pl_gpu *gpu, const struct pl_buf *buf,
     pl_assert(buf_vk->slice.mem.data);
 
     // ensure no more queued writes
-    while (buf_vk->writes)
+    while (vk_buf_writing(gpu, buf))
         vk_buf_poll(gpu, buf, UINT64_MAX);
 
     uintptr_t addr = (uintptr_t) buf_vk->slice.mem.data + (size_t) offset;
@@ -1699,7 +2044,7 @@ static bool vk_buf_export(const struct pl_gpu *gpu, const struct pl_buf *buf)
     if (buf_vk->exported)
         return true;
 
-    struct vk_cmd *cmd = PL_DEF(p->cmd, vk_require_cmd(gpu, GRAPHICS));
+    struct vk_cmd *cmd = PL_DEF(vk_cur_cmd(gpu), vk_require_cmd(gpu, GRAPHICS));
     if (!cmd) {
         PL_ERR(gpu, "Failed exporting buffer!");
         return false;
@@ -1979,8 +2324,13 @@ static bool vk_tex_upload(const struct pl_gpu *gpu,
         fixed.buf = tbuf;
         fixed.buf_offset = 0;
 
-        return emulated ? pl_tex_upload_texel(gpu, p->dp, &fixed)
-                        : pl_tex_upload(gpu, &fixed);
+        if (!emulated)
+            return pl_tex_upload(gpu, &fixed);
+
+        pthread_mutex_lock(&p->dp_lock);
+        bool ok = pl_tex_upload_texel(gpu, p->dp, &fixed);
+        pthread_mutex_unlock(&p->dp_lock);
+        return ok;
 
     } else {
 
@@ -2065,8 +2415,15 @@ static bool vk_tex_download(const struct pl_gpu *gpu,
         fixed.buf = tbuf;
         fixed.buf_offset = 0;
 
-        bool ok = emulated ? pl_tex_download_texel(gpu, p->dp, &fixed)
-                           : pl_tex_download(gpu, &fixed);
+        bool ok;
+        if (emulated) {
+            pthread_mutex_lock(&p->dp_lock);
+            ok = pl_tex_download_texel(gpu, p->dp, &fixed);
+            pthread_mutex_unlock(&p->dp_lock);
+        } else {
+            ok = pl_tex_download(gpu, &fixed);
+        }
+
         if (!ok)
             goto error;
 
@@ -2272,7 +2629,11 @@ static VkResult vk_compile_glsl(const struct pl_gpu *gpu, void *tactx,
     PL_DEBUG(gpu, "%s shader source:", shader_names[type]);
     pl_msg_source(gpu->ctx, PL_LOG_DEBUG, glsl);
 
-    if (!p->spirv->impl->compile_glsl(p->spirv, tactx, type, glsl, spirv)) {
+    pthread_mutex_lock(&p->spirv_lock);
+    bool ok = p->spirv->impl->compile_glsl(p->spirv, tactx, type, glsl, spirv);
+    pthread_mutex_unlock(&p->spirv_lock);
+
+    if (!ok) {
         pl_msg_source(gpu->ctx, PL_LOG_ERR, glsl);
         return VK_ERROR_INITIALIZATION_FAILED;
     }
@@ -2758,8 +3119,8 @@ static void vk_update_descriptor(const struct pl_gpu *gpu, struct vk_cmd *cmd,
         VkDescriptorBufferInfo *binfo = &pass_vk->dsbinfo[idx];
         *binfo = (VkDescriptorBufferInfo) {
             .buffer = buf_vk->slice.buf,
-            .offset = buf_vk->slice.mem.offset,
-            .range = buf->params.size,
+            .offset = buf_vk->slice.mem.offset + db.buf_offset,
+            .range = buf->params.size - db.buf_offset,
         };
 
         wds->pBufferInfo = binfo;
@@ -2807,6 +3168,7 @@ static void vk_release_descriptor(const struct pl_gpu *gpu, struct vk_cmd *cmd,
     }
 }
 
+// Called from command callbacks, i.e. with vk->lock held
 static void set_ds(struct pl_pass_vk *pass_vk, void *dsbit)
 {
     pass_vk->dmask |= (uintptr_t) dsbit;
@@ -2871,11 +3233,15 @@ static void vk_pass_run(const struct pl_gpu *gpu,
 
     if (!pass_vk->use_pushd) {
         // Wait for a free descriptor set
+        vk_lock(vk);
         while (!pass_vk->dmask) {
             PL_TRACE(gpu, "No free descriptor sets! ...blocking (slow path)");
+            vk_unlock(vk);
             vk_flush_obj(vk, pass);
             vk_poll_commands(vk, 10000000); // 10 ms
+            vk_lock(vk);
         }
+        vk_unlock(vk);
     }
 
     struct vk_cmd *cmd = vk_require_cmd(gpu, types[pass->params.type]);
@@ -2888,6 +3254,7 @@ static void vk_pass_run(const struct pl_gpu *gpu,
     // Find a descriptor set to use
     VkDescriptorSet ds = VK_NULL_HANDLE;
     if (!pass_vk->use_pushd) {
+        vk_lock(vk);
         for (int i = 0; i < PL_ARRAY_SIZE(pass_vk->dss); i++) {
             uint16_t dsbit = 1u << i;
             if (pass_vk->dmask & dsbit) {
@@ -2899,12 +3266,28 @@ static void vk_pass_run(const struct pl_gpu *gpu,
                 break;
             }
         }
+        vk_unlock(vk);
     }
 
-    // Update the dswrite structure with all of the new values
+    // Update the dswrite structure with all of the new values, batching up
+    // the barriers required by all resources into a single call
+    vk_barrier_begin(gpu, cmd);
     for (int i = 0; i < pass->params.num_descriptors; i++)
         vk_update_descriptor(gpu, cmd, pass, params->desc_bindings[i], ds, i);
 
+    if (pass->params.type == PL_PASS_RASTER) {
+        buf_barrier(gpu, cmd, vert, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, 0, vert->params.size,
+                    BUF_READ);
+
+        tex_barrier(gpu, cmd, params->target,
+                    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                    pass_vk->initialLayout, false);
+    }
+
+    vk_barrier_flush(gpu);
+
     if (!pass_vk->use_pushd) {
         vk->UpdateDescriptorSets(vk->dev, pass->params.num_descriptors,
                                  pass_vk->dswrite, 0, NULL);
@@ -2942,17 +3325,9 @@ static void vk_pass_run(const struct pl_gpu *gpu,
         const struct pl_tex *tex = params->target;
         struct pl_tex_vk *tex_vk = TA_PRIV(tex);
 
-        buf_barrier(gpu, cmd, vert, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-                    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, 0, vert->params.size,
-                    BUF_READ);
-
         vk->CmdBindVertexBuffers(cmd->buf, 0, 1, &vert_vk->slice.buf,
                                  &vert_vk->slice.mem.offset);
 
-        tex_barrier(gpu, cmd, tex, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                    pass_vk->initialLayout, false);
-
         VkViewport viewport = {
             .x = params->viewport.x0,
             .y = params->viewport.y0,
@@ -3002,7 +3377,7 @@ static void vk_pass_run(const struct pl_gpu *gpu,
 
     // flush the work so far into its own command buffer, for better
     // intra-frame granularity
-    pl_assert(cmd == p->cmd); // make sure this is still the case
+    pl_assert(cmd == vk_cur_cmd(gpu)); // make sure this is still the case
     vk_submit(gpu);
 
 error:
@@ -3053,9 +3428,12 @@ static void vk_sync_deref(const struct pl_gpu *gpu, const struct pl_sync *sync)
     if (!sync)
         return;
 
+    struct pl_vk *p = TA_PRIV(gpu);
     struct pl_sync_vk *sync_vk = TA_PRIV(sync);
+    vk_lock(p->vk);
     if (--sync_vk->refcount == 0)
         vk_sync_destroy(gpu, (struct pl_sync *) sync);
+    vk_unlock(p->vk);
 }
 
 static const struct pl_sync *vk_sync_create(const struct pl_gpu *gpu,
@@ -3158,7 +3536,7 @@ static bool vk_tex_export(const struct pl_gpu *gpu, const struct pl_tex *tex,
     struct pl_tex_vk *tex_vk = TA_PRIV(tex);
     struct pl_sync_vk *sync_vk = TA_PRIV(sync);
 
-    struct vk_cmd *cmd = p->cmd ? p->cmd : vk_require_cmd(gpu, GRAPHICS);
+    struct vk_cmd *cmd = PL_DEF(vk_cur_cmd(gpu), vk_require_cmd(gpu, GRAPHICS));
     if (!cmd)
         goto error;
 
@@ -3177,7 +3555,9 @@ static bool vk_tex_export(const struct pl_gpu *gpu, const struct pl_tex *tex,
 
     // Remember the other dependency and hold on to the sync object
     pl_tex_vk_external_dep(gpu, tex, sync_vk->signal);
+    vk_lock(vk);
     sync_vk->refcount++;
+    vk_unlock(vk);
     tex_vk->ext_sync = sync;
     return true;
 
@@ -3355,9 +3735,9 @@ static void vk_gpu_finish(const struct pl_gpu *gpu)
 
 struct vk_cmd *pl_vk_steal_cmd(const struct pl_gpu *gpu)
 {
-    struct pl_vk *p = TA_PRIV(gpu);
     struct vk_cmd *cmd = vk_require_cmd(gpu, GRAPHICS);
-    p->cmd = NULL;
+    if (cmd)
+        vk_thread(gpu)->cmd = NULL;
     return cmd;
 }
 
@@ -96,11 +96,24 @@ struct vk_heap {
 // memory type.
 struct vk_malloc {
     struct vk_ctx *vk;
+    pthread_mutex_t lock; // guards the heaps and their slabs (if thread-safe)
     VkPhysicalDeviceMemoryProperties props;
     struct vk_heap *heaps;
     int num_heaps;
 };
 
+static inline void ma_lock(struct vk_malloc *ma)
+{
+    if (ma->vk->thread_safe)
+        pthread_mutex_lock(&ma->lock);
+}
+
+static inline void ma_unlock(struct vk_malloc *ma)
+{
+    if (ma->vk->thread_safe)
+        pthread_mutex_unlock(&ma->lock);
+}
+
 static void slab_free(struct vk_ctx *vk, struct vk_slab *slab)
 {
     if (!slab)
@@ -389,6 +402,7 @@ struct vk_malloc *vk_malloc_create(struct vk_ctx *vk)
 {
     struct vk_malloc *ma = talloc_zero(NULL, struct vk_malloc);
     vk->GetPhysicalDeviceMemoryProperties(vk->physd, &ma->props);
+    pthread_mutex_init(&ma->lock, NULL);
     ma->vk = vk;
 
     PL_INFO(vk, "Memory heaps supported by device:");
@@ -417,6 +431,7 @@ void vk_malloc_destroy(struct vk_malloc **ma_ptr)
     for (int i = 0; i < ma->num_heaps; i++)
         heap_uninit(ma->vk, &ma->heaps[i]);
 
+    pthread_mutex_destroy(&ma->lock);
     TA_FREEP(ma_ptr);
 }
 
@@ -445,6 +460,7 @@ void vk_free_memslice(struct vk_malloc *ma, struct vk_memslice slice)
     if (!slab)
         return;
 
+    ma_lock(ma);
     pl_assert(slab->used >= slice.size);
     slab->used -= slice.size;
 
@@ -462,6 +478,8 @@ void vk_free_memslice(struct vk_malloc *ma, struct vk_memslice slice)
             .end   = slice.offset + slice.size,
         });
     }
+
+    ma_unlock(ma);
 }
 
 // reqs: can be NULL
@@ -608,8 +626,11 @@ bool vk_malloc_generic(struct vk_malloc *ma, VkMemoryRequirements reqs,
                        enum pl_handle_type handle_type,
                        struct vk_memslice *out)
 {
+    ma_lock(ma);
     struct vk_heap *heap = find_heap(ma, 0, flags, handle_type, &reqs);
-    return slice_heap(ma, heap, reqs.size, reqs.alignment, out);
+    bool ok = slice_heap(ma, heap, reqs.size, reqs.alignment, out);
+    ma_unlock(ma);
+    return ok;
 }
 
 bool vk_malloc_buffer(struct vk_malloc *ma, VkBufferUsageFlags bufFlags,
@@ -617,8 +638,11 @@ bool vk_malloc_buffer(struct vk_malloc *ma, VkBufferUsageFlags bufFlags,
                       VkDeviceSize alignment, enum pl_handle_type handle_type,
                       struct vk_bufslice *out)
 {
+    ma_lock(ma);
     struct vk_heap *heap = find_heap(ma, bufFlags, memFlags, handle_type, NULL);
-    if (!slice_heap(ma, heap, size, alignment, &out->mem))
+    bool ok = slice_heap(ma, heap, size, alignment, &out->mem);
+    ma_unlock(ma);
+    if (!ok)
         return false;
 
     struct vk_slab *slab = out->mem.priv;
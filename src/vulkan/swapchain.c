@@ -711,6 +711,7 @@ static bool vk_sw_submit_frame(const struct pl_swapchain *sw)
     if (!vk_flush_commands(vk))
         return false;
 
+    vk_lock(vk);
     struct vk_cmdpool *pool = vk->pool_graphics;
     VkQueue queue = pool->queues[pool->idx_queues];
 
@@ -727,6 +728,7 @@ static bool vk_sw_submit_frame(const struct pl_swapchain *sw)
 
     PL_TRACE(vk, "vkQueuePresentKHR waits on %p", (void *) sem_out);
     VkResult res = vk->QueuePresentKHR(queue, &pinfo);
+    vk_unlock(vk);
     switch (res) {
     case VK_SUBOPTIMAL_KHR:
         p->suboptimal = true;